@@ -38,6 +38,7 @@ _JS_MODULES = [
     ('seq_io.js',          "function parseSEQ() { throw new Error('seq_io.js not found'); } function buildSEQ() { throw new Error('seq_io.js not found'); }"),
     ('tracker_state.js',   "var TrackerState = { NUM_CHANNELS: 8, create: function() { return {}; } };"),
     ('tracker_playback.js',"var TrackerPlayback = { create: function() { return {}; } };"),
+    ('scsp_ring.js',       "var ScspRing = null;"),
     ('scsp_engine.js',     "var SCSPEngine = {};"),
     ('tracker_ui.js',      "var TrackerUI = { init: function() {} };"),
     ('scsp_panels.js',  "var SCSPPanels = { init: function() {} };"),
@@ -81,6 +82,15 @@ def generate_html(bundled=True):
             wasm_b64 = ""
             glue_js = "var SCSPModule = () => Promise.resolve(null);"
 
+        # Optional SIMD128 build; the engine falls back to the scalar one
+        simd_bytes = load_file(os.path.join('scsp_wasm', 'scsp_simd.wasm'), mode='rb')
+        simd_glue = load_file(os.path.join('scsp_wasm', 'scsp_simd.js'))
+        if simd_bytes and simd_glue and wasm_b64:
+            simd_b64 = base64.b64encode(simd_bytes).decode('ascii')
+        else:
+            simd_b64 = ""
+            simd_glue = ""
+
         # Embed demo MIDI + example TON files so the JS can reference them
         demo_midi_b64 = ""
         demo_path = os.path.join(tools_dir, '..', 'examples', 'kit_demo.mid')
@@ -106,7 +116,12 @@ def generate_html(bundled=True):
         script_lines.append(
             '<script>\n'
             f"const SCSP_WASM_B64 = '{wasm_b64}';\n"
-            f'{glue_js}\n\n'
+            f"const SCSP_WASM_SIMD_B64 = '{simd_b64}';\n"
+            '</script>\n'
+            # own tags so the render worker can load the glue from its text
+            f'<script id="scsp-glue">\n{glue_js}\n</script>\n'
+            f'<script id="scsp-glue-simd">\n{simd_glue}\n</script>\n'
+            '<script>\n'
             '// Bootstrap\n'
             'var state = TrackerState.create(SCSPEngine.getPresets());\n'
             'var playback = TrackerPlayback.create(state, SCSPEngine);\n'
@@ -123,20 +138,21 @@ def generate_html(bundled=True):
         # WASM + glue loaded at runtime via fetch; bootstrap is async
         script_lines.append(
             '<script src="tools/scsp_wasm/scsp.js"></script>\n'
+            '<script src="tools/scsp_wasm/scsp_simd.js"></script>\n'
             '<script>\n'
-            '// Dev mode: fetch WASM binary and convert to base64 for the engine\n'
+            '// Dev mode: fetch WASM binaries and convert to base64 for the engine\n'
             '(async function() {\n'
-            '  var resp = await fetch("tools/scsp_wasm/scsp.wasm");\n'
-            '  if (resp.ok) {\n'
-            '    var buf = await resp.arrayBuffer();\n'
-            '    var bytes = new Uint8Array(buf);\n'
+            '  async function fetchB64(url) {\n'
+            '    var resp = await fetch(url);\n'
+            '    if (!resp.ok) return "";\n'
+            '    var bytes = new Uint8Array(await resp.arrayBuffer());\n'
             '    var bin = "";\n'
             '    for (var i = 0; i < bytes.length; i++) bin += String.fromCharCode(bytes[i]);\n'
-            '    window.SCSP_WASM_B64 = btoa(bin);\n'
-            '  } else {\n'
-            '    window.SCSP_WASM_B64 = "";\n'
-            '    console.warn("SCSP WASM not found — run make in tools/scsp_wasm/");\n'
+            '    return btoa(bin);\n'
             '  }\n'
+            '  window.SCSP_WASM_B64 = await fetchB64("tools/scsp_wasm/scsp.wasm");\n'
+            '  window.SCSP_WASM_SIMD_B64 = await fetchB64("tools/scsp_wasm/scsp_simd.wasm");\n'
+            '  if (!window.SCSP_WASM_B64) console.warn("SCSP WASM not found — run make in tools/scsp_wasm/");\n'
             '  // Bootstrap\n'
             '  var state = TrackerState.create(SCSPEngine.getPresets());\n'
             '  var playback = TrackerPlayback.create(state, SCSPEngine);\n'
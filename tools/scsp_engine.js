@@ -40,11 +40,18 @@ var SCSPEngine = (function() {
     var MAX_SLOTS = 32;
     /** @constant {number} SCSP_RAM_SIZE - Total SCSP RAM in bytes (512KB) */
     var SCSP_RAM_SIZE = 512 * 1024;
+    /** @constant {number} WORKLET_LATENCY - Frames the render worker keeps buffered ahead of the AudioWorklet */
+    var WORKLET_LATENCY = 256;
 
     // ── State ──────────────────────────────────────────────────────────
     var scsp = null, scspReady = false;
     var actx = null, fmNode = null, fmGain = null;
+    var wasmBinary = null, wasmSimd = false;
+    var renderer = null, audioStarting = false, lastPlayed = 0; // worker render path (scsp_ring.js)
+    var tickTimer = null;  // sequencer timer for the worker render path
     var playbackRef = null;
+    var nativeBank = false; // a TON bank is loaded through _scsp_bank_load (voices for _scsp_song_play)
+    var meterOut = {};      // reused by readMeters
     var waveStore = { waves: [], nextOffset: 0 };
     var slotPostProgramHook = null; // called after each slot is programmed: fn(slot)
 
@@ -151,6 +158,7 @@ var SCSPEngine = (function() {
             scsp.HEAPU8[ramPtr + offset + i * 2]     = val & 0xFF;
             scsp.HEAPU8[ramPtr + offset + i * 2 + 1] = (val >> 8) & 0xFF;
         }
+        if (renderer) renderer.ram(offset, byteSize);
         var id = waveStore.waves.length;
         waveStore.waves.push({ offset: offset, length: len, loopStart: loopStart, loopEnd: loopEnd, loopMode: loopMode });
         waveStore.nextOffset = offset + byteSize;
@@ -214,6 +222,7 @@ var SCSPEngine = (function() {
     function resetSCSP() {
         scsp._scsp_init();
         voiceAlloc.releaseAll();
+        nativeBank = false;
         waveStore.waves = [];
         waveStore.nextOffset = 0;
         var ramPtr = scsp._scsp_get_ram_ptr();
@@ -404,6 +413,7 @@ var SCSPEngine = (function() {
      */
     function syncRawRegs(op) {
         if (!op.rawRegs) return;
+        delete op.tonVoice; // edited: the native bank image no longer matches
         if (op.freq_ratio > 0) {
             var ratioSemitones = Math.round(12 * Math.log2(op.freq_ratio));
             op.rawRegs.baseNote = Math.max(0, Math.min(127, 69 - ratioSemitones));
@@ -445,7 +455,10 @@ var SCSPEngine = (function() {
         var slotBase = slots[0];
         for (var i = 0; i < ops.length; i++) {
             var op = ops[i];
-            if (op.rawRegs) {
+            if (op.tonVoice !== undefined && scsp._scsp_bank_program &&
+                scsp._scsp_bank_program(slots[i], op.tonVoice, i, midiNote) >= 0) {
+                if (slotPostProgramHook) slotPostProgramHook(slots[i]);
+            } else if (op.rawRegs) {
                 if (op.useTonSA) {
                     var origSA = ((op.rawRegs.d0 & 0x0F) << 16) | op.rawRegs.sa;
                     programSlotRaw(slots[i], op.rawRegs, midiNote, origSA, slotBase, i, op.rawRegs.lea, op.mod_source);
@@ -485,13 +498,25 @@ var SCSPEngine = (function() {
                 return { instruments: null, message: 'TON too large for WASM heap' };
             }
 
-            // Byte-swap entire file (BE->LE) into SCSP RAM
-            for (var i = 0; i < tonBytes.length - 1; i += 2) {
-                scsp.HEAPU8[ramPtr + i]     = tonBytes[i + 1];
-                scsp.HEAPU8[ramPtr + i + 1] = tonBytes[i];
+            // Native loader: parse + copy PCM into SCSP RAM in one pass and
+            // keep per-layer register images for _scsp_bank_program.
+            // Older builds: byte-swap the entire file (BE->LE) from JS.
+            nativeBank = false;
+            if (scsp._scsp_bank_load) {
+                var tonPtr = scsp._malloc(tonBytes.length);
+                scsp.HEAPU8.set(tonBytes, tonPtr);
+                nativeBank = scsp._scsp_bank_load(tonPtr, tonBytes.length, 0) >= 0;
+                scsp._free(tonPtr);
+            }
+            if (!nativeBank) {
+                for (var i = 0; i < tonBytes.length - 1; i += 2) {
+                    scsp.HEAPU8[ramPtr + i]     = tonBytes[i + 1];
+                    scsp.HEAPU8[ramPtr + i + 1] = tonBytes[i];
+                }
+                if (renderer) renderer.ram(0, tonBytes.length);
             }
 
-            var result = TonIO.importTon(arrayBuffer);
+            var result = TonIO.importTon(arrayBuffer, { pcm: false });
 
             // Reset waveStore and load built-in waveforms after TON data
             waveStore.waves = [];
@@ -504,6 +529,7 @@ var SCSPEngine = (function() {
             var instruments = [];
             for (var pi = 0; pi < result.patches.length; pi++) {
                 var p = result.patches[pi];
+                var tonVoice = nativeBank ? pi : undefined;
                 instruments.push({
                     name: p.name || ('Voice ' + pi),
                     operators: p.operators.map(function(o) {
@@ -518,6 +544,7 @@ var SCSPEngine = (function() {
                             loop_start: o.loop_start || 0, loop_end: o.loop_end || 1024,
                             rawRegs: o.rawRegs || null,
                             useTonSA: true,
+                            tonVoice: tonVoice,
                         };
                     })
                 });
@@ -703,6 +730,88 @@ var SCSPEngine = (function() {
         container.appendChild(testRow);
     }
 
+    // ── Audio output ───────────────────────────────────────────────────
+
+    /**
+     * @description Whether this browser accepts WASM SIMD128: validates a
+     * minimal module whose one function uses i8x16.splat / i8x16.popcnt.
+     * @returns {boolean}
+     */
+    function simdSupported() {
+        if (typeof WebAssembly === 'undefined' || !WebAssembly.validate) return false;
+        return WebAssembly.validate(new Uint8Array([
+            0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0,
+            10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11]));
+    }
+
+    /**
+     * @description Main-thread render path: a 2048-frame ScriptProcessor calls
+     * scsp_render and advances the sequencer once per buffer.
+     */
+    function startScriptAudio() {
+        fmNode = actx.createScriptProcessor(2048, 0, 2);
+        fmNode.connect(fmGain);
+        fmNode.onaudioprocess = function(e) {
+            var outL = e.outputBuffer.getChannelData(0);
+            var outR = e.outputBuffer.numberOfChannels > 1 ? e.outputBuffer.getChannelData(1) : outL;
+            var n = outL.length;
+            if (!scspReady) { for (var i = 0; i < n; i++) { outL[i] = 0; outR[i] = 0; } return; }
+            if (playbackRef && playbackRef.playing) playbackRef.processBlock(n);
+            var bufPtr = scsp._scsp_render(n);
+            var heap16 = new Int16Array(scsp.HEAP16.buffer, bufPtr, n * 2);
+            for (var i = 0; i < n; i++) {
+                outL[i] = heap16[i * 2] / 32768.0;
+                outR[i] = heap16[i * 2 + 1] / 32768.0;
+            }
+        };
+    }
+
+    /**
+     * @description Worker render path: the worker renders ahead into a shared
+     * ring and an AudioWorklet plays it. The sequencer is advanced from a
+     * main-thread timer by the number of frames played since the last tick,
+     * so a busy UI delays note events but never the audio itself. Falls back
+     * to startScriptAudio if the worker or worklet can't start.
+     */
+    function startWorkletAudio() {
+        audioStarting = true;
+        ScspRing.startRenderer(actx, scsp, {
+            wasm: wasmBinary, glueUrl: ScspRing.findGlue(wasmSimd), latency: WORKLET_LATENCY,
+            factory: wasmSimd ? 'SCSPModuleSimd' : 'SCSPModule',
+        }).then(function(r) {
+            renderer = r;
+            fmNode = r.node;
+            fmNode.connect(fmGain);
+            lastPlayed = r.framesPlayed();
+            clearInterval(tickTimer);
+            tickTimer = setInterval(function() {
+                var played = r.framesPlayed();
+                var n = (played - lastPlayed) >>> 0;
+                lastPlayed = played;
+                if (n && playbackRef && playbackRef.playing) playbackRef.processBlock(n);
+            }, 5);
+        }).catch(function(err) {
+            console.warn('SCSP worklet audio unavailable, using ScriptProcessor:', err.message);
+            startScriptAudio();
+        }).then(function() {
+            audioStarting = false;
+        });
+    }
+
+    /**
+     * @description Stop whichever render path is running: the worker
+     * renderer and its sequencer timer, or the ScriptProcessor. The output
+     * chain is rebuilt by the next startAudio.
+     */
+    function stopRenderer() {
+        clearInterval(tickTimer);
+        tickTimer = null;
+        if (renderer) renderer.stop();
+        else if (fmNode) fmNode.disconnect();
+        renderer = null;
+        fmNode = null;
+    }
+
     // ── Public API ─────────────────────────────────────────────────────
 
     /** @type {SoundEngine} */
@@ -713,26 +822,33 @@ var SCSPEngine = (function() {
         WAVE_LEN: WAVE_LEN,
 
         /** @description Initialize SCSP WASM module and load built-in waveforms. No-op if already ready.
+         *  Picks the SIMD128 build when it is bundled and the browser validates SIMD opcodes.
          *  @returns {Promise<void>} */
         init: function() {
             if (scspReady) return Promise.resolve();
             if (typeof SCSP_WASM_B64 === 'undefined' || !SCSP_WASM_B64) return Promise.reject(new Error('No SCSP WASM'));
-            var wasmBytes = Uint8Array.from(atob(SCSP_WASM_B64), function(c) { return c.charCodeAt(0); });
-            return SCSPModule({ wasmBinary: wasmBytes.buffer }).then(function(mod) {
+            wasmSimd = typeof SCSP_WASM_SIMD_B64 !== 'undefined' && !!SCSP_WASM_SIMD_B64 &&
+                       typeof SCSPModuleSimd === 'function' && simdSupported();
+            var wasmBytes = Uint8Array.from(atob(wasmSimd ? SCSP_WASM_SIMD_B64 : SCSP_WASM_B64),
+                                            function(c) { return c.charCodeAt(0); });
+            wasmBinary = wasmBytes.slice();   // kept for the render worker
+            var factory = wasmSimd ? SCSPModuleSimd : SCSPModule;
+            return factory({ wasmBinary: wasmBytes.buffer }).then(function(mod) {
                 scsp = mod;
                 resetSCSP();
                 scspReady = true;
             });
         },
 
-        /** @description Create AudioContext, ScriptProcessor node, and audio chain (gain -> LPF -> compressor). Stores playback ref for sequencer tick processing.
+        /** @description Create AudioContext, output node, and audio chain (gain -> LPF -> compressor). Stores playback ref for sequencer tick processing.
+         *  Renders through a worker + AudioWorklet (scsp_ring.js) when the page is cross-origin isolated,
+         *  otherwise through a ScriptProcessor on the main thread.
          *  @param {Object} playback - Playback controller with playing flag and processBlock method */
         startAudio: function(playback) {
             playbackRef = playback;
             if (!actx) actx = new (window.AudioContext || window.webkitAudioContext)({ sampleRate: SAMPLE_RATE });
             if (actx.state === 'suspended') actx.resume();
-            if (!fmNode && scspReady) {
-                fmNode = actx.createScriptProcessor(2048, 0, 2);
+            if (!fmNode && !audioStarting && scspReady) {
                 fmGain = actx.createGain();
                 fmGain.gain.value = 0.35;
                 var lpf = actx.createBiquadFilter();
@@ -745,26 +861,59 @@ var SCSPEngine = (function() {
                 compressor.ratio.value = 8;
                 compressor.attack.value = 0.002;
                 compressor.release.value = 0.05;
-                fmNode.connect(fmGain);
                 fmGain.connect(lpf);
                 lpf.connect(compressor);
                 compressor.connect(actx.destination);
-                fmNode.onaudioprocess = function(e) {
-                    var outL = e.outputBuffer.getChannelData(0);
-                    var outR = e.outputBuffer.numberOfChannels > 1 ? e.outputBuffer.getChannelData(1) : outL;
-                    var n = outL.length;
-                    if (!scspReady) { for (var i = 0; i < n; i++) { outL[i] = 0; outR[i] = 0; } return; }
-                    if (playbackRef && playbackRef.playing) playbackRef.processBlock(n);
-                    var bufPtr = scsp._scsp_render(n);
-                    var heap16 = new Int16Array(scsp.HEAP16.buffer, bufPtr, n * 2);
-                    for (var i = 0; i < n; i++) {
-                        outL[i] = heap16[i * 2] / 32768.0;
-                        outR[i] = heap16[i * 2 + 1] / 32768.0;
-                    }
-                };
+                if (typeof ScspRing !== 'undefined' && ScspRing && ScspRing.isSupported(actx)) {
+                    startWorkletAudio();
+                } else {
+                    startScriptAudio();
+                }
             }
         },
 
+        /** @description Stop rendering and release the render worker, if any. */
+        stopAudio: function() {
+            stopRenderer();
+        },
+
+        /** @description Set how far the render worker runs ahead of playback (worklet path only).
+         *  @param {number} frames - Buffered frames, 128 minimum
+         *  @returns {boolean} True if the worklet path is active */
+        setAudioLatency: function(frames) {
+            if (!renderer) return false;
+            renderer.setLatency(frames);
+            return true;
+        },
+
+        /** @description Audio path health, for the status bar.
+         *  @returns {{mode: string, underruns: number, dropped: number}} */
+        getAudioStats: function() {
+            if (renderer) return { mode: 'worklet', underruns: renderer.underruns(), dropped: renderer.dropped() };
+            return { mode: fmNode ? 'script' : 'off', underruns: 0, dropped: 0 };
+        },
+
+        /** @description Turn on the level meters accumulated inside the render loop.
+         *  @param {boolean} on
+         *  @returns {boolean} False if the build has no meters */
+        enableMeters: function(on) {
+            if (!scspReady || !scsp._scsp_meter_enable) return false;
+            scsp._scsp_meter_enable(on ? 1 : 0);
+            return true;
+        },
+
+        /** @description Per-slot, per-EFREG and master peak/RMS levels (1.0 = full scale).
+         *  On the worklet path these cover everything rendered since the previous call; on
+         *  the script path, the last render block. The returned object is reused.
+         *  @returns {?Object} { samples, slotPeak, slotRms, efPeak, efRms, masterPeak,
+         *                      masterRms }, or null if meters are unavailable */
+        readMeters: function() {
+            if (!scspReady || !scsp._scsp_meter_get || typeof ScspRing === 'undefined') return null;
+            if (renderer) renderer.takeMeters(meterOut);
+            else ScspRing.meterRead(scsp.HEAPF32, scsp._scsp_meter_get() >> 2, meterOut);
+            return meterOut;
+        },
+
         /** @description Trigger a note on the given channel.
          *  @param {number} ch - Channel number
          *  @param {number} midiNote - MIDI note (0-127)
@@ -785,6 +934,39 @@ var SCSPEngine = (function() {
             voiceAlloc.releaseAll();
         },
 
+        /** @description Whether a song over these instruments can be played by the native SEQ
+         *  player: the build has it, and every instrument is the unedited voice of the same
+         *  index in a bank loaded through the native TON loader.
+         *  @param {Object[]} instruments
+         *  @returns {boolean} */
+        canPlaySong: function(instruments) {
+            if (!scspReady || !nativeBank || !scsp._scsp_song_load) return false;
+            return instruments.every(function(inst, i) {
+                return inst.operators.every(function(op) { return op.tonVoice === i; });
+            });
+        },
+
+        /** @description Play a SEQ file on the native player. Its events fire inside the
+         *  render call at their exact sample, so no per-block JS scheduling is needed.
+         *  @param {Uint8Array} seqBytes - SEQ bank (seq_io.js buildSEQ / mid2seq)
+         *  @param {boolean} loop - Restart at the end of the song
+         *  @returns {boolean} False if the build lacks the player or the file is invalid */
+        playSong: function(seqBytes, loop) {
+            if (!scspReady || !scsp._scsp_song_load) return false;
+            voiceAlloc.releaseAll();
+            var ptr = scsp._malloc(seqBytes.length);
+            scsp.HEAPU8.set(seqBytes, ptr);
+            var ok = scsp._scsp_song_load(ptr, seqBytes.length, 0) > 0;
+            scsp._free(ptr);
+            if (ok) scsp._scsp_song_play(loop ? 1 : 0);
+            return ok;
+        },
+
+        /** @description Stop the native SEQ player and release its voices. */
+        stopSong: function() {
+            if (scspReady && scsp._scsp_song_stop) scsp._scsp_song_stop();
+        },
+
         /** @description Import a TON bank file into SCSP RAM.
          *  @param {ArrayBuffer} arrayBuffer - Raw TON file data
          *  @param {string} label - Display name for messages
@@ -964,6 +1146,36 @@ var SCSPEngine = (function() {
             return true;
         },
 
+        /** @description Hot-swap an assembled DSP program without silencing it.
+         *  Keeps TEMP/MEMS and the ring buffer when RBL is unchanged, so delay
+         *  and reverb tails continue through the edit. Falls back to
+         *  dspLoadProgram on WASM builds without hot-swap support.
+         *  @param {Uint16Array} mpro - Microprogram words
+         *  @param {Int16Array} coef - Coefficient table
+         *  @param {Uint16Array} madrs - Memory address table
+         *  @param {number} rbl - Ring buffer length selector (0-3)
+         *  @param {number} [rampSamples] - COEF/MADRS glide when MPRO is unchanged
+         *  @returns {number} Changed MPRO steps, or -1 after a full (clearing) load */
+        dspReloadProgram: function(mpro, coef, madrs, rbl, rampSamples) {
+            if (!scsp) return -1;
+            if (!scsp._scsp_dsp_reload_arrays) {
+                this.dspLoadProgram(mpro, coef, madrs, rbl);
+                return -1;
+            }
+            var mproPtr = scsp._malloc(mpro.byteLength);
+            var coefPtr = scsp._malloc(coef.byteLength);
+            var madrsPtr = scsp._malloc(madrs.byteLength);
+            scsp.HEAPU16.set(mpro, mproPtr >> 1);
+            scsp.HEAP16.set(coef, coefPtr >> 1);
+            scsp.HEAPU16.set(madrs, madrsPtr >> 1);
+            var changed = scsp._scsp_dsp_reload_arrays(mproPtr, mpro.length, coefPtr, coef.length,
+                                                       madrsPtr, madrs.length, rbl, rampSamples || 0);
+            scsp._free(mproPtr);
+            scsp._free(coefPtr);
+            scsp._free(madrsPtr);
+            return changed;
+        },
+
         /** @description Load a binary EXB DSP program file.
          *  @param {Uint8Array} bytes - Raw EXB data
          *  @returns {boolean} True if loaded */
@@ -985,6 +1197,29 @@ var SCSPEngine = (function() {
         dspGetMadrs: function(idx) { return scsp ? scsp._scsp_dsp_get_madrs(idx) : 0; },
         dspSetMadrs: function(idx, val) { if (scsp) scsp._scsp_dsp_set_madrs(idx, val); },
 
+        /** @description Glide a COEF entry to a new value inside the render loop.
+         *  Falls back to an immediate set on WASM builds without ramp support.
+         *  @param {number} idx - COEF index (0-63)
+         *  @param {number} val - Target raw COEF value (signed 16-bit)
+         *  @param {number} samples - Ramp length in samples (0 = immediate)
+         *  @param {number} [shape] - 0 = linear (default), 1 = exponential */
+        dspRampCoef: function(idx, val, samples, shape) {
+            if (!scsp) return;
+            if (scsp._scsp_dsp_ramp_coef) scsp._scsp_dsp_ramp_coef(idx, val, samples, shape || 0);
+            else scsp._scsp_dsp_set_coef(idx, val);
+        },
+
+        /** @description Glide a MADRS entry (delay tap) to a new value.
+         *  @param {number} idx - MADRS index (0-31)
+         *  @param {number} val - Target offset in words
+         *  @param {number} samples - Ramp length in samples (0 = immediate)
+         *  @param {number} [shape] - 0 = linear (default), 1 = exponential */
+        dspRampMadrs: function(idx, val, samples, shape) {
+            if (!scsp) return;
+            if (scsp._scsp_dsp_ramp_madrs) scsp._scsp_dsp_ramp_madrs(idx, val, samples, shape || 0);
+            else scsp._scsp_dsp_set_madrs(idx, val);
+        },
+
         /** @description Set effect send level (IMXL) for a slot.
          *  @param {number} slot - Slot index (0-31)
          *  @param {number} level - Send level (0-7) */
@@ -501,10 +501,19 @@ var SCSPPanels = (function() {
         if (result.errors.length) { dspSetStatus(result.errors[0], true); return; }
         if (result.steps === 0) { dspSetStatus('No program steps', true); return; }
 
-        engine.dspLoadProgram(result.mpro, result.coef, result.madrs, rbl);
+        // Recompiles after the first keep the running state, so an edit is
+        // heard immediately without cutting off the echo/reverb tail.
+        var changed = -1;
+        if (dspState.compiled) {
+            changed = engine.dspReloadProgram(result.mpro, result.coef, result.madrs, rbl, 441);
+        } else {
+            engine.dspLoadProgram(result.mpro, result.coef, result.madrs, rbl);
+        }
 
         dspState.compiled = true;
-        var statusMsg = result.steps + ' steps loaded';
+        var statusMsg = changed >= 0
+            ? result.steps + ' steps, ' + changed + ' changed (hot-swapped)'
+            : result.steps + ' steps loaded';
         if (result.warnings && result.warnings.length) {
             statusMsg += ' (' + result.warnings.length + ' NOP' +
                 (result.warnings.length > 1 ? 's' : '') + ' inserted for alignment)';
@@ -566,7 +575,8 @@ var SCSPPanels = (function() {
                     val2.textContent = p + '%';
                     var v13 = Math.round(4095 * p / 100);
                     var shifted = (v13 << 3) & 0xFFFF;
-                    engine.dspSetCoef(c2.index, shifted > 32767 ? shifted - 65536 : shifted);
+                    // ~10 ms glide so dragging the knob doesn't zipper
+                    engine.dspRampCoef(c2.index, shifted > 32767 ? shifted - 65536 : shifted, 441);
                 };
             })(c, inp, val);
 
@@ -590,7 +600,8 @@ var SCSPPanels = (function() {
                     var ms = parseInt(inp2.value);
                     val2.textContent = ms + 'ms';
                     var samples = Math.round(44100 * ms / 1000) & 0xFFFF;
-                    engine.dspSetMadrs(a2.index, samples);
+                    // glide the tap instead of jumping (a jump clicks)
+                    engine.dspRampMadrs(a2.index, samples, 2205);
                 };
             })(a, inp, val);
 
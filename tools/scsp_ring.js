@@ -0,0 +1,600 @@
+/**
+ * @module scsp_ring
+ * @description Off-main-thread audio for the SCSP engine.
+ *
+ * A dedicated worker runs its own copy of the SCSP WASM module and renders
+ * ahead into a SharedArrayBuffer single-producer/single-consumer ring. An
+ * AudioWorklet plays from that ring, so audio keeps running while the main
+ * thread is busy. Register writes made through the main-thread module are
+ * mirrored to the worker through a second lock-free queue. Bulk changes
+ * (sound RAM, DSP programs, resets) go by postMessage, and a SYNC record in
+ * the queue keeps them in order with the register writes.
+ *
+ * SharedArrayBuffer needs a cross-origin isolated page (served with
+ * COOP/COEP headers). SCSPEngine falls back to ScriptProcessorNode when
+ * isSupported() is false.
+ *
+ * Everything is defined inside scspRingFactory, so the same source can be
+ * loaded into the worker and worklet scopes from a Blob URL.
+ */
+var ScspRing = (function scspRingFactory() {
+    'use strict';
+
+    /** @constant {Object} CMD - Command opcodes, mirroring SCSP_CMD_* in scsp_wasm.c.
+     *  SYNC is handled by the worker itself: a = sequence number of a bulk message. */
+    var CMD = {
+        WRITE_REG: 1, WRITE_SLOT: 2, KEY_ON: 3, KEY_OFF: 4,
+        EFFECT_SEND: 5, EFFECT_OUTPUT: 6, DIRECT_OUTPUT: 7,
+        DSP_RAMP_COEF: 8, DSP_RAMP_MADRS: 9,
+        DSP_START: 10, DSP_STOP: 11, DSP_CLEAR: 12, BANK_PROGRAM: 13,
+        SONG_PLAY: 14, SONG_STOP: 15, METER_ENABLE: 16,
+        SYNC: 0x100,
+    };
+
+    /** @constant {Object} METER - Word offsets in struct _SCSP_METER (scsp.h), all 32 bit.
+     *  Word 0 (Enabled) doubles as the "taken" flag in the shared copy. */
+    var METER = {
+        SAMPLES: 1, SLOT_PEAK: 2, SLOT_SUM: 34, EF_PEAK: 66, EF_SUM: 82,
+        MASTER_PEAK: 98, MASTER_SUM: 100, WORDS: 102,
+    };
+
+    // Int32 header words. WRITE/READ are free-running counters, so the fill
+    // level is (WRITE - READ) >>> 0 and never ambiguous when full.
+    var WRITE = 0, READ = 1, COUNT = 2, TARGET = 3;
+    var HEADER_BYTES = 16;
+
+    /** @constant {number} BLOCK - Frames per worker render call (one worklet quantum) */
+    var BLOCK = 128;
+
+    function isPow2(n) { return n > 0 && (n & (n - 1)) === 0; }
+
+    // ── Audio ring ─────────────────────────────────────────────────────
+
+    /** @description Allocate a stereo float ring.
+     *  @param {number} frames - Capacity in frames (power of two)
+     *  @returns {SharedArrayBuffer} */
+    function createAudioRing(frames) {
+        if (!isPow2(frames)) throw new Error('ring size must be a power of two');
+        return new SharedArrayBuffer(HEADER_BYTES + frames * 8);
+    }
+
+    /** @description View an audio ring. The worker is the only writer, the
+     *  worklet the only reader. Samples are stored planar (all L, then all R).
+     *  @param {SharedArrayBuffer} sab - From createAudioRing
+     *  @returns {Object} Ring accessor */
+    function audioRing(sab) {
+        var hdr = new Int32Array(sab, 0, 4);
+        var frames = (sab.byteLength - HEADER_BYTES) / 8;
+        var mask = frames - 1;
+        var left = new Float32Array(sab, HEADER_BYTES, frames);
+        var right = new Float32Array(sab, HEADER_BYTES + frames * 4, frames);
+
+        function fill() { return (Atomics.load(hdr, WRITE) - Atomics.load(hdr, READ)) >>> 0; }
+
+        return {
+            frames: frames,
+            header: hdr,
+            available: fill,
+            space: function() { return frames - fill(); },
+
+            /** @description Producer: append up to n frames.
+             *  @returns {number} Frames written */
+            write: function(srcL, srcR, n) {
+                var w = Atomics.load(hdr, WRITE);
+                var space = frames - ((w - Atomics.load(hdr, READ)) >>> 0);
+                if (n > space) n = space;
+                var pos = w & mask, first = Math.min(n, frames - pos);
+                left.set(srcL.subarray(0, first), pos);
+                right.set(srcR.subarray(0, first), pos);
+                if (n > first) {
+                    left.set(srcL.subarray(first, n), 0);
+                    right.set(srcR.subarray(first, n), 0);
+                }
+                Atomics.store(hdr, WRITE, (w + n) | 0);   // publishes the samples
+                return n;
+            },
+
+            /** @description Consumer: take up to n frames and wake the producer.
+             *  @returns {number} Frames read */
+            read: function(dstL, dstR, n) {
+                var r = Atomics.load(hdr, READ);
+                var avail = (Atomics.load(hdr, WRITE) - r) >>> 0;
+                if (n > avail) n = avail;
+                var pos = r & mask, first = Math.min(n, frames - pos);
+                dstL.set(left.subarray(pos, pos + first), 0);
+                dstR.set(right.subarray(pos, pos + first), 0);
+                if (n > first) {
+                    dstL.set(left.subarray(0, n - first), first);
+                    dstR.set(right.subarray(0, n - first), first);
+                }
+                Atomics.store(hdr, READ, (r + n) | 0);
+                Atomics.notify(hdr, READ);
+                return n;
+            },
+
+            /** @returns {number} Total frames written (mod 2^32) */
+            written: function() { return Atomics.load(hdr, WRITE) >>> 0; },
+            /** @returns {number} Total frames played (mod 2^32) */
+            played: function() { return Atomics.load(hdr, READ) >>> 0; },
+            /** @returns {number} Blocks the consumer had to pad with silence */
+            underruns: function() { return Atomics.load(hdr, COUNT); },
+            countUnderrun: function() { Atomics.add(hdr, COUNT, 1); },
+            /** @returns {number} Frames the producer keeps buffered ahead */
+            target: function() { return Atomics.load(hdr, TARGET); },
+            setTarget: function(n) { Atomics.store(hdr, TARGET, Math.max(BLOCK, Math.min(frames, n | 0))); },
+        };
+    }
+
+    // ── Command queue ──────────────────────────────────────────────────
+
+    /** @description Allocate a command queue of 4-word records.
+     *  @param {number} records - Capacity (power of two)
+     *  @returns {SharedArrayBuffer} */
+    function createCmdQueue(records) {
+        if (!isPow2(records)) throw new Error('queue size must be a power of two');
+        return new SharedArrayBuffer(HEADER_BYTES + records * 16);
+    }
+
+    /** @description View a command queue. One producer (main thread), one
+     *  consumer (render worker).
+     *  @param {SharedArrayBuffer} sab - From createCmdQueue
+     *  @returns {Object} Queue accessor */
+    function cmdQueue(sab) {
+        var hdr = new Int32Array(sab, 0, 4);
+        var records = (sab.byteLength - HEADER_BYTES) / 16;
+        var mask = records - 1;
+        var data = new Uint32Array(sab, HEADER_BYTES, records * 4);
+
+        return {
+            records: records,
+
+            /** @description Producer: queue one record.
+             *  @returns {boolean} False (and counted as dropped) if the queue is full */
+            push: function(op, a, b, c) {
+                var w = Atomics.load(hdr, WRITE);
+                if (((w - Atomics.load(hdr, READ)) >>> 0) >= records) {
+                    Atomics.add(hdr, COUNT, 1);
+                    return false;
+                }
+                var i = (w & mask) * 4;
+                data[i] = op;
+                data[i + 1] = a >>> 0;
+                data[i + 2] = b >>> 0;
+                data[i + 3] = c >>> 0;
+                Atomics.store(hdr, WRITE, (w + 1) | 0);   // publishes the record
+                return true;
+            },
+
+            /** @description Consumer: copy up to max records into dst. Stops at a
+             *  SYNC record whose bulk message hasn't been applied yet; SYNCs
+             *  already satisfied are consumed and not copied.
+             *  @param {Uint32Array} dst - Destination, 4 words per record
+             *  @param {number} max - Record capacity of dst
+             *  @param {number} synced - Sequence number of the last bulk message applied
+             *  @returns {number} Records copied */
+            pop: function(dst, max, synced) {
+                var r = Atomics.load(hdr, READ);
+                var avail = (Atomics.load(hdr, WRITE) - r) >>> 0;
+                var n = 0;
+                while (avail > 0 && n < max) {
+                    var i = (r & mask) * 4;
+                    if (data[i] === CMD.SYNC) {
+                        if (((data[i + 1] - synced) | 0) > 0) break;
+                    } else {
+                        dst[n * 4] = data[i];
+                        dst[n * 4 + 1] = data[i + 1];
+                        dst[n * 4 + 2] = data[i + 2];
+                        dst[n * 4 + 3] = data[i + 3];
+                        n++;
+                    }
+                    r = (r + 1) | 0;
+                    avail--;
+                }
+                Atomics.store(hdr, READ, r);
+                return n;
+            },
+
+            /** @returns {number} Records pending */
+            pending: function() { return (Atomics.load(hdr, WRITE) - Atomics.load(hdr, READ)) >>> 0; },
+            /** @returns {number} Records dropped because the queue was full */
+            dropped: function() { return Atomics.load(hdr, COUNT); },
+        };
+    }
+
+    // ── Level meters ───────────────────────────────────────────────────
+
+    /** @description View a shared meter block. The worker folds each
+     *  rendered block's meters in (peaks max, sums and sample counts add)
+     *  until the reader takes them, which starts a new accumulation, so a
+     *  UI polling at frame rate sees every peak.
+     *  @param {SharedArrayBuffer} sab - METER.WORDS * 4 bytes
+     *  @returns {Object} Meter accessor */
+    function meterBlock(sab) {
+        var f32 = new Float32Array(sab), i32 = new Int32Array(sab), u32 = new Uint32Array(sab);
+
+        return {
+            /** @description Worker: fold in a struct _SCSP_METER from the module heap.
+             *  @param {Float32Array} heap - HEAPF32
+             *  @param {number} base - Struct address / 4 */
+            merge: function(heap, base) {
+                var src = new Uint32Array(heap.buffer, heap.byteOffset, heap.length);
+                if (!src[base]) return;
+                if (Atomics.exchange(i32, 0, 0)) {
+                    f32.set(heap.subarray(base + 1, base + METER.WORDS), 1);
+                    return;
+                }
+                u32[METER.SAMPLES] += src[base + METER.SAMPLES];
+                for (var i = METER.SLOT_PEAK; i < METER.WORDS; i++) {
+                    var peak = i < METER.SLOT_SUM || (i >= METER.EF_PEAK && i < METER.EF_SUM) ||
+                               (i >= METER.MASTER_PEAK && i < METER.MASTER_SUM);
+                    var v = heap[base + i];
+                    if (peak) { if (v > f32[i]) f32[i] = v; } else f32[i] += v;
+                }
+            },
+
+            /** @description Reader: summarize what accumulated since the last take.
+             *  @param {Object} out - See meterRead */
+            take: function(out) {
+                meterRead(f32, 0, out);
+                Atomics.store(i32, 0, 1);
+            },
+        };
+    }
+
+    /** @description Summarize a meter struct into out: { samples, slotPeak[32],
+     *  slotRms[32], efPeak[16], efRms[16], masterPeak[2], masterRms[2] }, all
+     *  1.0 = full scale. Arrays in out are reused when present.
+     *  @param {Float32Array} f32 - View containing the struct
+     *  @param {number} base - Struct offset in words
+     *  @param {Object} out
+     *  @returns {Object} out */
+    function meterRead(f32, base, out) {
+        var n = new Uint32Array(f32.buffer, f32.byteOffset, f32.length)[base + METER.SAMPLES];
+        function fill(name, from, len, rms) {
+            var a = out[name] || (out[name] = new Float32Array(len));
+            for (var i = 0; i < len; i++) {
+                var v = f32[base + from + i];
+                a[i] = rms ? (n ? Math.sqrt(v / n) : 0) : v;
+            }
+        }
+        out.samples = n;
+        fill('slotPeak', METER.SLOT_PEAK, 32, false);
+        fill('slotRms', METER.SLOT_SUM, 32, true);
+        fill('efPeak', METER.EF_PEAK, 16, false);
+        fill('efRms', METER.EF_SUM, 16, true);
+        fill('masterPeak', METER.MASTER_PEAK, 2, false);
+        fill('masterRms', METER.MASTER_SUM, 2, true);
+        return out;
+    }
+
+    // ── Render worker (runs in the worker scope) ───────────────────────
+
+    function workerMain() {
+        var mod = null, audio = null, cmds = null, cmdView = null, meter = null;
+        var synced = 0, pending = [];
+        var CMD_MAX = 256;   // SCSP_CMD_MAX in scsp_wasm.c
+        var kick = new MessageChannel();
+
+        function applyBulk(m) {
+            if (m.type === 'snapshot') {
+                mod.HEAPU8.set(new Uint8Array(m.memory));
+            } else if (m.type === 'ram') {
+                mod.HEAPU8.set(m.bytes, mod._scsp_get_ram_ptr() + m.offset);
+            } else if (m.type === 'call') {
+                var args = m.args.slice(), ptrs = [];
+                for (var i = 0; i < m.arrays.length; i++) {
+                    var p = mod._malloc(m.arrays[i].bytes.byteLength || 1);
+                    mod.HEAPU8.set(m.arrays[i].bytes, p);
+                    args[m.arrays[i].arg] = p;
+                    ptrs.push(p);
+                }
+                mod[m.fn].apply(null, args);
+                for (var j = 0; j < ptrs.length; j++) mod._free(ptrs[j]);
+            }
+            synced = m.seq;
+        }
+
+        function drain() {
+            var n = cmds.pop(cmdView, CMD_MAX, synced);
+            if (n) mod._scsp_exec(cmdView.byteOffset, n);
+        }
+
+        // Render until TARGET frames are buffered, sleep until the worklet
+        // takes some (at most 2 ms), then yield so bulk messages get handled.
+        function pump() {
+            drain();
+            while (audio.available() + ScspRing.BLOCK <= audio.target()) {
+                var p = mod._scsp_render_f32(ScspRing.BLOCK) >> 2;
+                audio.write(mod.HEAPF32.subarray(p, p + ScspRing.BLOCK),
+                            mod.HEAPF32.subarray(p + ScspRing.BLOCK, p + 2 * ScspRing.BLOCK),
+                            ScspRing.BLOCK);
+                if (meter) meter.merge(mod.HEAPF32, mod._scsp_meter_get() >> 2);
+                drain();
+            }
+            Atomics.wait(audio.header, 1, Atomics.load(audio.header, 1), 2);
+            kick.port2.postMessage(0);
+        }
+
+        self.onmessage = function(e) {
+            var m = e.data;
+            if (m.type !== 'init') {
+                if (mod) applyBulk(m); else pending.push(m);
+                return;
+            }
+            importScripts(m.glueUrl);
+            self[m.factory || 'SCSPModule']({ wasmBinary: m.wasm }).then(function(instance) {
+                mod = instance;
+                audio = ScspRing.audioRing(m.audio);
+                cmds = ScspRing.cmdQueue(m.cmds);
+                cmdView = new Uint32Array(mod.HEAPU8.buffer, mod._scsp_get_cmd_buf(), CMD_MAX * 4);
+                if (m.meter && mod._scsp_meter_get) meter = ScspRing.meterBlock(m.meter);
+                applyBulk({ type: 'snapshot', memory: m.memory, seq: 0 });
+                while (pending.length) applyBulk(pending.shift());
+                kick.port1.onmessage = pump;
+                pump();
+                self.postMessage({ type: 'ready' });
+            }, function(err) {
+                self.postMessage({ type: 'error', message: String(err) });
+            });
+        };
+    }
+
+    // ── Playback worklet (runs in the AudioWorkletGlobalScope) ─────────
+
+    function workletMain() {
+        class ScspRingPlayer extends AudioWorkletProcessor {
+            constructor(options) {
+                super();
+                this.ring = ScspRing.audioRing(options.processorOptions.audio);
+            }
+            process(inputs, outputs) {
+                var out = outputs[0];
+                var l = out[0], r = out.length > 1 ? out[1] : out[0];
+                var got = this.ring.read(l, r, l.length);
+                if (got < l.length) {
+                    l.fill(0, got);
+                    r.fill(0, got);
+                    this.ring.countUnderrun();
+                }
+                return true;
+            }
+        }
+        registerProcessor('scsp-ring-player', ScspRingPlayer);
+    }
+
+    function scopeSource(main) {
+        return 'var ScspRing = (' + scspRingFactory.toString() + ')();\n(' + main.toString() + ')();\n';
+    }
+
+    function blobUrl(src) {
+        return URL.createObjectURL(new Blob([src], { type: 'text/javascript' }));
+    }
+
+    // ── Main-thread side ───────────────────────────────────────────────
+
+    // Scalar exports forwarded as queue records: name -> opcode
+    var FORWARD = {
+        _scsp_write_reg: CMD.WRITE_REG,
+        _scsp_write_slot: CMD.WRITE_SLOT,
+        _scsp_key_on: CMD.KEY_ON,
+        _scsp_key_off: CMD.KEY_OFF,
+        _scsp_slot_set_effect_send: CMD.EFFECT_SEND,
+        _scsp_slot_set_effect_output: CMD.EFFECT_OUTPUT,
+        _scsp_slot_set_direct_output: CMD.DIRECT_OUTPUT,
+        _scsp_dsp_start: CMD.DSP_START,
+        _scsp_dsp_stop: CMD.DSP_STOP,
+        _scsp_dsp_clear: CMD.DSP_CLEAR,
+        _scsp_song_play: CMD.SONG_PLAY,
+        _scsp_song_stop: CMD.SONG_STOP,
+        _scsp_meter_enable: CMD.METER_ENABLE,
+    };
+
+    // Exports taking heap pointers, replayed in the worker by postMessage:
+    // name -> [[pointer arg, element count arg, bytes per element], ...]
+    var BULK_CALLS = {
+        _scsp_dsp_load_arrays: [[0, 1, 2], [2, 3, 2], [4, 5, 2]],
+        _scsp_dsp_reload_arrays: [[0, 1, 2], [2, 3, 2], [4, 5, 2]],
+        _scsp_dsp_load_exb: [[0, 1, 1]],
+        _scsp_dsp_reload_exb: [[0, 1, 1]],
+        _scsp_bank_load: [[0, 1, 1]],
+        _scsp_song_load: [[0, 1, 1]],
+    };
+
+    /** @description True if this page can use the worker/worklet path.
+     *  @param {AudioContext} actx
+     *  @returns {boolean} */
+    function isSupported(actx) {
+        return typeof SharedArrayBuffer !== 'undefined' && typeof Atomics !== 'undefined' &&
+            (typeof crossOriginIsolated === 'undefined' || crossOriginIsolated) &&
+            typeof Worker !== 'undefined' && typeof AudioWorkletNode !== 'undefined' &&
+            !!(actx && actx.audioWorklet);
+    }
+
+    /** @description Locate the Emscripten glue for the worker: the inlined
+     *  <script id="scsp-glue"> of a bundled page, or the scsp.js <script src>.
+     *  @param {boolean} [simd] - Look for the SIMD128 build (scsp-glue-simd / scsp_simd.js)
+     *  @returns {?string} URL the worker can importScripts() */
+    function findGlue(simd) {
+        if (typeof document === 'undefined') return null;
+        var tag = document.getElementById(simd ? 'scsp-glue-simd' : 'scsp-glue');
+        if (tag) return blobUrl(tag.textContent);
+        var src = document.querySelector(simd ? 'script[src$="scsp_simd.js"]' : 'script[src$="scsp.js"]');
+        return src ? src.src : null;
+    }
+
+    /**
+     * @description Fork the state of a main-thread SCSP module into a render
+     * worker and play it through an AudioWorklet. From then on, calls to the
+     * module's register/DSP exports still update the main-thread copy (so
+     * reads such as dspGetCoef keep working), and are also queued for the
+     * worker. The main-thread copy is never rendered.
+     * @param {AudioContext} actx
+     * @param {Object} mod - SCSPModule instance
+     * @param {Object} opts - { wasm: Uint8Array, glueUrl: string, latency: frames,
+     *                          ringFrames: frames, queueRecords: records,
+     *                          factory: glue export name, default 'SCSPModule' }
+     * @returns {Promise<Object>} Renderer: { node, ram, takeMeters, framesPlayed,
+     *                            framesWritten, underruns, dropped, setLatency, stop }
+     */
+    function startRenderer(actx, mod, opts) {
+        if (!mod._scsp_exec || !mod._scsp_render_f32) {
+            return Promise.reject(new Error('SCSP WASM build lacks the worker render API'));
+        }
+        if (!opts.glueUrl) return Promise.reject(new Error('SCSP glue script not found'));
+
+        var audioSab = createAudioRing(opts.ringFrames || 2048);
+        var cmdSab = createCmdQueue(opts.queueRecords || 1024);
+        var meterSab = new SharedArrayBuffer(METER.WORDS * 4);
+        var audio = audioRing(audioSab), cmds = cmdQueue(cmdSab);
+        var originals = {}, seq = 0, worker = null;
+
+        audio.setTarget(opts.latency || 256);
+
+        function bulk(msg, transfer) {
+            msg.seq = ++seq;
+            worker.postMessage(msg, transfer || []);
+            cmds.push(CMD.SYNC, seq, 0, 0);
+        }
+
+        function wrap(name, fn) {
+            if (!mod[name]) return;
+            originals[name] = mod[name];
+            mod[name] = fn(mod[name]);
+        }
+
+        function mirror() {
+            Object.keys(FORWARD).forEach(function(name) {
+                var op = FORWARD[name];
+                wrap(name, function(orig) {
+                    return function(a, b, c) {
+                        var ret = orig(a, b, c);
+                        cmds.push(op, a | 0, b | 0, c | 0);
+                        return ret;
+                    };
+                });
+            });
+            // The main-thread copy never renders, so its ramps would never
+            // advance: apply the target there, ramp in the worker.
+            wrap('_scsp_dsp_set_coef', function(orig) {
+                return function(idx, val) { orig(idx, val); cmds.push(CMD.DSP_RAMP_COEF, idx, val, 0); };
+            });
+            wrap('_scsp_dsp_set_madrs', function(orig) {
+                return function(idx, val) { orig(idx, val); cmds.push(CMD.DSP_RAMP_MADRS, idx, val, 0); };
+            });
+            wrap('_scsp_dsp_ramp_coef', function() {
+                return function(idx, val, samples, shape) {
+                    originals._scsp_dsp_set_coef(idx, val);
+                    cmds.push(CMD.DSP_RAMP_COEF, (idx & 0xFF) | ((shape & 1) << 8), val, samples);
+                };
+            });
+            wrap('_scsp_dsp_ramp_madrs', function() {
+                return function(idx, val, samples, shape) {
+                    originals._scsp_dsp_set_madrs(idx, val);
+                    cmds.push(CMD.DSP_RAMP_MADRS, (idx & 0xFF) | ((shape & 1) << 8), val, samples);
+                };
+            });
+            wrap('_scsp_bank_program', function(orig) {
+                return function(slot, voice, layer, note) {
+                    var ret = orig(slot, voice, layer, note);
+                    if (ret >= 0) cmds.push(CMD.BANK_PROGRAM, slot, (voice << 8) | (layer & 0xFF), note);
+                    return ret;
+                };
+            });
+            wrap('_scsp_init', function(orig) {
+                return function() {
+                    orig();
+                    var memory = mod.HEAPU8.slice().buffer;
+                    bulk({ type: 'snapshot', memory: memory }, [memory]);
+                };
+            });
+            Object.keys(BULK_CALLS).forEach(function(name) {
+                var sig = BULK_CALLS[name];
+                wrap(name, function(orig) {
+                    return function() {
+                        var args = Array.prototype.slice.call(arguments);
+                        var ret = orig.apply(null, args);
+                        bulk({ type: 'call', fn: name, args: args, arrays: sig.map(function(s) {
+                            var ptr = args[s[0]];
+                            return { arg: s[0], bytes: mod.HEAPU8.slice(ptr, ptr + args[s[1]] * s[2]) };
+                        }) });
+                        return ret;
+                    };
+                });
+            });
+        }
+
+        function unmirror() {
+            Object.keys(originals).forEach(function(name) { mod[name] = originals[name]; });
+        }
+
+        return actx.audioWorklet.addModule(blobUrl(scopeSource(workletMain))).then(function() {
+            return new Promise(function(resolve, reject) {
+                worker = new Worker(blobUrl(scopeSource(workerMain)));
+                worker.onmessage = function(e) {
+                    if (e.data.type === 'ready') resolve();
+                    else if (e.data.type === 'error') reject(new Error(e.data.message));
+                };
+                worker.onerror = function(e) { reject(new Error(e.message || 'render worker failed')); };
+                // Mirror first, then snapshot: every later write reaches the worker.
+                mirror();
+                var memory = mod.HEAPU8.slice().buffer;
+                worker.postMessage({
+                    type: 'init', glueUrl: opts.glueUrl, wasm: opts.wasm, factory: opts.factory,
+                    audio: audioSab, cmds: cmdSab, meter: meterSab, memory: memory,
+                }, [memory]);
+            });
+        }).then(function() {
+            var node = new AudioWorkletNode(actx, 'scsp-ring-player', {
+                numberOfInputs: 0, numberOfOutputs: 1, outputChannelCount: [2],
+                processorOptions: { audio: audioSab },
+            });
+            return {
+                node: node,
+                /** Copy a range of sound RAM (after direct HEAPU8 writes) to the worker */
+                ram: function(offset, length) {
+                    var base = mod._scsp_get_ram_ptr() + offset;
+                    bulk({ type: 'ram', offset: offset, bytes: mod.HEAPU8.slice(base, base + length) });
+                },
+                /** Meters accumulated by the worker since the last call (see meterRead) */
+                takeMeters: meterBlock(meterSab).take,
+                framesPlayed: audio.played,
+                framesWritten: audio.written,
+                underruns: audio.underruns,
+                dropped: cmds.dropped,
+                setLatency: audio.setTarget,
+                stop: function() {
+                    unmirror();
+                    node.disconnect();
+                    worker.terminate();
+                },
+            };
+        }, function(err) {
+            unmirror();
+            if (worker) worker.terminate();
+            throw err;
+        });
+    }
+
+    return {
+        CMD: CMD,
+        METER: METER,
+        BLOCK: BLOCK,
+        createAudioRing: createAudioRing,
+        audioRing: audioRing,
+        createCmdQueue: createCmdQueue,
+        cmdQueue: cmdQueue,
+        meterBlock: meterBlock,
+        meterRead: meterRead,
+        isSupported: isSupported,
+        findGlue: findGlue,
+        startRenderer: startRenderer,
+        /** @returns {string} Source of the render worker script */
+        workerSource: function() { return scopeSource(workerMain); },
+        /** @returns {string} Source of the AudioWorklet module */
+        workletSource: function() { return scopeSource(workletMain); },
+    };
+})();
+
+if (typeof module !== 'undefined' && module.exports) {
+    module.exports = ScspRing;
+}
@@ -21,7 +21,7 @@
 #define DISTRHO_PLUGIN_WANT_FULL_STATE 1
 #define DISTRHO_PLUGIN_WANT_PROGRAMS  1
 #define DISTRHO_PLUGIN_WANT_LATENCY   0
-#define DISTRHO_PLUGIN_WANT_TIMEPOS   0
+#define DISTRHO_PLUGIN_WANT_TIMEPOS   1
 #define DISTRHO_PLUGIN_WANT_DIRECT_ACCESS 0
 
 #define DISTRHO_PLUGIN_HAS_UI          1
@@ -6,9 +6,16 @@
  */
 
 #include "DistrhoPlugin.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 /* Minimal JSON number parser for load_patch state */
@@ -26,7 +33,11 @@ static void jsonSkipTo(const char* &p, char c) {
 
 extern "C" {
 #include "scsp_voice.h"
+#include "scsp_state.h"
+#include "scsp_presets.h"
 extern int16_t *scsp_render(int num_samples);
+extern uint32_t scsp_slots_playing(void);
+extern int scsp_dsp_running(void);
 }
 
 START_NAMESPACE_DISTRHO
@@ -34,7 +45,9 @@ START_NAMESPACE_DISTRHO
 /* ── Parameter layout ─────────────────────────────────────────── */
 /* Per-operator: 14 params × 6 operators = 84 params
  * Global: numOps, carriers[6], programNum = 8 params
- * Total: 92 */
+ * Allocation: stealMode, multiTimbral, reservedSlots = 3 params
+ * Read-only outputs: activeSlots … noteOnLoad = 7 params
+ * Total: 102 */
 
 #define MAX_OPS 6
 #define PARAMS_PER_OP 14
@@ -65,88 +78,48 @@ enum GlobalParam {
     kIsCarrier4,                           /* 89 */
     kIsCarrier5,                           /* 90 */
     kProgramNumber,                        /* 91 */
-    kParameterCount                        /* 92 */
+    kStealMode,                            /* 92: scsp_steal_mode_t */
+    kMultiTimbral,                         /* 93 */
+    kReservedSlots,                        /* 94 */
+    kActiveSlots,                          /* 95: read-only outputs from here */
+    kPeakSlots,                            /* 96: over this bar and the last */
+    kDroppedNotes,                         /* 97: no slot could be freed */
+    kStolenNotes,                          /* 98: cut to make room */
+    kDspEnabled,                           /* 99 */
+    kRenderLoad,                           /* 100: fraction of block time */
+    kNoteOnLoad,                           /* 101 */
+    kParameterCount                        /* 102 */
 };
 
 static inline int opParamIndex(int op, int param) {
     return op * PARAMS_PER_OP + param;
 }
 
-/* ── Preset patches ───────────────────────────────────────────── */
-struct Preset {
-    const char *name;
-    int numOps;
-    struct { float ratio, level; int ar, d1r, dl, d2r, rr; float fb; int mdl, modSrc, isCarrier; } ops[MAX_OPS];
-};
-
-static const Preset kPresets[] = {
-    { "Electric Piano", 2, {
-        { 2.0f, 0.9f, 31,12,8,0,14, 0.0f, 0,-1, 0 },
-        { 1.0f, 0.8f, 31, 6,2,0,14, 0.0f, 9, 0, 1 },
-    }},
-    { "Bell", 2, {
-        { 3.5f, 0.9f, 31, 4,2,0, 8, 0.0f, 0,-1, 0 },
-        { 1.0f, 0.7f, 31, 2,0,0, 6, 0.0f,11, 0, 1 },
-    }},
-    { "Brass", 2, {
-        { 1.0f, 0.8f, 24, 4,2,0,14, 0.3f, 0,-1, 0 },
-        { 1.0f, 0.8f, 22, 2,0,0,14, 0.0f, 9, 0, 1 },
-    }},
-    { "Organ", 2, {
-        { 1.0f, 0.7f, 31, 0,0,0,20, 0.6f, 0,-1, 0 },
-        { 1.0f, 0.8f, 31, 0,0,0,20, 0.0f, 8, 0, 1 },
-    }},
-    { "FM Bass", 2, {
-        { 1.0f, 0.9f, 31,14,10,0,14,0.2f, 0,-1, 0 },
-        { 1.0f, 0.9f, 31, 6, 4,0,14,0.0f,10, 0, 1 },
-    }},
-    { "Strings", 2, {
-        { 1.002f,0.5f, 20, 0,0,0,16, 0.0f, 0,-1, 0 },
-        { 1.0f, 0.7f, 18, 0,0,0,14, 0.0f, 7, 0, 1 },
-    }},
-    { "Clavinet", 2, {
-        { 3.0f, 0.9f, 31,16,14,0,18, 0.0f, 0,-1, 0 },
-        { 1.0f, 0.8f, 31,10, 6,0,16, 0.0f,10, 0, 1 },
-    }},
-    { "Marimba", 2, {
-        { 4.0f, 0.8f, 31,18,16,0,20, 0.0f, 0,-1, 0 },
-        { 1.0f, 0.8f, 31, 8, 4,0,12, 0.0f, 9, 0, 1 },
-    }},
-    { "Electric Piano 2", 3, {
-        { 14.0f, 0.4f, 31,14,12,0,16, 0.0f, 0,-1, 0 },
-        {  1.0f, 0.7f, 31,10, 6,0,14, 0.0f, 8, 0, 0 },
-        {  1.0f, 0.8f, 31, 4, 2,0,12, 0.0f, 9, 1, 1 },
-    }},
-    { "Metallic", 3, {
-        { 1.414f, 0.6f, 31, 6,3,0,10, 0.4f, 0,-1, 0 },
-        { 3.82f,  0.5f, 31, 8,4,0,12, 0.0f, 0,-1, 0 },
-        { 1.0f,   0.7f, 31, 4,2,0,10, 0.0f,10, 0, 1 },
-    }},
-    { "4-Op E.Piano", 4, {
-        { 5.0f, 0.3f, 31,16,14,0,16, 0.2f, 0,-1, 0 },
-        { 1.0f, 0.5f, 31,12, 8,0,14, 0.0f, 7, 0, 0 },
-        { 1.0f, 0.7f, 31, 8, 4,0,12, 0.0f, 8, 1, 0 },
-        { 1.0f, 0.8f, 31, 4, 2,0,12, 0.0f, 9, 2, 1 },
-    }},
-    { "Sine", 1, {
-        { 1.0f, 0.8f, 31, 0,0,0,14, 0.0f, 0,-1, 1 },
-    }},
-};
-static const int kNumPresets = sizeof(kPresets) / sizeof(kPresets[0]);
-
 /* ── Plugin ───────────────────────────────────────────────────── */
 
 class SCSPSynthPlugin : public Plugin
 {
 public:
     SCSPSynthPlugin()
-        : Plugin(kParameterCount, kNumPresets, 3 + MAX_OPS /* patch + wave_0..wave_5 + kit_path + load_patch */)
+        : Plugin(kParameterCount, kNumPresets, 5 + MAX_OPS /* patch + wave_0..wave_5 + kit_path + load_patch + load_kit + wave_format */)
     {
         std::memset(&fAlloc, 0, sizeof(fAlloc));
         std::memset(&fWaveStore, 0, sizeof(fWaveStore));
         for (int i = 0; i < MAX_OPS; i++) fCustomWaveIds[i] = -1;
         scsp_voice_init(&fWaveStore);
+        fWaveStore.guard_playing = 1;   /* run() renders on another thread */
         loadProgram(0);
+        fBuilder = std::thread([this] { buildLoop(); });
+    }
+
+    ~SCSPSynthPlugin() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(fPublishLock);
+            fQuit = true;
+        }
+        fWake.notify_one();
+        fBuilder.join();
     }
 
     const char* getLabel()   const override { return "SCSPFMSynth"; }
@@ -201,19 +174,85 @@ public:
             param.name = "Program Number";
             param.hints |= kParameterIsInteger;
             param.ranges = {0, 15, 0};
+        } else if (index == kStealMode) {
+            /* Lives in the allocator, so presets and patches leave it alone */
+            param.name = "Voice Steal";
+            param.hints |= kParameterIsInteger;
+            param.ranges = {0, SCSP_STEAL_COUNT - 1, SCSP_STEAL_RELEASED};
+            param.enumValues.count = SCSP_STEAL_COUNT;
+            param.enumValues.restrictedMode = true;
+            param.enumValues.values = new ParameterEnumerationValue[SCSP_STEAL_COUNT];
+            param.enumValues.values[0].label = "Released first";
+            param.enumValues.values[0].value = SCSP_STEAL_RELEASED;
+            param.enumValues.values[1].label = "Oldest";
+            param.enumValues.values[1].value = SCSP_STEAL_OLDEST;
+            param.enumValues.values[2].label = "Quietest";
+            param.enumValues.values[2].value = SCSP_STEAL_QUIETEST;
+            param.enumValues.values[3].label = "Oldest, free on key-off";
+            param.enumValues.values[3].value = SCSP_STEAL_KEYOFF_FREE;
+        } else if (index == kMultiTimbral) {
+            /* Each MIDI channel plays the kit voice its last Program Change picked */
+            param.name = "Multi-timbral";
+            param.hints |= kParameterIsInteger | kParameterIsBoolean;
+            param.ranges = {0, 1, 0};
+        } else if (index == kReservedSlots) {
+            /* Slots the game keeps for PCM streams and sound effects */
+            param.name = "Reserved Slots";
+            param.hints |= kParameterIsInteger;
+            param.ranges = {0, 31, 0};
+        } else if (index >= kActiveSlots) {
+            /* Chip usage and cost, written by run() */
+            static const char *const names[] = {
+                "Active Slots", "Peak Slots", "Dropped Notes", "Stolen Notes", "DSP Enabled",
+                "Render Load", "Note-on Load"
+            };
+            param.name = names[index - kActiveSlots];
+            param.hints = kParameterIsOutput;
+            if (index == kRenderLoad || index == kNoteOnLoad) {
+                param.ranges = {0, 1, 0};
+            } else {
+                param.hints |= kParameterIsInteger;
+                if (index == kDspEnabled) param.hints |= kParameterIsBoolean;
+                param.ranges = {0, index == kDspEnabled ? 1.f : index == kDroppedNotes || index == kStolenNotes ? 1e6f : 32.f, 0};
+            }
         }
     }
 
     float getParameterValue(uint32_t index) const override
     {
-        return (index < kParameterCount) ? fParams[index] : 0.f;
+        if (index == kStealMode) return (float)fStealMode.load(std::memory_order_relaxed);
+        if (index == kMultiTimbral) return fMultiWanted.load(std::memory_order_relaxed) ? 1.f : 0.f;
+        if (index == kReservedSlots) return (float)fReservedSlots.load(std::memory_order_relaxed);
+        if (index >= kActiveSlots && index < kParameterCount)
+            return fOutputs[index - kActiveSlots].load(std::memory_order_relaxed);
+        return (index < kParameterCount) ? fHostParams[index].load(std::memory_order_relaxed) : 0.f;
     }
 
+    /* Hosts may call this on the audio thread or any other, so it only
+     * stages the value: allocator settings take effect at run()'s next
+     * block start, patch parameters when the builder thread merges them. */
     void setParameterValue(uint32_t index, float value) override
     {
-        if (index < kParameterCount) {
-            fParams[index] = value;
-            rebuildOps();
+        if (index == kStealMode) {
+            int mode = (int)value;
+            fStealMode.store((mode >= 0 && mode < SCSP_STEAL_COUNT) ? mode : SCSP_STEAL_RELEASED,
+                             std::memory_order_relaxed);
+            return;
+        }
+        if (index == kMultiTimbral) {
+            fMultiWanted.store(value >= 0.5f, std::memory_order_relaxed);
+            return;
+        }
+        if (index == kReservedSlots) {
+            int n = (int)value;
+            fReservedSlots.store(n < 0 ? 0 : n > 31 ? 31 : n, std::memory_order_relaxed);
+            return;
+        }
+        if (index < kActiveSlots) {
+            fHostParams[index].store(value, std::memory_order_relaxed);
+            fEdited[index / 64].fetch_or(1ull << (index % 64), std::memory_order_release);
+            fDirty.store(true, std::memory_order_release);
+            fWake.notify_one();
         }
     }
 
@@ -228,10 +267,13 @@ public:
     {
         if (index >= (uint32_t)kNumPresets) return;
         const Preset& pr = kPresets[index];
+        std::lock_guard<std::mutex> lock(fPublishLock);
+        mergeEdits();   /* made before the program change, so it overrides them */
 
         /* Clear all params to defaults */
         for (int i = 0; i < kParameterCount; i++) fParams[i] = 0.f;
 
+        fKitVoice = -1;
         fParams[kNumOps] = (float)pr.numOps;
 
         for (int i = 0; i < pr.numOps && i < MAX_OPS; i++) {
@@ -263,6 +305,7 @@ public:
             fParams[opParamIndex(i, kOpLoopStart)] = 0.f;
             fParams[opParamIndex(i, kOpLoopEnd)]   = 1024.f;
         }
+        syncHostParams();
         rebuildOps();
     }
 
@@ -281,21 +324,59 @@ public:
             state.key = "kit_path"; state.label = "Kit file path"; state.defaultValue = "";
         } else if (index == 2 + MAX_OPS) {
             state.key = "load_patch"; state.label = "Load patch data"; state.defaultValue = "";
+        } else if (index == 3 + MAX_OPS) {
+            state.key = "load_kit"; state.label = "Load kit file"; state.defaultValue = "";
+        } else if (index == 4 + MAX_OPS) {
+            state.key = "wave_format"; state.label = "Custom wave formats"; state.defaultValue = "0,0,0,0,0,0";
         }
     }
 
     void setState(const char* key, const char* value) override
+    {
+        /* Off the audio thread: publish straight away, after freeing what
+         * earlier patches dropped.  Host edits made before the state go
+         * under it; the host then sees what the state set. */
+        std::lock_guard<std::mutex> lock(fPublishLock);
+        collectRetired();
+        mergeEdits();
+        applyState(key, value);
+        syncHostParams();
+    }
+
+    void applyState(const char* key, const char* value)
     {
         /* Handle kit_path state */
         if (std::strcmp(key, "kit_path") == 0) {
             fKitPath = value ? value : "";
             return;
         }
-        /* Handle load_patch: JSON with operator params + base64 PCM.
+        /* Handle load_kit: read a .ton file and load it natively in one call
+         * (PCM straight into SCSP RAM, layers as register images). Notes
+         * then play voice kProgramNumber of the kit until an operator
+         * parameter is edited.  The kit goes to RAM no note is reading and
+         * its bank is published with the patch; the old kit's RAM and bank
+         * go once run() has moved on and its tails have finished. */
+        if (std::strcmp(key, "load_kit") == 0) {
+            if (!value || !value[0]) return;
+            std::vector<uint8_t> ton = readFile(value);
+            if (ton.empty()) return;
+            std::unique_ptr<scsp_ton_bank_t> bank(new scsp_ton_bank_t());
+            int voices = scsp_wave_store_load_ton(&fWaveStore, bank.get(), ton.data(), (uint32_t)ton.size());
+            if (voices < 0) return;   /* keep the current kit */
+            if (fTonBank) fRetiredBanks.push_back(std::move(fTonBank));
+            fTonBank = std::move(bank);
+            fKitVoice = voices > 0 ? (int)fParams[kProgramNumber] : -1;
+            publishPatch();
+            return;
+        }
+        /* Handle load_patch / patch: a base64 binary state (scsp_state.h,
+         * what getState("patch") saves), or the older text format with
+         * operator params + base64 PCM.
          * Format: "numOps|op0_ratio,op0_level,op0_ar,op0_d1r,op0_dl,op0_d2r,op0_rr,op0_fb,op0_mdl,op0_ms,op0_carrier,op0_lm,op0_ls,op0_le,op0_pcmLen,op0_pcmB64|op1_...|..."
          * This bypasses the setParameterValue round-trip entirely. */
-        if (std::strcmp(key, "load_patch") == 0) {
+        if (std::strcmp(key, "load_patch") == 0 || std::strcmp(key, "patch") == 0) {
             if (!value || !value[0]) return;
+            if (loadBinaryPatch(value)) return;
             const char* p = value;
 
             /* Parse numOps */
@@ -306,6 +387,15 @@ public:
             /* Clear all params */
             for (int i = 0; i < kParameterCount; i++) fParams[i] = 0.f;
             fParams[kNumOps] = (float)numOps;
+            fKitVoice = -1;
+
+            /* Old waves are held until the new patch is playing, so PCM
+             * the two patches share stays where it is. */
+            for (int i = 0; i < MAX_OPS; i++) {
+                retireWave(fCustomWaveIds[i]);
+                fCustomWaveIds[i] = -1;
+                fCustomPcm[i].clear();
+            }
 
             /* Parse each operator */
             for (int i = 0; i < numOps && *p; i++) {
@@ -353,14 +443,10 @@ public:
                     std::vector<uint8_t> raw = decodeBase64(b64str.c_str());
                     int numSamples = (int)(raw.size() / 2);
                     if (numSamples > 0) {
-                        const int16_t *samples = reinterpret_cast<const int16_t*>(raw.data());
-                        int waveId = scsp_wave_store_add(&fWaveStore, samples, numSamples,
-                                                          0, numSamples, 1);
-                        if (waveId >= 0) {
-                            fCustomWaveIds[i] = waveId;
-                            fParams[opParamIndex(i, kOpWaveform)] = (float)waveId;
-                            fParams[opParamIndex(i, kOpLoopEnd)]  = (float)numSamples;
-                        }
+                        fCustomPcm[i].resize(numSamples);
+                        std::memcpy(fCustomPcm[i].data(), raw.data(), numSamples * 2);
+                        if (storeCustomWave(i) >= 0)
+                            fParams[opParamIndex(i, kOpLoopEnd)] = (float)numSamples;
                     }
                 }
             }
@@ -389,26 +475,55 @@ public:
             if (raw.size() < 4) return;
 
             int numSamples = (int)(raw.size() / 2);
-            const int16_t *samples = reinterpret_cast<const int16_t*>(raw.data());
+            fCustomPcm[opIdx].resize(numSamples);
+            std::memcpy(fCustomPcm[opIdx].data(), raw.data(), numSamples * 2);
 
             /* Add to wave store */
-            int waveId = scsp_wave_store_add(&fWaveStore, samples, numSamples,
-                                              0, numSamples, 1 /* forward loop */);
-            if (waveId >= 0) {
-                fCustomWaveIds[opIdx] = waveId;
-                /* Update the operator's waveform_id parameter */
-                fParams[opParamIndex(opIdx, kOpWaveform)] = (float)waveId;
-                fParams[opParamIndex(opIdx, kOpLoopEnd)]  = (float)numSamples;
+            if (storeCustomWave(opIdx) >= 0) {
+                fParams[opParamIndex(opIdx, kOpLoopEnd)] = (float)numSamples;
                 rebuildOps();
             }
         }
+        /* Handle wave_format: "f0,f1,...,f5", an scsp_pcm_format_t per op.
+         * Ops holding custom PCM are re-stored in their new format. */
+        if (std::strcmp(key, "wave_format") == 0) {
+            if (!value) return;
+            const char* p = value;
+            bool changed = false;
+            for (int i = 0; i < MAX_OPS && *p; i++) {
+                int format = (int)jsonNumber(p); jsonSkipTo(p, ',');
+                if (format < 0 || format >= SCSP_PCM_FORMATS) format = SCSP_PCM16;
+                if (format == fWaveFormat[i]) continue;
+                fWaveFormat[i] = format;
+                if (!fCustomPcm[i].empty() && storeCustomWave(i) >= 0) changed = true;
+            }
+            if (changed) rebuildOps();
+        }
     }
 
     String getState(const char* key) const override
     {
+        std::lock_guard<std::mutex> lock(fPublishLock);
         if (std::strcmp(key, "kit_path") == 0) {
             return String(fKitPath.c_str());
         }
+        if (std::strcmp(key, "patch") == 0) {
+            scsp_state_op_t ops[MAX_OPS];
+            for (int i = 0; i < MAX_OPS; i++) {
+                ops[i].pcm    = fCustomPcm[i].empty() ? nullptr : fCustomPcm[i].data();
+                ops[i].length = (int)fCustomPcm[i].size();
+                ops[i].format = fWaveFormat[i];
+            }
+            std::vector<uint8_t> data(scsp_state_bound(kActiveSlots, ops, MAX_OPS));
+            data.resize(scsp_state_save(data.data(), fParams, kActiveSlots, ops, MAX_OPS, 1));
+            return String(encodeBase64(data).c_str());
+        }
+        if (std::strcmp(key, "wave_format") == 0) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%d,%d,%d,%d,%d,%d", fWaveFormat[0], fWaveFormat[1],
+                          fWaveFormat[2], fWaveFormat[3], fWaveFormat[4], fWaveFormat[5]);
+            return String(buf);
+        }
         return String();
     }
 
@@ -416,6 +531,25 @@ public:
     void run(const float**, float** outputs, uint32_t frames,
              const MidiEvent* midiEvents, uint32_t midiEventCount) override
     {
+        /* Allocator settings the host changed since the last block */
+        fAlloc.steal_mode = fStealMode.load(std::memory_order_relaxed);
+        fAlloc.reserved_slots = fReservedSlots.load(std::memory_order_relaxed);
+        bool multi = fMultiWanted.load(std::memory_order_relaxed);
+        if (multi != fMulti) {
+            scsp_voice_all_off(&fAlloc);
+            fMulti = multi;
+        }
+
+        /* Pick up the latest published patch for the whole block; the
+         * builder thread makes them, so nothing here waits or builds */
+        if (fMailbox.load(std::memory_order_relaxed) & kFresh)
+            fFront = fMailbox.exchange(fFront, std::memory_order_acq_rel) & 3;
+
+        using Clock = std::chrono::steady_clock;
+        Clock::duration renderTime {};
+        fNoteOnTime = {};
+        uint32_t slotsPeak = 0;
+
         uint32_t eventIdx = 0, framesDone = 0;
         while (framesDone < frames) {
             uint32_t nextFrame = frames;
@@ -425,7 +559,10 @@ public:
             }
             uint32_t toRender = nextFrame - framesDone;
             if (toRender > 0) {
+                Clock::time_point t0 = Clock::now();
                 int16_t *buf = scsp_render((int)toRender);
+                renderTime += Clock::now() - t0;
+                slotsPeak = std::max(slotsPeak, (uint32_t)__builtin_popcount(scsp_slots_playing()));
                 for (uint32_t i = 0; i < toRender; i++) {
                     outputs[0][framesDone + i] = buf[i * 2]     / 32768.0f;
                     outputs[1][framesDone + i] = buf[i * 2 + 1] / 32768.0f;
@@ -437,16 +574,78 @@ public:
                 eventIdx++;
             }
         }
+        updateOutputs(frames, renderTime, slotsPeak);
     }
 
 private:
-    float fParams[kParameterCount];
-    scsp_fm_op_t fOps[MAX_OPS];
+    float fParams[kParameterCount];  /* the patch's, under fPublishLock */
+    std::atomic<float> fHostParams[kActiveSlots] = {};  /* as the host last set or saw them */
+    std::atomic<uint64_t> fEdited[2] = {};  /* fHostParams set since fParams took them */
+    scsp_fm_op_t fOps[MAX_OPS];  /* built from fParams by rebuildOps, under fPublishLock */
     int fNumOps;
     scsp_voice_alloc_t fAlloc;
     scsp_wave_store_t fWaveStore;
     int fCustomWaveIds[MAX_OPS]; /* per-op custom wave store IDs, -1 = none */
+    std::vector<int16_t> fCustomPcm[MAX_OPS]; /* their 16-bit source, for format changes */
+    int fWaveFormat[MAX_OPS] = {}; /* scsp_pcm_format_t per op */
     std::string fKitPath;
+    std::unique_ptr<scsp_ton_bank_t> fTonBank;  /* last loaded kit, null = none */
+    int fKitVoice = -1;          /* kit voice played by note-on, -1 = operators */
+
+    /* fOps as slot images, in a triple buffer: rebuildOps fills
+     * fPatches[fBack] and swaps it into fMailbox; run() swaps fFront for it
+     * at block start when it's fresh.  Neither side waits, and neither ever
+     * holds a buffer the other writes, so a published patch is immutable.
+     * The producer side, the wave store and everything above belong to
+     * whoever holds fPublishLock: setState, loadProgram, or the builder
+     * thread, which fDirty wakes to merge the host's parameter edits. */
+    static constexpr int kFresh = 4;
+    scsp_patch_t fPatches[3] = {};
+    const scsp_ton_bank_t *fPatchBanks[3] = {};  /* fTonBank as each was published */
+    int fPatchKitVoices[3] = { -1, -1, -1 };     /* and fKitVoice */
+    std::atomic<int> fMailbox { 1 };   /* fPatches index, | kFresh if unread */
+    int fFront = 0;                    /* audio thread's */
+    int fBack = 2;                     /* rebuildOps' */
+    std::vector<int> fRetiring;        /* wave refs the next patch drops */
+    std::vector<int> fRetired;         /* dropped by a patch run() may not have taken */
+    std::vector<std::unique_ptr<scsp_ton_bank_t>> fRetiredBanks;  /* and replaced kits */
+    mutable std::mutex fPublishLock;
+    std::condition_variable fWake;     /* wakes the builder, with fPublishLock */
+    std::atomic<bool> fDirty { false }; /* fEdited has bits to merge */
+    bool fQuit = false;
+    std::thread fBuilder;
+
+    /* Allocator settings, staged by setParameterValue for run() */
+    std::atomic<int> fStealMode { SCSP_STEAL_RELEASED };
+    std::atomic<int> fReservedSlots { 0 };
+    std::atomic<bool> fMultiWanted { false };
+    bool fMulti = false;         /* multi-timbral: voices keyed by channel and note (run()'s) */
+    uint8_t fChannelProgram[16] = {}; /* last Program Change per channel */
+
+    /* Output parameters (kActiveSlots on), published by run() */
+    std::atomic<float> fOutputs[kParameterCount - kActiveSlots] = {};
+    std::chrono::steady_clock::duration fNoteOnTime {};  /* this block's */
+    double fRenderLoad = 0, fNoteOnLoad = 0;             /* smoothed */
+    uint32_t fBarPeak = 0, fLastBarPeak = 0;
+    int64_t fBar = -1;
+    uint64_t fFramesRun = 0;
+
+    static std::vector<uint8_t> readFile(const char *path)
+    {
+        std::vector<uint8_t> data;
+        std::FILE *f = std::fopen(path, "rb");
+        if (!f) return data;
+        if (std::fseek(f, 0, SEEK_END) == 0) {
+            long n = std::ftell(f);
+            if (n > 0 && n <= 512 * 1024) {
+                data.resize((size_t)n);
+                std::rewind(f);
+                if (std::fread(data.data(), 1, data.size(), f) != data.size()) data.clear();
+            }
+        }
+        std::fclose(f);
+        return data;
+    }
 
     static std::vector<uint8_t> decodeBase64(const char *input)
     {
@@ -472,6 +671,75 @@ private:
         return out;
     }
 
+    static std::string encodeBase64(const std::vector<uint8_t>& data)
+    {
+        static const char T[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        out.reserve((data.size() + 2) / 3 * 4);
+        for (size_t i = 0; i < data.size(); i += 3) {
+            uint32_t v = (uint32_t)data[i] << 16;
+            if (i + 1 < data.size()) v |= (uint32_t)data[i + 1] << 8;
+            if (i + 2 < data.size()) v |= data[i + 2];
+            out += T[(v >> 18) & 63];
+            out += T[(v >> 12) & 63];
+            out += i + 1 < data.size() ? T[(v >> 6) & 63] : '=';
+            out += i + 2 < data.size() ? T[v & 63] : '=';
+        }
+        return out;
+    }
+
+    /* Apply a binary patch state (scsp_state.h).  False if value isn't
+     * one, so the caller can fall back to the text format. */
+    bool loadBinaryPatch(const char* value)
+    {
+        std::vector<uint8_t> data = decodeBase64(value);
+        long body = scsp_state_body_size(data.data(), data.size(), kParameterCount, MAX_OPS);
+        if (body == -1) return false;
+        if (body < 0) return true;     /* ours but damaged: keep the current patch */
+
+        std::vector<int16_t> scratch((size_t)(body + 1) / 2);
+        float params[kParameterCount];
+        std::memcpy(params, fParams, sizeof(params));
+        scsp_state_op_t ops[MAX_OPS] = {};
+        int numOps = scsp_state_load(data.data(), data.size(), (uint8_t*)scratch.data(),
+                                     params, kParameterCount, ops, MAX_OPS);
+        if (numOps < 0) return true;   /* ours but damaged: keep the current patch */
+
+        std::memcpy(fParams, params, sizeof(fParams));
+        fKitVoice = -1;
+        for (int i = 0; i < MAX_OPS; i++) {
+            retireWave(fCustomWaveIds[i]);
+            fCustomWaveIds[i] = -1;
+            fCustomPcm[i].clear();
+            if (i >= numOps) continue;
+            int format = ops[i].format;
+            fWaveFormat[i] = format < SCSP_PCM_FORMATS ? format : SCSP_PCM16;
+            if (ops[i].pcm) {
+                fCustomPcm[i].assign(ops[i].pcm, ops[i].pcm + ops[i].length);
+                storeCustomWave(i);
+            }
+        }
+        rebuildOps();
+        return true;
+    }
+
+    /* Store an op's custom PCM in its format, replacing its previous wave */
+    int storeCustomWave(int op)
+    {
+        const std::vector<int16_t>& pcm = fCustomPcm[op];
+        /* No compaction here: the image run() holds keeps the old SAs
+         * until its next block, so moved waves would play from RAM that
+         * new waves may already have taken */
+        int waveId = scsp_wave_store_add_format(&fWaveStore, pcm.data(), (int)pcm.size(),
+                                                0, (int)pcm.size(), 1 /* forward loop */,
+                                                fWaveFormat[op]);
+        if (waveId < 0) return -1;
+        retireWave(fCustomWaveIds[op]);
+        fCustomWaveIds[op] = waveId;
+        fParams[opParamIndex(op, kOpWaveform)] = (float)waveId;
+        return waveId;
+    }
+
     void rebuildOps()
     {
         fNumOps = (int)fParams[kNumOps];
@@ -497,6 +765,144 @@ private:
             fOps[i].loop_start  = (int)fParams[opParamIndex(i, kOpLoopStart)];
             fOps[i].loop_end    = (int)fParams[opParamIndex(i, kOpLoopEnd)];
         }
+        publishPatch();
+    }
+
+    /* Build fOps' images and hand them to the audio thread.  Every wave
+     * store change goes through here too, since the images hold SAs.
+     * Off the audio thread only. */
+    void publishPatch()
+    {
+        scsp_patch_build(&fPatches[fBack], fOps, fNumOps, &fWaveStore);
+        fPatchBanks[fBack] = fTonBank.get();
+        fPatchKitVoices[fBack] = fKitVoice;
+        fBack = fMailbox.exchange(fBack | kFresh, std::memory_order_acq_rel) & 3;
+        if (!fRetiring.empty()) {
+            fRetired.insert(fRetired.end(), fRetiring.begin(), fRetiring.end());
+            fRetiring.clear();
+        }
+    }
+
+    /* The builder thread: merge the host's edits and publish them, a
+     * patch per wakeup however many edits arrived.  setParameterValue
+     * wakes it without the lock, so a wakeup can slip in before the wait;
+     * the timeout bounds that to a few milliseconds. */
+    void buildLoop()
+    {
+        std::unique_lock<std::mutex> lock(fPublishLock);
+        while (!fQuit) {
+            fWake.wait_for(lock, std::chrono::milliseconds(5), [this] {
+                return fQuit || fDirty.load(std::memory_order_acquire);
+            });
+            if (fQuit) break;
+            collectRetired();
+            if (!fDirty.exchange(false, std::memory_order_acq_rel)) continue;
+            mergeEdits();
+            rebuildOps();
+        }
+    }
+
+    /* Take the host's staged edits into fParams.  Program number picks
+     * the kit voice; editing anything else switches to the operator
+     * parameters. */
+    void mergeEdits()
+    {
+        for (int w = 0; w < 2; w++) {
+            uint64_t bits = fEdited[w].exchange(0, std::memory_order_acquire);
+            for (; bits; bits &= bits - 1) {
+                int i = w * 64 + __builtin_ctzll(bits);
+                fParams[i] = fHostParams[i].load(std::memory_order_relaxed);
+                fKitVoice = i == kProgramNumber ? (int)fParams[i] : -1;
+            }
+        }
+    }
+
+    /* Show the host what a state or program set */
+    void syncHostParams()
+    {
+        for (int i = 0; i < kActiveSlots; i++)
+            fHostParams[i].store(fParams[i], std::memory_order_relaxed);
+    }
+
+    /* Once run() has taken the last patch, nothing can start a note on
+     * the waves and kits it dropped; the store frees them when their
+     * tails finish (guard_playing).  Off the audio thread only. */
+    void collectRetired()
+    {
+        if (fRetired.empty() && fRetiredBanks.empty()) return;
+        if (fMailbox.load(std::memory_order_acquire) & kFresh) return;
+        for (int id : fRetired) scsp_wave_store_release(&fWaveStore, id);
+        fRetired.clear();
+        scsp_wave_store_release_old_kits(&fWaveStore);
+        fRetiredBanks.clear();
+    }
+
+    /* Drop a wave once the patches still using it are gone */
+    void retireWave(int id)
+    {
+        if (id >= 0) fRetiring.push_back(id);
+    }
+
+    /* Publish the usage outputs at the end of a block.  The loads are
+     * smoothed over roughly ten blocks so hosts polling at UI rate see a
+     * steady value; bars fall back to two-second windows without a
+     * transport. */
+    void updateOutputs(uint32_t frames, std::chrono::steady_clock::duration renderTime,
+                       uint32_t slotsPeak)
+    {
+        using namespace std::chrono;
+        double blockNs = frames * 1e9 / getSampleRate();
+        if (blockNs > 0) {
+            fRenderLoad += 0.1 * (duration_cast<nanoseconds>(renderTime).count() / blockNs - fRenderLoad);
+            fNoteOnLoad += 0.1 * (duration_cast<nanoseconds>(fNoteOnTime).count() / blockNs - fNoteOnLoad);
+        }
+
+        const TimePosition& pos = getTimePosition();
+        int64_t bar = pos.bbt.valid ? pos.bbt.bar : (int64_t)(fFramesRun / (uint64_t)(2 * getSampleRate()));
+        fFramesRun += frames;
+        if (bar != fBar) {
+            fBar = bar;
+            fLastBarPeak = fBarPeak;
+            fBarPeak = 0;
+        }
+        fBarPeak = std::max(fBarPeak, slotsPeak);
+
+        const float values[] = {
+            (float)__builtin_popcount(scsp_slots_playing()),
+            (float)std::max(fBarPeak, fLastBarPeak),
+            (float)fAlloc.stats.drops,
+            (float)fAlloc.stats.steals,
+            scsp_dsp_running() ? 1.f : 0.f,
+            (float)fRenderLoad,
+            (float)fNoteOnLoad,
+        };
+        for (int i = 0; i < kParameterCount - kActiveSlots; i++)
+            fOutputs[i].store(values[i], std::memory_order_relaxed);
+    }
+
+    /* Kit voice for the channel in multi-timbral mode, else the single
+     * kit voice; operators (-1) if the playing kit hasn't got it */
+    int kitVoice(int ch) const
+    {
+        const scsp_ton_bank_t *bank = fPatchBanks[fFront];
+        int voice = fMulti ? fChannelProgram[ch] : fPatchKitVoices[fFront];
+        return bank && voice >= 0 && voice < bank->num_voices ? voice : -1;
+    }
+
+    void noteOn(int ch, int key, int vel)
+    {
+        struct Timed {
+            std::chrono::steady_clock::duration& total;
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            ~Timed() { total += std::chrono::steady_clock::now() - t0; }
+        } timed { fNoteOnTime };
+
+        int voice = kitVoice(ch);
+        if (voice >= 0) {
+            scsp_voice_velocity(&fAlloc, scsp_voice_note_on_ton(&fAlloc, fPatchBanks[fFront], voice, key), vel);
+            return;
+        }
+        scsp_voice_velocity(&fAlloc, scsp_voice_note_on_patch(&fAlloc, &fPatches[fFront], key), vel);
     }
 
     void handleMidi(const MidiEvent& ev)
@@ -504,19 +910,42 @@ private:
         if (ev.size < 1) return;
         const uint8_t *d = ev.size > MidiEvent::kDataSize ? ev.dataExt : ev.data;
         uint8_t status = d[0] & 0xF0;
+        uint8_t ch     = d[0] & 0x0F;
         uint8_t note   = (ev.size > 1) ? d[1] : 0;
         uint8_t vel    = (ev.size > 2) ? d[2] : 0;
+        /* One chip, one 32-slot budget: in multi-timbral mode the channel
+         * is part of the key, so channels don't cut each other's notes */
+        int key = fMulti ? SCSP_VOICE_KEY(ch, note) : note;
+        int cch = fMulti ? ch : 0;   /* controller channel, as keys see it */
 
         switch (status) {
         case 0x90:
-            if (vel > 0) scsp_voice_note_on(&fAlloc, fOps, fNumOps, note, &fWaveStore);
-            else         scsp_voice_note_off(&fAlloc, note);
+            if (vel == 0) scsp_voice_note_off(&fAlloc, key);
+            else          noteOn(ch, key, vel);
             break;
         case 0x80:
-            scsp_voice_note_off(&fAlloc, note);
+            scsp_voice_note_off(&fAlloc, key);
             break;
         case 0xB0:
-            if (note == 120 || note == 123) scsp_voice_all_off(&fAlloc);
+            if (note == 1)        scsp_voice_modulation(&fAlloc, cch, vel);
+            else if (note == 7)   scsp_voice_volume(&fAlloc, cch, vel);
+            else if (note == 121) scsp_voice_reset_controllers(&fAlloc, cch);
+            else if (note == 120 || note == 123) {
+                if (fMulti) scsp_voice_channel_off(&fAlloc, ch);
+                else        scsp_voice_all_off(&fAlloc);
+            }
+            break;
+        case 0xE0: {
+            /* Kit voices carry their own bend range; patches bend ±2 */
+            int voice = kitVoice(ch);
+            const scsp_ton_bank_t *bank = fPatchBanks[fFront];
+            int range = voice >= 0 && bank->voices[voice].bend_range ? bank->voices[voice].bend_range : 2;
+            int bend = ((vel << 7) | note) - 8192;
+            scsp_voice_pitch_bend(&fAlloc, cch, bend * range * 100 / 8192);
+            break;
+        }
+        case 0xC0:
+            fChannelProgram[ch] = note & 0x7F;
             break;
         }
     }
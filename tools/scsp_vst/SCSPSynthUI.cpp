@@ -7,12 +7,34 @@
 
 #include "WebUI.hpp"
 #include "distrho/extra/Base64.hpp"
+#include <cstdio>
 #include <fstream>
 #include <string>
 #include <vector>
 
+#ifdef _WIN32
+# include <windows.h>
+#endif
+
 START_NAMESPACE_DISTRHO
 
+/* Move from over to in one step: to is the old file or the new one,
+ * never neither.  Paths are UTF-8. */
+static bool replaceFile(const char* from, const char* to) {
+#ifdef _WIN32
+    /* rename() won't replace an existing file on Windows */
+    auto wide = [](const char* s) {
+        std::wstring w(MultiByteToWideChar(CP_UTF8, 0, s, -1, nullptr, 0), L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, s, -1, &w[0], (int)w.size());
+        return w;
+    };
+    return MoveFileExW(wide(from).c_str(), wide(to).c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from, to) == 0;
+#endif
+}
+
 /* Base64 encode (not provided by DPF's Base64.hpp which only has decode) */
 static std::string encodeBase64(const uint8_t* data, size_t len) {
     static const char T[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -78,6 +100,53 @@ protected:
             f.close();
             callback("writeBinaryFile", Variant::createArray({ true }), origin);
         });
+
+        /* Chunked file I/O: the UI asks for the size, then moves the file
+         * a chunk at a time, so neither side ever holds the whole file as
+         * one base64 string.  The bridge only carries strings, hence the
+         * base64 per chunk. */
+        setFunctionHandler("fileSize", 1, [this](const Variant& args, uintptr_t origin) {
+            String path = args[0].getString();
+            std::ifstream f(static_cast<const char*>(path), std::ios::binary | std::ios::ate);
+            double size = f ? static_cast<double>(f.tellg()) : -1.0;
+            callback("fileSize", Variant::createArray({ size }), origin);
+        });
+
+        setFunctionHandler("readFileChunk", 3, [this](const Variant& args, uintptr_t origin) {
+            String path = args[0].getString();
+            std::streamoff offset = static_cast<std::streamoff>(args[1].getNumber());
+            size_t length = static_cast<size_t>(args[2].getNumber());
+            std::ifstream f(static_cast<const char*>(path), std::ios::binary);
+            std::vector<uint8_t> buf(length > kMaxChunk ? kMaxChunk : length);
+            if (!f || !f.seekg(offset) || !f.read(reinterpret_cast<char*>(buf.data()), buf.size())) {
+                callback("readFileChunk", Variant::createArray({ String("") }), origin);
+                return;
+            }
+            std::string b64str = encodeBase64(buf.data(), buf.size());
+            callback("readFileChunk", Variant::createArray({ String(b64str.c_str()) }), origin);
+        });
+
+        setFunctionHandler("writeFileChunk", 3, [this](const Variant& args, uintptr_t origin) {
+            String path = args[0].getString();
+            std::streamoff offset = static_cast<std::streamoff>(args[1].getNumber());
+            std::vector<uint8_t> raw = d_getChunkFromBase64String(args[2].getString());
+            /* Offset 0 starts the file over; later chunks extend it */
+            std::ofstream f(static_cast<const char*>(path), offset == 0
+                            ? std::ios::binary | std::ios::trunc
+                            : std::ios::binary | std::ios::in | std::ios::out);
+            bool ok = f && f.seekp(offset) &&
+                      f.write(reinterpret_cast<const char*>(raw.data()), raw.size());
+            callback("writeFileChunk", Variant::createArray({ ok }), origin);
+        });
+
+        /* Chunked writes go to a sibling file that this moves over the
+         * real one, so a failed write leaves the old file whole.  If the
+         * move fails both files stay as they are. */
+        setFunctionHandler("replaceFile", 2, [this](const Variant& args, uintptr_t origin) {
+            String from = args[0].getString(), to = args[1].getString();
+            bool ok = replaceFile(static_cast<const char*>(from), static_cast<const char*>(to));
+            callback("replaceFile", Variant::createArray({ ok }), origin);
+        });
     }
 
     void onMessageReceived(const Variant& payload, uintptr_t source) override
@@ -86,6 +155,8 @@ protected:
         (void)source;
     }
 
+    static constexpr size_t kMaxChunk = 1024 * 1024;
+
     DISTRHO_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SCSPSynthUI)
 };
 
@@ -0,0 +1,74 @@
+/*
+ * scsp_presets.h — Factory patches, shared by the plugin and test_plugin.
+ *
+ * Operators are ratio, level, AR/D1R/DL/D2R/RR, feedback, MDL, modulation
+ * source (-1 = none) and carrier flag, as the plugin's parameters hold them.
+ */
+
+#ifndef SCSP_PRESETS_H
+#define SCSP_PRESETS_H
+
+#include "scsp_voice.h"
+
+typedef struct {
+    const char *name;
+    int numOps;
+    struct { float ratio, level; int ar, d1r, dl, d2r, rr; float fb; int mdl, modSrc, isCarrier; } ops[SCSP_MAX_OPS];
+} Preset;
+
+static const Preset kPresets[] = {
+    { "Electric Piano", 2, {
+        { 2.0f, 0.9f, 31,12,8,0,14, 0.0f, 0,-1, 0 },
+        { 1.0f, 0.8f, 31, 6,2,0,14, 0.0f, 9, 0, 1 },
+    }},
+    { "Bell", 2, {
+        { 3.5f, 0.9f, 31, 4,2,0, 8, 0.0f, 0,-1, 0 },
+        { 1.0f, 0.7f, 31, 2,0,0, 6, 0.0f,11, 0, 1 },
+    }},
+    { "Brass", 2, {
+        { 1.0f, 0.8f, 24, 4,2,0,14, 0.3f, 0,-1, 0 },
+        { 1.0f, 0.8f, 22, 2,0,0,14, 0.0f, 9, 0, 1 },
+    }},
+    { "Organ", 2, {
+        { 1.0f, 0.7f, 31, 0,0,0,20, 0.6f, 0,-1, 0 },
+        { 1.0f, 0.8f, 31, 0,0,0,20, 0.0f, 8, 0, 1 },
+    }},
+    { "FM Bass", 2, {
+        { 1.0f, 0.9f, 31,14,10,0,14,0.2f, 0,-1, 0 },
+        { 1.0f, 0.9f, 31, 6, 4,0,14,0.0f,10, 0, 1 },
+    }},
+    { "Strings", 2, {
+        { 1.002f,0.5f, 20, 0,0,0,16, 0.0f, 0,-1, 0 },
+        { 1.0f, 0.7f, 18, 0,0,0,14, 0.0f, 7, 0, 1 },
+    }},
+    { "Clavinet", 2, {
+        { 3.0f, 0.9f, 31,16,14,0,18, 0.0f, 0,-1, 0 },
+        { 1.0f, 0.8f, 31,10, 6,0,16, 0.0f,10, 0, 1 },
+    }},
+    { "Marimba", 2, {
+        { 4.0f, 0.8f, 31,18,16,0,20, 0.0f, 0,-1, 0 },
+        { 1.0f, 0.8f, 31, 8, 4,0,12, 0.0f, 9, 0, 1 },
+    }},
+    { "Electric Piano 2", 3, {
+        { 14.0f, 0.4f, 31,14,12,0,16, 0.0f, 0,-1, 0 },
+        {  1.0f, 0.7f, 31,10, 6,0,14, 0.0f, 8, 0, 0 },
+        {  1.0f, 0.8f, 31, 4, 2,0,12, 0.0f, 9, 1, 1 },
+    }},
+    { "Metallic", 3, {
+        { 1.414f, 0.6f, 31, 6,3,0,10, 0.4f, 0,-1, 0 },
+        { 3.82f,  0.5f, 31, 8,4,0,12, 0.0f, 0,-1, 0 },
+        { 1.0f,   0.7f, 31, 4,2,0,10, 0.0f,10, 0, 1 },
+    }},
+    { "4-Op E.Piano", 4, {
+        { 5.0f, 0.3f, 31,16,14,0,16, 0.2f, 0,-1, 0 },
+        { 1.0f, 0.5f, 31,12, 8,0,14, 0.0f, 7, 0, 0 },
+        { 1.0f, 0.7f, 31, 8, 4,0,12, 0.0f, 8, 1, 0 },
+        { 1.0f, 0.8f, 31, 4, 2,0,12, 0.0f, 9, 2, 1 },
+    }},
+    { "Sine", 1, {
+        { 1.0f, 0.8f, 31, 0,0,0,14, 0.0f, 0,-1, 1 },
+    }},
+};
+static const int kNumPresets = sizeof(kPresets) / sizeof(kPresets[0]);
+
+#endif /* SCSP_PRESETS_H */
@@ -0,0 +1,292 @@
+/*
+ * scsp_state.c — Binary plugin state, see scsp_state.h for the layout.
+ */
+
+#include "scsp_state.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ── Helpers ──────────────────────────────────────────────────── */
+
+static uint32_t rd16(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8); }
+static uint32_t rd32(const uint8_t *p) { return rd16(p) | (rd16(p + 2) << 16); }
+
+static uint8_t *wr16(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *wr32(uint8_t *p, uint32_t v)
+{
+    return wr16(wr16(p, v & 0xFFFF), v >> 16);
+}
+
+static uint32_t pcm_hash(const int16_t *pcm, int length)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        h = (h ^ (uint8_t)(pcm[i] & 0xFF)) * 16777619u;
+        h = (h ^ (uint8_t)((pcm[i] >> 8) & 0xFF)) * 16777619u;
+    }
+    return h;
+}
+
+/* ── LZ ───────────────────────────────────────────────────────── */
+
+#define LZ_MIN_MATCH  4
+#define LZ_HASH_BITS  12
+
+size_t scsp_lz_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+/* 15 in a token nibble means more length follows in 255-capped bytes */
+static uint8_t *put_len(uint8_t *op, size_t n)
+{
+    while (n >= 255) { *op++ = 255; n -= 255; }
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+/* Literals, then a match unless match_len is 0 (the final sequence) */
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *lit, size_t num_lit,
+                             size_t match_len, size_t offset)
+{
+    size_t ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+    *op++ = (uint8_t)(((num_lit < 15 ? num_lit : 15) << 4) | (ml < 15 ? ml : 15));
+    if (num_lit >= 15) op = put_len(op, num_lit - 15);
+    memcpy(op, lit, num_lit);
+    op += num_lit;
+    if (match_len) {
+        op = wr16(op, (uint32_t)offset);
+        if (ml >= 15) op = put_len(op, ml - 15);
+    }
+    return op;
+}
+
+size_t scsp_lz_compress(const uint8_t *in, size_t size, uint8_t *out)
+{
+    uint32_t table[1 << LZ_HASH_BITS];   /* position + 1, 0 = none */
+    memset(table, 0, sizeof(table));
+    uint8_t *op = out;
+    size_t ip = 0, anchor = 0;
+
+    while (ip + LZ_MIN_MATCH <= size) {
+        uint32_t seq = rd32(in + ip);
+        uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        size_t cand = table[h];
+        table[h] = (uint32_t)ip + 1;
+        if (!cand || ip - (cand - 1) > 0xFFFF || rd32(in + cand - 1) != seq) {
+            ip++;
+            continue;
+        }
+        size_t ref = cand - 1, len = LZ_MIN_MATCH;
+        while (ip + len < size && in[ref + len] == in[ip + len]) len++;
+        op = put_sequence(op, in + anchor, ip - anchor, len, ip - ref);
+        ip += len;
+        anchor = ip;
+    }
+    op = put_sequence(op, in + anchor, size - anchor, 0, 0);
+    return (size_t)(op - out);
+}
+
+/* Read a nibble's extra length bytes; 0 on overrun */
+static int get_len(const uint8_t **ip, const uint8_t *end, size_t *n)
+{
+    uint8_t b;
+    do {
+        if (*ip >= end) return 0;
+        b = *(*ip)++;
+        *n += b;
+    } while (b == 255);
+    return 1;
+}
+
+long scsp_lz_decompress(const uint8_t *in, size_t size, uint8_t *out, size_t cap)
+{
+    const uint8_t *ip = in, *end = in + size;
+    size_t o = 0;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t num_lit = token >> 4;
+        if (num_lit == 15 && !get_len(&ip, end, &num_lit)) return -1;
+        if (num_lit > (size_t)(end - ip) || num_lit > cap - o) return -1;
+        memcpy(out + o, ip, num_lit);
+        ip += num_lit;
+        o += num_lit;
+        if (ip == end) break;   /* the final sequence has no match */
+
+        if (end - ip < 2) return -1;
+        size_t offset = rd16(ip);
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && !get_len(&ip, end, &len)) return -1;
+        len += LZ_MIN_MATCH;
+        if (!offset || offset > o || len > cap - o) return -1;
+        /* Byte by byte: a match may overlap what it produces */
+        for (size_t i = 0; i < len; i++, o++) out[o] = out[o - offset];
+    }
+    return (long)o;
+}
+
+/* ── Patch State ──────────────────────────────────────────────── */
+
+static size_t body_size(int num_params, const scsp_state_op_t *ops, int num_ops)
+{
+    size_t n = 8 + 4 * (size_t)num_params + 4 * (size_t)num_ops;
+    for (int i = 0; i < num_ops; i++)
+        if (ops[i].pcm && ops[i].length > 0) n += 8 + 2 * (size_t)ops[i].length;
+    return n;
+}
+
+size_t scsp_state_bound(int num_params, const scsp_state_op_t *ops, int num_ops)
+{
+    return SCSP_STATE_HEADER + scsp_lz_bound(body_size(num_params, ops, num_ops));
+}
+
+/* The body, with ops sharing PCM pointing at one wave; returns its size */
+static size_t write_body(uint8_t *out, const float *params, int num_params,
+                         const scsp_state_op_t *ops, int num_ops)
+{
+    int wave_of[256], num_waves = 0;
+    const scsp_state_op_t *waves[256];
+    if (num_ops > 256) num_ops = 256;
+
+    for (int i = 0; i < num_ops; i++) {
+        wave_of[i] = -1;
+        if (!ops[i].pcm || ops[i].length <= 0) continue;
+        for (int w = 0; w < num_waves && wave_of[i] < 0; w++)
+            if (waves[w]->length == ops[i].length &&
+                !memcmp(waves[w]->pcm, ops[i].pcm, 2 * (size_t)ops[i].length))
+                wave_of[i] = w;
+        if (wave_of[i] < 0) {
+            wave_of[i] = num_waves;
+            waves[num_waves++] = &ops[i];
+        }
+    }
+
+    uint8_t *p = out;
+    p = wr16(p, (uint32_t)num_params);
+    p = wr16(p, (uint32_t)num_ops);
+    p = wr16(p, (uint32_t)num_waves);
+    p = wr16(p, 0);
+    for (int i = 0; i < num_params; i++) {
+        uint32_t bits;
+        memcpy(&bits, &params[i], 4);
+        p = wr32(p, bits);
+    }
+    for (int i = 0; i < num_ops; i++) {
+        p = wr16(p, (uint32_t)(wave_of[i] & 0xFFFF));
+        *p++ = (uint8_t)ops[i].format;
+        *p++ = 0;
+    }
+    for (int w = 0; w < num_waves; w++) {
+        p = wr32(p, pcm_hash(waves[w]->pcm, waves[w]->length));
+        p = wr32(p, (uint32_t)waves[w]->length);
+        for (int i = 0; i < waves[w]->length; i++)
+            p = wr16(p, (uint16_t)waves[w]->pcm[i]);
+    }
+    return (size_t)(p - out);
+}
+
+size_t scsp_state_save(uint8_t *out, const float *params, int num_params,
+                       const scsp_state_op_t *ops, int num_ops, int compress)
+{
+    uint8_t *body = out + SCSP_STATE_HEADER;
+    size_t size = body_size(num_params, ops, num_ops), stored = 0;
+    uint16_t flags = 0;
+
+    if (compress) {
+        uint8_t *raw = (uint8_t *)malloc(size);
+        if (raw) {
+            size = write_body(raw, params, num_params, ops, num_ops);
+            stored = scsp_lz_compress(raw, size, body);
+            if (stored < size) {
+                flags |= SCSP_STATE_LZ;
+            } else {
+                memcpy(body, raw, size);
+                stored = size;
+            }
+            free(raw);
+        }
+    }
+    if (!stored) stored = size = write_body(body, params, num_params, ops, num_ops);
+
+    uint8_t *p = out;
+    p = wr32(p, SCSP_STATE_MAGIC);
+    p = wr16(p, SCSP_STATE_VERSION);
+    p = wr16(p, flags);
+    p = wr32(p, (uint32_t)size);
+    wr32(p, (uint32_t)stored);
+    return SCSP_STATE_HEADER + stored;
+}
+
+long scsp_state_body_size(const uint8_t *data, size_t size, int num_params, int num_ops)
+{
+    if (size < SCSP_STATE_HEADER || rd32(data) != SCSP_STATE_MAGIC) return -1;
+    uint32_t version = rd16(data + 4);
+    if (version < 1 || version > SCSP_STATE_VERSION) return -1;
+
+    /* The body is what the caller allocates: bound it by the most a
+     * save of this many params and ops can hold */
+    size_t body = rd32(data + 8), stored = rd32(data + 12);
+    size_t max = 8 + 4 * (size_t)num_params + (size_t)num_ops * (4 + 8 + 2 * SCSP_STATE_MAX_WAVE);
+    if (stored > size - SCSP_STATE_HEADER || body > max) return -2;
+    if (!(rd16(data + 6) & SCSP_STATE_LZ) && stored != body) return -2;
+    return (long)body;
+}
+
+int scsp_state_load(const uint8_t *data, size_t size, uint8_t *scratch,
+                    float *params, int num_params,
+                    scsp_state_op_t *ops, int num_ops)
+{
+    long body = scsp_state_body_size(data, size, num_params, num_ops);
+    if (body < 8) return -1;
+    size_t stored = rd32(data + 12);
+    if (rd16(data + 6) & SCSP_STATE_LZ) {
+        if (scsp_lz_decompress(data + SCSP_STATE_HEADER, stored, scratch, (size_t)body) != body)
+            return -1;
+    } else {
+        if (stored != (size_t)body) return -1;
+        memcpy(scratch, data + SCSP_STATE_HEADER, stored);
+    }
+
+    const uint8_t *p = scratch, *end = scratch + body;
+    int np = (int)rd16(p), no = (int)rd16(p + 2), nw = (int)rd16(p + 4);
+    p += 8;
+    if ((size_t)(end - p) < 4 * (size_t)np + 4 * (size_t)no) return -1;
+    for (int i = 0; i < np; i++, p += 4) {
+        uint32_t bits = rd32(p);
+        if (i < num_params) memcpy(&params[i], &bits, 4);
+    }
+    const uint8_t *op_recs = p;
+    p += 4 * (size_t)no;
+
+    /* Waves, indexed so the op records can point at them */
+    const int16_t *wave_pcm[256];
+    int wave_len[256];
+    if (nw > 256) return -1;
+    for (int w = 0; w < nw; w++) {
+        if (end - p < 8) return -1;
+        uint32_t hash = rd32(p), len = rd32(p + 4);
+        p += 8;
+        if (len > (size_t)(end - p) / 2) return -1;
+        wave_pcm[w] = (const int16_t *)p;
+        wave_len[w] = (int)len;
+        if (pcm_hash(wave_pcm[w], wave_len[w]) != hash) return -1;
+        p += 2 * (size_t)len;
+    }
+
+    for (int i = 0; i < no && i < num_ops; i++) {
+        int w = (int16_t)rd16(op_recs + 4 * i);
+        if (w >= nw) return -1;
+        ops[i].pcm = w >= 0 ? wave_pcm[w] : NULL;
+        ops[i].length = w >= 0 ? wave_len[w] : 0;
+        ops[i].format = op_recs[4 * i + 2];
+    }
+    return no < num_ops ? no : num_ops;
+}
@@ -0,0 +1,84 @@
+/*
+ * scsp_state.h — Binary plugin state: operator parameters plus custom PCM.
+ *
+ * Layout (all little-endian):
+ *
+ *   header   u32 magic "SCST", u16 version, u16 flags,
+ *            u32 body bytes, u32 stored bytes (== body unless SCSP_STATE_LZ)
+ *   body     u16 num_params, u16 num_ops, u16 num_waves, u16 0
+ *            f32 params[num_params]
+ *            per op:   i16 wave (index into the waves, -1 = none), u8 format, u8 0
+ *            per wave: u32 FNV-1a hash, u32 samples, i16 pcm[samples]
+ *
+ * Ops holding the same PCM share one wave record.  A reader accepts any
+ * version up to SCSP_STATE_VERSION; fields only ever get appended.
+ */
+
+#ifndef SCSP_STATE_H
+#define SCSP_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCSP_STATE_MAGIC    0x54534353u    /* "SCST" */
+#define SCSP_STATE_VERSION  1
+#define SCSP_STATE_LZ       0x0001         /* body is scsp_lz compressed */
+#define SCSP_STATE_HEADER   16
+#define SCSP_STATE_MAX_WAVE 0x10000        /* samples, as the wave store takes */
+
+/* One operator's custom wave, as saved or loaded */
+typedef struct {
+    const int16_t *pcm;     /* NULL = none */
+    int            length;  /* samples */
+    int            format;  /* scsp_pcm_format_t */
+} scsp_state_op_t;
+
+/* ── LZ ───────────────────────────────────────────────────────── */
+
+/*
+ * A byte-oriented LZ77 in the style of an LZ4 block: a token with the
+ * literal count and match length, the literals, a 16-bit match offset.
+ * No entropy coding, so decompression runs at memcpy speed.
+ */
+size_t scsp_lz_bound(size_t size);
+size_t scsp_lz_compress(const uint8_t *in, size_t size, uint8_t *out);
+
+/* Returns the decompressed size, or -1 if the input is corrupt or won't fit */
+long scsp_lz_decompress(const uint8_t *in, size_t size, uint8_t *out, size_t cap);
+
+/* ── Patch State ──────────────────────────────────────────────── */
+
+/* Most bytes scsp_state_save can write for these inputs */
+size_t scsp_state_bound(int num_params, const scsp_state_op_t *ops, int num_ops);
+
+/* Returns the bytes written to out */
+size_t scsp_state_save(uint8_t *out, const float *params, int num_params,
+                       const scsp_state_op_t *ops, int num_ops, int compress);
+
+/*
+ * Scratch bytes scsp_state_load needs for a saved state of up to
+ * num_params params and num_ops ops, waves of up to SCSP_STATE_MAX_WAVE
+ * samples.  -1 if data isn't one this reader understands (wrong magic,
+ * newer version), -2 if its header sizes are damaged or too big.
+ */
+long scsp_state_body_size(const uint8_t *data, size_t size, int num_params, int num_ops);
+
+/*
+ * Read a state.  Params and ops beyond what it holds are left alone; ops
+ * it holds without a wave get pcm = NULL.  Loaded pcm points into scratch,
+ * which must hold scsp_state_body_size bytes and be 2-byte aligned.
+ * Returns the number of ops read, or -1 if the data is corrupt.
+ */
+int scsp_state_load(const uint8_t *data, size_t size, uint8_t *scratch,
+                    float *params, int num_params,
+                    scsp_state_op_t *ops, int num_ops);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCSP_STATE_H */
@@ -16,9 +16,16 @@
 /* ── SCSP API (from scsp_wasm.c) ─────────────────────────────── */
 extern void     scsp_init(void);
 extern uint8_t *scsp_get_ram_ptr(void);
+extern uint32_t scsp_get_ram_size(void);
+extern void     scsp_ram_move(uint32_t dst, uint32_t src, uint32_t bytes);
+extern uint32_t scsp_slots_reading(uint32_t offset, uint32_t bytes);
 extern void     scsp_write_slot(int slot, int reg_word, uint16_t value);
+extern void     scsp_write_slot_image(int slot, const uint16_t *regs, int count);
 extern void     scsp_key_on(int slot);
 extern void     scsp_key_off(int slot);
+extern uint32_t scsp_slots_playing(void);
+extern int      scsp_slot_level(int slot);
+extern void     scsp_write_ton_layer(int slot, const scsp_ton_layer_t *layer, int note);
 
 /* ── Constants ────────────────────────────────────────────────── */
 
@@ -57,11 +64,53 @@ static int compute_mdl(int mod_tl, double target_beta)
     return mdl;
 }
 
+/* Controller curves */
+
+static uint16_t fns_cents[1024];    /* cents above the octave for each FNS */
+static uint16_t cents_fns[1200];    /* and back */
+static uint8_t  level_atten[128];   /* TL steps for a MIDI volume/velocity */
+static uint16_t mod_lfo[128];       /* LFOF/PLFOWS/PLFOS for a mod wheel value */
+
+static void init_curves(void)
+{
+    static int done;
+    if (done) return;
+    for (int f = 0; f < 1024; f++)
+        fns_cents[f] = (uint16_t)round(1200.0 * log2(1.0 + f / 1024.0));
+    for (int c = 0; c < 1200; c++) {
+        int f = (int)round(1024.0 * (pow(2.0, c / 1200.0) - 1.0));
+        cents_fns[c] = (uint16_t)(f > 1023 ? 1023 : f);
+    }
+    /* GM volume curve, 40·log10(v/127) dB, at ~0.375 dB per TL step */
+    level_atten[0] = 255;
+    for (int v = 1; v < 128; v++) {
+        int tl = (int)round(-40.0 * log10(v / 127.0) / 0.375);
+        level_atten[v] = (uint8_t)(tl > 255 ? 255 : tl);
+    }
+    /* Triangle vibrato at ~6 Hz (LFOF 20), PLFOS 1-4 (7-55 cents) */
+    for (int d = 1; d < 128; d++)
+        mod_lfo[d] = (uint16_t)((20 << 10) | (2 << 8) | ((1 + d * 4 / 128) << 5));
+    done = 1;
+}
+
+/* OCT/FNS word moved by cents, clamped to the chip's range */
+static uint16_t bend_pitch(uint16_t word, int cents)
+{
+    int oct = (word >> 11) & 0xF;
+    if (oct & 8) oct -= 16;
+    int c = oct * 1200 + fns_cents[word & 0x3FF] + cents;
+    oct = c >= 0 ? c / 1200 : -((-c + 1199) / 1200);
+    if (oct < -8) return (uint16_t)(8 << 11);
+    if (oct > 7)  return (uint16_t)((7 << 11) | 0x3FF);
+    return (uint16_t)(((oct & 0xF) << 11) | cents_fns[c - oct * 1200]);
+}
+
 /* ── Waveform Store ───────────────────────────────────────────── */
 
 void scsp_voice_init(scsp_wave_store_t *store)
 {
     scsp_init();
+    init_curves();
     memset(store, 0, sizeof(*store));
 
     /* Load all built-in waveforms into RAM */
@@ -76,50 +125,363 @@ void scsp_voice_init(scsp_wave_store_t *store)
         store->waves[i].loop_start = 0;
         store->waves[i].loop_end   = SCSP_WAVE_LEN;
         store->waves[i].loop_mode  = 1; /* forward loop */
+        store->waves[i].refs       = 1;
     }
     store->num_waves = SCSP_NUM_BUILTINS;
     store->next_free_offset = next_free;
+    store->custom_base = next_free;
+}
+
+/* FNV-1a over the wave as stored */
+static uint32_t wave_hash(const uint8_t *data, int bytes)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < bytes; i++)
+        h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+/* RAM a wave occupies, whole words so 16-bit waves stay aligned */
+static int wave_bytes(const scsp_waveform_t *w)
+{
+    return w->pcm8 ? (w->length + 1) & ~1 : w->length * 2;
+}
+
+static void give_ram(scsp_wave_store_t *store, int offset, int bytes);
+
+/* Free the pending blocks no slot reads any more */
+static void reclaim_ram(scsp_wave_store_t *store)
+{
+    int n = 0;
+    for (int i = 0; i < store->num_pending; i++) {
+        scsp_ram_extent_t e = store->pending[i];
+        if (scsp_slots_reading((uint32_t)e.offset, (uint32_t)e.size))
+            store->pending[n++] = e;
+        else
+            give_ram(store, e.offset, e.size);
+    }
+    store->num_pending = n;
+}
+
+/* First freed block that fits, else the top of the heap; -1 if neither */
+static int take_ram(scsp_wave_store_t *store, int bytes)
+{
+    if (store->num_pending) reclaim_ram(store);
+    for (int i = 0; i < store->num_holes; i++) {
+        scsp_ram_extent_t *h = &store->holes[i];
+        if (h->size < bytes) continue;
+        int offset = h->offset;
+        h->offset += bytes;
+        h->size -= bytes;
+        if (!h->size) {
+            memmove(h, h + 1, (size_t)(store->num_holes - i - 1) * sizeof(*h));
+            store->num_holes--;
+        }
+        return offset;
+    }
+    int offset = (store->next_free_offset + 1) & ~1;
+    if (offset + bytes > (int)scsp_get_ram_size()) return -1;
+    store->next_free_offset = offset + bytes;
+    return offset;
+}
+
+/* Return a block, merging it with its neighbours or lowering the top */
+static void give_ram(scsp_wave_store_t *store, int offset, int bytes)
+{
+    int i = 0;
+    while (i < store->num_holes && store->holes[i].offset < offset) i++;
+
+    if (i > 0 && store->holes[i - 1].offset + store->holes[i - 1].size == offset) {
+        i--;
+        store->holes[i].size += bytes;
+    } else {
+        if (store->num_holes > SCSP_MAX_WAVEFORMS) return;   /* can't happen: one hole per wave */
+        memmove(&store->holes[i + 1], &store->holes[i], (size_t)(store->num_holes - i) * sizeof(store->holes[0]));
+        store->holes[i].offset = offset;
+        store->holes[i].size = bytes;
+        store->num_holes++;
+    }
+    scsp_ram_extent_t *h = &store->holes[i];
+    if (i + 1 < store->num_holes && h->offset + h->size == h[1].offset) {
+        h->size += h[1].size;
+        memmove(h + 1, h + 2, (size_t)(store->num_holes - i - 2) * sizeof(*h));
+        store->num_holes--;
+    }
+    if (i == store->num_holes - 1 && h->offset + h->size == store->next_free_offset) {
+        store->next_free_offset = h->offset;
+        store->num_holes--;
+    }
+}
+
+void scsp_pcm8_requantize(const int16_t *in, int8_t *out, int length, int format)
+{
+    uint32_t seed = 0x2545F491u;
+    double err = 0.0;
+    for (int i = 0; i < length; i++) {
+        /* TPDF dither of +-1 LSB from two uniform draws */
+        seed = seed * 1664525u + 1013904223u;
+        double r1 = (seed >> 8) * (1.0 / 16777216.0);
+        seed = seed * 1664525u + 1013904223u;
+        double r2 = (seed >> 8) * (1.0 / 16777216.0);
+
+        double want = in[i] / 256.0;
+        double v = format == SCSP_PCM8_SHAPED ? want - err : want;
+        int q = (int)floor(v + r1 - r2 + 0.5);
+        if (q < -128) q = -128;
+        if (q > 127) q = 127;
+        err = q - v;
+        out[i] = (int8_t)q;
+    }
 }
 
 int scsp_wave_store_add(scsp_wave_store_t *store,
                         const int16_t *samples, int length,
                         int loop_start, int loop_end, int loop_mode)
 {
-    if (store->num_waves >= SCSP_MAX_WAVEFORMS) return -1;
-
-    int offset = store->next_free_offset;
-    /* Align to 2-byte boundary */
-    if (offset & 1) offset++;
+    return scsp_wave_store_add_format(store, samples, length,
+                                      loop_start, loop_end, loop_mode, SCSP_PCM16);
+}
 
-    /* Write samples to RAM (already LE int16) */
+int scsp_wave_store_add_format(scsp_wave_store_t *store,
+                               const int16_t *samples, int length,
+                               int loop_start, int loop_end, int loop_mode,
+                               int format)
+{
+    if (length <= 0 || length > 0x10000) return -1;
+    int pcm8 = format == SCSP_PCM8_DITHER || format == SCSP_PCM8_SHAPED;
+
+    /* The wave as it will sit in RAM: 16-bit is LE, and 8-bit samples
+     * are byte-swapped within each word, as the core reads them */
+    static uint8_t data[0x20000];
+    int bytes;
+    if (pcm8) {
+        int8_t *q = (int8_t *)data + 0x10000;
+        scsp_pcm8_requantize(samples, q, length, format);
+        bytes = (length + 1) & ~1;
+        data[bytes - 2] = 0;
+        for (int i = 0; i < length; i++)
+            data[i ^ 1] = (uint8_t)q[i];
+    } else {
+        for (int i = 0; i < length; i++) {
+            data[i * 2]     = (uint8_t)(samples[i] & 0xFF);
+            data[i * 2 + 1] = (uint8_t)((samples[i] >> 8) & 0xFF);
+        }
+        bytes = length * 2;
+    }
     uint8_t *ram = scsp_get_ram_ptr();
-    for (int i = 0; i < length; i++) {
-        int16_t val = samples[i];
-        ram[offset + i * 2]     = (uint8_t)(val & 0xFF);
-        ram[offset + i * 2 + 1] = (uint8_t)((val >> 8) & 0xFF);
+    uint32_t hash = wave_hash(data, bytes);
+
+    /* Share an identical wave */
+    int id = -1;
+    for (int i = SCSP_NUM_BUILTINS; i < store->num_waves; i++) {
+        scsp_waveform_t *w = &store->waves[i];
+        if (!w->length) { if (id < 0) id = i; continue; }
+        if (w->length == length && w->pcm8 == pcm8 && w->hash == hash &&
+            w->loop_start == loop_start && w->loop_end == loop_end &&
+            w->loop_mode == loop_mode && !memcmp(ram + w->ram_offset, data, (size_t)bytes)) {
+            w->refs++;
+            return i;
+        }
+    }
+    if (id < 0) {
+        if (store->num_waves >= SCSP_MAX_WAVEFORMS) return -1;
+        id = store->num_waves;
+    }
+
+    scsp_waveform_t *w = &store->waves[id];
+    w->length = length;
+    w->pcm8   = pcm8;
+    int offset = take_ram(store, wave_bytes(w));
+    /* Another thread may still start notes from images holding the old
+     * SAs, so with guard_playing only the owner can decide to compact */
+    if (offset < 0 && !store->guard_playing) {
+        w->length = 0;   /* not yet a wave: compaction must skip it */
+        if (scsp_wave_store_compact(store) > 0) {
+            w->length = length;
+            offset = take_ram(store, wave_bytes(w));
+        }
+    }
+    if (offset < 0) {
+        w->length = 0;
+        return -1;
     }
+    memcpy(ram + offset, data, (size_t)bytes);
 
-    int id = store->num_waves;
-    store->waves[id].ram_offset = offset;
-    store->waves[id].length     = length;
-    store->waves[id].loop_start = loop_start;
-    store->waves[id].loop_end   = loop_end;
-    store->waves[id].loop_mode  = loop_mode;
-    store->num_waves++;
-    store->next_free_offset = offset + length * 2;
+    w->ram_offset = offset;
+    w->length     = length;
+    w->loop_start = loop_start;
+    w->loop_end   = loop_end;
+    w->loop_mode  = loop_mode;
+    w->hash       = hash;
+    w->refs       = 1;
+    if (id == store->num_waves) store->num_waves++;
 
     return id;
 }
 
+/* Free a block now, or once no slot reads it (guard_playing) */
+static void release_ram(scsp_wave_store_t *store, int offset, int bytes)
+{
+    if (store->guard_playing && store->num_pending < SCSP_MAX_WAVEFORMS &&
+        scsp_slots_reading((uint32_t)offset, (uint32_t)bytes)) {
+        store->pending[store->num_pending].offset = offset;
+        store->pending[store->num_pending].size = bytes;
+        store->num_pending++;
+    } else {
+        give_ram(store, offset, bytes);
+    }
+}
+
+void scsp_wave_store_release(scsp_wave_store_t *store, int id)
+{
+    if (id < SCSP_NUM_BUILTINS || id >= store->num_waves) return;
+    scsp_waveform_t *w = &store->waves[id];
+    if (!w->length || --w->refs > 0) return;
+
+    release_ram(store, w->ram_offset, wave_bytes(w));
+    w->length = 0;
+    while (store->num_waves > SCSP_NUM_BUILTINS && !store->waves[store->num_waves - 1].length)
+        store->num_waves--;
+}
+
+int scsp_wave_store_compact(scsp_wave_store_t *store)
+{
+    /* Custom waves (id >= 0), pending blocks and replaced kits (id -1)
+     * by RAM offset */
+    struct { int offset, bytes, id; } items[2 * SCSP_MAX_WAVEFORMS + SCSP_MAX_OLD_KITS];
+    int n = 0, moved = 0;
+    int kit = store->kit_end > 0;
+
+    if (store->num_pending) reclaim_ram(store);
+    for (int i = -store->num_pending - store->num_old_kits; i < store->num_waves; i++) {
+        int offset, bytes;
+        if (i < -store->num_pending) {
+            offset = store->old_kits[-1 - store->num_pending - i].offset;
+            bytes = store->old_kits[-1 - store->num_pending - i].size;
+        } else if (i < 0) {
+            offset = store->pending[-1 - i].offset;
+            bytes = store->pending[-1 - i].size;
+        } else {
+            if (i < SCSP_NUM_BUILTINS || !store->waves[i].length) continue;
+            offset = store->waves[i].ram_offset;
+            bytes = wave_bytes(&store->waves[i]);
+        }
+        int j = n++;
+        while (j > 0 && items[j - 1].offset > offset) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j].offset = offset;
+        items[j].bytes = bytes;
+        items[j].id = i < 0 ? -1 : i;
+    }
+
+    int cursor = store->custom_base;
+    store->num_holes = 0;
+    for (int k = 0; k < n; k++) {
+        int offset = items[k].offset, bytes = items[k].bytes;
+        /* Blocks a slot may be reading stay where they are */
+        int fixed = items[k].id < 0 || (store->guard_playing &&
+                    scsp_slots_reading((uint32_t)offset, (uint32_t)bytes));
+        /* The kit can't move: skip over it once a wave no longer fits below */
+        if (kit && cursor < store->kit_end &&
+            (fixed ? offset >= store->kit_offset : cursor + bytes > store->kit_offset)) {
+            if (cursor < store->kit_offset) give_ram(store, cursor, store->kit_offset - cursor);
+            cursor = store->kit_end;
+        }
+        if (fixed) {
+            if (cursor < offset) give_ram(store, cursor, offset - cursor);
+            cursor = offset + bytes;
+            continue;
+        }
+        scsp_waveform_t *w = &store->waves[items[k].id];
+        if (w->ram_offset != cursor) {
+            scsp_ram_move((uint32_t)cursor, (uint32_t)w->ram_offset, (uint32_t)bytes);
+            w->ram_offset = cursor;
+            moved++;
+        }
+        cursor += bytes;
+    }
+    if (kit && cursor < store->kit_end) {
+        if (cursor < store->kit_offset) give_ram(store, cursor, store->kit_offset - cursor);
+        cursor = store->kit_end;
+    }
+    store->next_free_offset = cursor;
+    return moved;
+}
+
+int scsp_wave_store_load_ton(scsp_wave_store_t *store, scsp_ton_bank_t *bank,
+                             const uint8_t *ton, uint32_t size)
+{
+    /* Reuse the old kit's space if nothing was stored after it, unless
+     * another thread may still start notes on the old kit */
+    int offset = store->next_free_offset;
+    if (store->kit_end > 0 && store->kit_end == store->next_free_offset && !store->guard_playing)
+        offset = store->kit_offset;
+    if (offset & 1) offset++;
+    if (store->guard_playing && store->kit_end > 0 && store->num_old_kits == SCSP_MAX_OLD_KITS)
+        return SCSP_TON_ERR_RAM;
+
+    int end = scsp_ton_load(bank, scsp_get_ram_ptr(), 512 * 1024, ton, size, (uint32_t)offset);
+    if (end < 0) return end;
+
+    /* Otherwise the old kit's space becomes a free block, or is held
+     * until the caller says its bank is gone */
+    int old_offset = store->kit_offset, old_end = store->kit_end;
+    store->kit_offset = offset;
+    store->kit_end = end;
+    store->next_free_offset = end;
+    if (old_end > 0 && old_offset != offset) {
+        if (store->guard_playing) {
+            store->old_kits[store->num_old_kits].offset = old_offset;
+            store->old_kits[store->num_old_kits].size = old_end - old_offset;
+            store->num_old_kits++;
+        } else {
+            give_ram(store, old_offset, old_end - old_offset);
+        }
+    }
+    return bank->num_voices;
+}
+
+void scsp_wave_store_release_old_kits(scsp_wave_store_t *store)
+{
+    for (int i = 0; i < store->num_old_kits; i++)
+        release_ram(store, store->old_kits[i].offset, store->old_kits[i].size);
+    store->num_old_kits = 0;
+}
+
 /* ── Slot Programming ─────────────────────────────────────────── */
 
-void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
-                       const scsp_fm_op_t *all_ops, int num_ops,
-                       const scsp_wave_store_t *store)
+/* Note at which the operator plays OCT 0 FNS 0 */
+static double op_base_note(const scsp_fm_op_t *op)
+{
+    if (op->freq_fixed > 0)
+        return SINE_BASE_NOTE + 12.0 * log2(op->freq_fixed / SCSP_SINE_BASE_FREQ);
+    return SINE_BASE_NOTE - 12.0 * log2(op->freq_ratio > 0 ? op->freq_ratio : 1.0);
+}
+
+static uint16_t op_pitch(double base_note, int midi_note)
+{
+    double semi = midi_note - base_note;
+    int octave = (int)floor(semi / 12.0);
+    if (octave < -8) octave = -8;
+    if (octave > 7)  octave = 7;
+    double frac = semi - octave * 12.0;
+    int fns = (int)round(1024.0 * (pow(2.0, frac / 12.0) - 1.0));
+    if (fns < 0) fns = 0;
+    if (fns > 1023) fns = 1023;
+
+    return (uint16_t)(((octave & 0xF) << 11) | (fns & 0x3FF));
+}
+
+/* Every slot word except the pitch, which depends on the note */
+static void op_image(scsp_op_image_t *img, const scsp_fm_op_t *op,
+                     const scsp_fm_op_t *all_ops, int num_ops,
+                     const scsp_wave_store_t *store)
 {
     /* Look up waveform from store */
     int wid = op->waveform_id;
-    if (wid < 0 || wid >= store->num_waves) wid = 0;
+    if (wid < 0 || wid >= store->num_waves || !store->waves[wid].length) wid = 0;
     const scsp_waveform_t *wav = &store->waves[wid];
 
     /* Resolve loop points (per-op override or waveform default) */
@@ -130,6 +492,7 @@ void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
     if (lsa > wav->length) lsa = wav->length;
     if (lea > wav->length) lea = wav->length;
     int sa     = wav->ram_offset;
+    int pcm8   = wav->pcm8;
 
     /* FM constraint: if this operator participates in FM (modulator, or carrier
      * receiving modulation), enforce 1024-sample forward loop.
@@ -141,31 +504,13 @@ void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
         if (wav->length != SCSP_WAVE_LEN) {
             /* Fallback to sine if the selected waveform isn't 1024 */
             sa = store->waves[SCSP_WAVE_SINE].ram_offset;
+            pcm8 = 0;
         }
         lsa = 0;
         lea = SCSP_WAVE_LEN;
         lpctl = 1;
     }
 
-    /* ── Pitch: OCT/FNS ── */
-    double op_base_note;
-    if (op->freq_fixed > 0) {
-        op_base_note = SINE_BASE_NOTE + 12.0 * log2(op->freq_fixed / SCSP_SINE_BASE_FREQ);
-    } else {
-        op_base_note = SINE_BASE_NOTE - 12.0 * log2(op->freq_ratio > 0 ? op->freq_ratio : 1.0);
-    }
-
-    double semi = midi_note - op_base_note;
-    int octave = (int)floor(semi / 12.0);
-    if (octave < -8) octave = -8;
-    if (octave > 7)  octave = 7;
-    double frac = semi - octave * 12.0;
-    int fns = (int)round(1024.0 * (pow(2.0, frac / 12.0) - 1.0));
-    if (fns < 0) fns = 0;
-    if (fns > 1023) fns = 1023;
-
-    uint16_t oct_bits = (uint16_t)(((octave & 0xF) << 11) | (fns & 0x3FF));
-
     /* ── TL ── */
     int tl;
     if (op->is_carrier) {
@@ -185,6 +530,7 @@ void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
 
     /* ── FM Modulation ── */
     int mdl = 0, mdxsl = 0, mdysl = 0;
+    img->xsl_op = img->ysl_op = -1;
 
     if (op->mod_source >= 0 && op->mdl >= 5 && op->mod_source < num_ops) {
         const scsp_fm_op_t *mod_op = &all_ops[op->mod_source];
@@ -193,9 +539,8 @@ void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
         if (target_beta > 2.5) target_beta = 2.5;
         mdl = compute_mdl(mod_tl, target_beta);
 
-        int dist = (op->mod_source - slot) & 63;
-        mdxsl = dist;
-        mdysl = dist;
+        /* Slot distance: filled in by write_image */
+        img->xsl_op = img->ysl_op = (int8_t)op->mod_source;
     }
 
     if (op->feedback > 0.0f) {
@@ -205,107 +550,420 @@ void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
 
         if (mdl > 0) {
             mdysl = fb_dist;
+            img->ysl_op = -1;
             if (fb_mdl > mdl) mdl = fb_mdl;
         } else {
             mdl = fb_mdl;
             mdxsl = fb_dist;
             mdysl = fb_dist;
+            img->xsl_op = img->ysl_op = -1;
         }
     }
 
-    uint16_t d7 = (uint16_t)(((mdl & 0xF) << 12) |
-                              ((mdxsl & 0x3F) << 6) |
-                              (mdysl & 0x3F));
-
     /* ── Output ── */
     int disdl = op->is_carrier ? 7 : 0;
-    uint16_t d_b = (uint16_t)(((disdl & 0x7) << 13) | ((16 & 0x1F) << 8));
-
-    /* ── SA encoding ── */
-    uint16_t d0 = (uint16_t)((lpctl << 5) | ((sa >> 16) & 0xF));
-    uint16_t d1 = (uint16_t)(sa & 0xFFFF);
-
-    /* ── Write all slot registers ── */
-    scsp_write_slot(slot, 0x0, d0);
-    scsp_write_slot(slot, 0x1, d1);
-    scsp_write_slot(slot, 0x2, (uint16_t)lsa);
-    scsp_write_slot(slot, 0x3, (uint16_t)lea);
-    scsp_write_slot(slot, 0x4, d4);
-    scsp_write_slot(slot, 0x5, d5);
-    scsp_write_slot(slot, 0x6, (uint16_t)(tl & 0xFF));
-    scsp_write_slot(slot, 0x7, d7);
-    scsp_write_slot(slot, 0x8, oct_bits);
-    scsp_write_slot(slot, 0x9, 0x0000);
-    scsp_write_slot(slot, 0xA, 0x0000);
-    scsp_write_slot(slot, 0xB, d_b);
+
+    img->regs[0x0] = (uint16_t)((lpctl << 5) | (pcm8 << 4) | ((sa >> 16) & 0xF));
+    img->regs[0x1] = (uint16_t)(sa & 0xFFFF);
+    img->regs[0x2] = (uint16_t)lsa;
+    img->regs[0x3] = (uint16_t)lea;
+    img->regs[0x4] = d4;
+    img->regs[0x5] = d5;
+    img->regs[0x6] = (uint16_t)(tl & 0xFF);
+    img->regs[0x7] = (uint16_t)(((mdl & 0xF) << 12) | ((mdxsl & 0x3F) << 6) | (mdysl & 0x3F));
+    img->regs[0x8] = 0x0000;
+    img->regs[0x9] = 0x0000;
+    img->regs[0xA] = 0x0000;
+    img->regs[0xB] = (uint16_t)(((disdl & 0x7) << 13) | ((16 & 0x1F) << 8));
 }
 
-/* ── Voice Allocation ─────────────────────────────────────────── */
+/* Copy an image into a slot with its pitch and slot distances filled in */
+static void write_image(int slot, const scsp_op_image_t *img, uint16_t pitch)
+{
+    uint16_t regs[12];
+    memcpy(regs, img->regs, sizeof(regs));
+    regs[0x8] = pitch;
+    if (img->xsl_op >= 0) regs[0x7] |= (uint16_t)(((img->xsl_op - slot) & 63) << 6);
+    if (img->ysl_op >= 0) regs[0x7] |= (uint16_t)((img->ysl_op - slot) & 63);
+    scsp_write_slot_image(slot, regs, 12);
+}
 
-int scsp_voice_note_on(scsp_voice_alloc_t *alloc, const scsp_fm_op_t *ops,
-                       int num_ops, int midi_note, const scsp_wave_store_t *store)
+void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
+                       const scsp_fm_op_t *all_ops, int num_ops,
+                       const scsp_wave_store_t *store)
 {
-    if (num_ops < 1 || num_ops > SCSP_MAX_OPS) return -1;
+    scsp_op_image_t img;
+    op_image(&img, op, all_ops, num_ops, store);
+    write_image(slot, &img, op_pitch(op_base_note(op), midi_note));
+}
 
-    int base = -1;
-    for (int s = 0; s <= SCSP_MAX_SLOTS - num_ops; s++) {
-        int ok = 1;
-        for (int i = 0; i < num_ops; i++)
-            if (alloc->slot_used[s + i]) { ok = 0; break; }
-        if (ok) { base = s; break; }
-    }
-    if (base < 0) return -1;
+int scsp_patch_build(scsp_patch_t *patch, const scsp_fm_op_t *ops, int num_ops,
+                     const scsp_wave_store_t *store)
+{
+    if (num_ops < 1 || num_ops > SCSP_MAX_OPS) return -1;
 
     for (int i = 0; i < num_ops; i++) {
-        scsp_program_slot(base + i, &ops[i], midi_note, ops, num_ops, store);
-        alloc->slot_used[base + i] = 1;
+        scsp_op_image_t *img = &patch->ops[i];
+        double base = op_base_note(&ops[i]);
+        op_image(img, &ops[i], ops, num_ops, store);
+        for (int n = 0; n < 128; n++)
+            img->pitch[n] = op_pitch(base, n);
     }
+    patch->num_ops = num_ops;
+    return 0;
+}
 
-    for (int i = 0; i < num_ops; i++)
-        scsp_key_on(base + i);
+/* ── Voice Allocation ─────────────────────────────────────────── */
 
-    int vi = alloc->num_voices;
-    if (vi >= SCSP_MAX_SLOTS) return -1;
-    alloc->voices[vi].active = 1;
-    alloc->voices[vi].midi_note = midi_note;
-    alloc->voices[vi].slot_base = base;
-    alloc->voices[vi].num_ops = num_ops;
-    alloc->num_voices++;
+static uint32_t run_mask(int n)
+{
+    return n >= 32 ? 0xFFFFFFFFu : (1u << n) - 1;
+}
 
-    return vi;
+static uint32_t voice_slots(const scsp_voice_t *v)
+{
+    return run_mask(v->num_ops) << v->slot_base;
+}
+
+/* Lowest base of n consecutive clear bits, or -1.  Each AND keeps only the
+ * bits whose next i slots are free too, so what survives are run starts. */
+static int find_free_run(uint32_t used, int n)
+{
+    uint32_t free_slots = ~used, starts = free_slots;
+    for (int i = 1; i < n; i++) starts &= free_slots >> i;
+    return starts ? __builtin_ctz(starts) : -1;
+}
+
+static void free_voice(scsp_voice_alloc_t *alloc, int vi)
+{
+    scsp_voice_t *v = &alloc->voices[vi];
+    if (alloc->note_voice[v->key] == vi + 1) alloc->note_voice[v->key] = 0;
+    alloc->slot_used &= ~voice_slots(v);
+    alloc->voice_used &= ~(1u << vi);
+}
+
+static void release_voice(scsp_voice_alloc_t *alloc, int vi)
+{
+    scsp_voice_t *v = &alloc->voices[vi];
+    if (v->released) return;
+    for (int i = 0; i < v->num_ops; i++)
+        scsp_key_off(v->slot_base + i);
+    if (alloc->note_voice[v->key] == vi + 1) alloc->note_voice[v->key] = 0;
+    v->released = 1;
+    /* Keyed-off slots go back to the pool at once, tail and all */
+    if (alloc->steal_mode == SCSP_STEAL_KEYOFF_FREE) free_voice(alloc, vi);
+}
+
+/* Free voices whose slots have all finished their envelopes */
+static void reap_voices(scsp_voice_alloc_t *alloc)
+{
+    uint32_t playing = scsp_slots_playing();
+    for (uint32_t m = alloc->voice_used; m; m &= m - 1) {
+        int vi = __builtin_ctz(m);
+        if (!(playing & voice_slots(&alloc->voices[vi]))) free_voice(alloc, vi);
+    }
 }
 
-void scsp_voice_note_off(scsp_voice_alloc_t *alloc, int midi_note)
+/* Lower is stolen first; ties go to the older voice */
+static uint64_t steal_rank(const scsp_voice_alloc_t *alloc, const scsp_voice_t *v)
 {
-    for (int vi = 0; vi < alloc->num_voices; vi++) {
-        scsp_voice_t *v = &alloc->voices[vi];
-        if (!v->active || v->midi_note != midi_note) continue;
+    uint64_t key = 0;
+    switch (alloc->steal_mode) {
+    case SCSP_STEAL_OLDEST:
+    case SCSP_STEAL_KEYOFF_FREE:
+        break;
+    case SCSP_STEAL_QUIETEST:
         for (int i = 0; i < v->num_ops; i++) {
-            scsp_key_off(v->slot_base + i);
-            alloc->slot_used[v->slot_base + i] = 0;
+            int level = scsp_slot_level(v->slot_base + i);
+            if ((uint64_t)level > key) key = (uint64_t)level;
         }
-        v->active = 0;
+        break;
+    default:
+        key = !v->released;
+        break;
     }
-    int write = 0;
-    for (int read = 0; read < alloc->num_voices; read++) {
-        if (alloc->voices[read].active) {
-            if (write != read) alloc->voices[write] = alloc->voices[read];
-            write++;
+    return key << 32 | v->age;
+}
+
+/* Count a note that found no room */
+static int drop_note(scsp_voice_alloc_t *alloc, int key)
+{
+    alloc->stats.drops++;
+    alloc->stats.last_key = key;
+    alloc->stats.last_slot = -1;
+    return -1;
+}
+
+/* Base of a free run of n slots.  When none is free, pick the run whose
+ * most valuable occupant ranks lowest and steal only the voices in it, so
+ * nothing outside the run is silenced. */
+static int alloc_slots(scsp_voice_alloc_t *alloc, int key, int n)
+{
+    int reserved = alloc->reserved_slots < 0 ? 0 : alloc->reserved_slots > 32 ? 32 : alloc->reserved_slots;
+    int limit = 32 - reserved;
+    uint32_t blocked = reserved == 0 ? 0 : reserved == 32 ? 0xFFFFFFFFu : ~0u << limit;
+    uint64_t rank[SCSP_MAX_SLOTS];
+    int base = -1, victims = 0;
+    uint64_t cost = 0;
+
+    if (n > limit) return drop_note(alloc, key);
+    reap_voices(alloc);
+    if ((base = find_free_run(alloc->slot_used | blocked, n)) >= 0)
+        return base;
+
+    for (uint32_t m = alloc->voice_used; m; m &= m - 1) {
+        int vi = __builtin_ctz(m);
+        rank[vi] = steal_rank(alloc, &alloc->voices[vi]);
+    }
+    /* Cost of a run is its highest-ranked occupant; ties go to fewer victims */
+    for (int b = 0; b + n <= limit; b++) {
+        uint32_t run = run_mask(n) << b;
+        uint64_t c = 0;
+        int count = 0;
+        for (uint32_t m = alloc->voice_used; m; m &= m - 1) {
+            int vi = __builtin_ctz(m);
+            if (!(voice_slots(&alloc->voices[vi]) & run)) continue;
+            if (rank[vi] > c) c = rank[vi];
+            count++;
         }
+        if (count == 0) continue;
+        if (base < 0 || c < cost || (c == cost && count < victims)) {
+            base = b; cost = c; victims = count;
+        }
+    }
+    if (base < 0) return drop_note(alloc, key);
+
+    for (uint32_t m = alloc->voice_used; m; m &= m - 1) {
+        int vi = __builtin_ctz(m);
+        if (!(voice_slots(&alloc->voices[vi]) & (run_mask(n) << base))) continue;
+        alloc->stats.steals++;
+        alloc->stats.last_key = alloc->voices[vi].key;
+        alloc->stats.last_slot = alloc->voices[vi].slot_base;
+        release_voice(alloc, vi);
+        free_voice(alloc, vi);
     }
-    alloc->num_voices = write;
+    return base;
 }
 
-void scsp_voice_all_off(scsp_voice_alloc_t *alloc)
+/* ── Controllers ──────────────────────────────────────────────── */
+
+/* Rewrite only the registers `what` covers on each keyed slot of a voice */
+static void update_voice(scsp_voice_alloc_t *alloc, int vi, int what)
 {
-    for (int vi = 0; vi < alloc->num_voices; vi++) {
-        scsp_voice_t *v = &alloc->voices[vi];
-        if (!v->active) continue;
-        for (int i = 0; i < v->num_ops; i++) {
-            scsp_key_off(v->slot_base + i);
-            alloc->slot_used[v->slot_base + i] = 0;
+    const scsp_voice_t *v = &alloc->voices[vi];
+    int ch = v->key >> 7;
+
+    for (uint32_t m = v->keyed; m; m &= m - 1) {
+        int s = __builtin_ctz(m);
+        if (what & SCSP_CTRL_PITCH) {
+            int cents = alloc->bend_cents[ch];
+            scsp_write_slot(s, 0x8, cents ? bend_pitch(alloc->slot_pitch[s], cents) : alloc->slot_pitch[s]);
         }
-        v->active = 0;
+        if (what & SCSP_CTRL_LEVEL) {
+            int tl = alloc->slot_tl[s] & 0xFF;
+            if (alloc->slot_audible & (1u << s)) tl += alloc->volume_atten[ch] + v->vel_atten;
+            if (tl > 255) tl = 255;
+            scsp_write_slot(s, 0x6, (uint16_t)((alloc->slot_tl[s] & 0xFF00) | tl));
+        }
+        if (what & SCSP_CTRL_LFO) {
+            int depth = alloc->mod_depth[ch];
+            uint16_t lfo = alloc->slot_lfo[s];
+            scsp_write_slot(s, 0x9, depth ? (uint16_t)((lfo & 0x001F) | mod_lfo[depth]) : lfo);
+        }
+    }
+}
+
+static void update_channel(scsp_voice_alloc_t *alloc, int channel, int what)
+{
+    for (uint32_t m = alloc->voice_used; m; m &= m - 1) {
+        int vi = __builtin_ctz(m);
+        if ((alloc->voices[vi].key >> 7) == channel) update_voice(alloc, vi, what);
+    }
+}
+
+void scsp_voice_velocity(scsp_voice_alloc_t *alloc, int voice, int velocity)
+{
+    if (voice < 0 || voice >= SCSP_MAX_SLOTS || !(alloc->voice_used & (1u << voice))) return;
+    uint8_t atten = level_atten[velocity < 0 ? 0 : velocity > 127 ? 127 : velocity];
+    if (alloc->voices[voice].vel_atten == atten) return;
+    alloc->voices[voice].vel_atten = atten;
+    update_voice(alloc, voice, SCSP_CTRL_LEVEL);
+}
+
+void scsp_voice_pitch_bend(scsp_voice_alloc_t *alloc, int channel, int cents)
+{
+    channel &= 15;
+    if (alloc->bend_cents[channel] == cents) return;
+    alloc->bend_cents[channel] = (int16_t)cents;
+    update_channel(alloc, channel, SCSP_CTRL_PITCH);
+}
+
+void scsp_voice_volume(scsp_voice_alloc_t *alloc, int channel, int volume)
+{
+    channel &= 15;
+    uint8_t atten = level_atten[volume < 0 ? 0 : volume > 127 ? 127 : volume];
+    if (alloc->volume_atten[channel] == atten) return;
+    alloc->volume_atten[channel] = atten;
+    update_channel(alloc, channel, SCSP_CTRL_LEVEL);
+}
+
+void scsp_voice_modulation(scsp_voice_alloc_t *alloc, int channel, int depth)
+{
+    channel &= 15;
+    depth = depth < 0 ? 0 : depth > 127 ? 127 : depth;
+    if (alloc->mod_depth[channel] == depth) return;
+    alloc->mod_depth[channel] = (uint8_t)depth;
+    update_channel(alloc, channel, SCSP_CTRL_LFO);
+}
+
+void scsp_voice_reset_controllers(scsp_voice_alloc_t *alloc, int channel)
+{
+    scsp_voice_pitch_bend(alloc, channel, 0);
+    scsp_voice_volume(alloc, channel, 127);
+    scsp_voice_modulation(alloc, channel, 0);
+}
+
+/* Claim the slots and a voice entry.  Every voice holds at least one slot,
+ * so a free entry always exists once a run was found. */
+static int add_voice(scsp_voice_alloc_t *alloc, int key, int base, int num_ops,
+                     uint32_t keyed)
+{
+    int vi = __builtin_ctz(~alloc->voice_used);
+    scsp_voice_t *v = &alloc->voices[vi];
+    v->key = key;
+    v->slot_base = base;
+    v->num_ops = num_ops;
+    v->released = 0;
+    v->keyed = keyed;
+    v->vel_atten = 0;
+    v->age = alloc->age++;
+    alloc->voice_used |= 1u << vi;
+    alloc->slot_used |= voice_slots(v);
+    alloc->note_voice[key] = (uint8_t)(vi + 1);
+    return vi;
+}
+
+/* Release a key that is still held before it plays again */
+static void retrigger(scsp_voice_alloc_t *alloc, int key)
+{
+    if (alloc->note_voice[key])
+        release_voice(alloc, alloc->note_voice[key] - 1);
+}
+
+/* Note what a slot was programmed with, for the controller updaters */
+static void remember_slot(scsp_voice_alloc_t *alloc, int slot, uint16_t pitch,
+                          uint16_t tl, uint16_t lfo, uint16_t out)
+{
+    alloc->slot_pitch[slot] = pitch;
+    alloc->slot_tl[slot] = tl;
+    alloc->slot_lfo[slot] = lfo;
+    if (out & 0xE0E0) alloc->slot_audible |= 1u << slot;   /* DISDL or EFSDL */
+    else              alloc->slot_audible &= ~(1u << slot);
+}
+
+/* Bring a new voice in line with its channel's controllers, then key it */
+static int start_voice(scsp_voice_alloc_t *alloc, int vi)
+{
+    scsp_voice_t *v = &alloc->voices[vi];
+    int ch = v->key >> 7;
+    int what = (alloc->bend_cents[ch] ? SCSP_CTRL_PITCH : 0) |
+               (alloc->volume_atten[ch] ? SCSP_CTRL_LEVEL : 0) |
+               (alloc->mod_depth[ch] ? SCSP_CTRL_LFO : 0);
+    if (what) update_voice(alloc, vi, what);
+
+    for (uint32_t m = v->keyed; m; m &= m - 1)
+        scsp_key_on(__builtin_ctz(m));
+    return vi;
+}
+
+int scsp_voice_note_on(scsp_voice_alloc_t *alloc, const scsp_fm_op_t *ops,
+                       int num_ops, int key, const scsp_wave_store_t *store)
+{
+    if (num_ops < 1 || num_ops > SCSP_MAX_OPS) return -1;
+    if (key < 0 || key >= SCSP_VOICE_KEYS) return -1;
+    int midi_note = key & 127;
+
+    retrigger(alloc, key);
+    int base = alloc_slots(alloc, key, num_ops);
+    if (base < 0) return -1;
+
+    for (int i = 0; i < num_ops; i++) {
+        scsp_op_image_t img;
+        uint16_t pitch = op_pitch(op_base_note(&ops[i]), midi_note);
+        op_image(&img, &ops[i], ops, num_ops, store);
+        write_image(base + i, &img, pitch);
+        remember_slot(alloc, base + i, pitch, img.regs[0x6], img.regs[0x9], img.regs[0xB]);
     }
-    alloc->num_voices = 0;
+
+    return start_voice(alloc, add_voice(alloc, key, base, num_ops, run_mask(num_ops) << base));
+}
+
+int scsp_voice_note_on_patch(scsp_voice_alloc_t *alloc, const scsp_patch_t *patch,
+                             int key)
+{
+    int n = patch->num_ops;
+    if (n < 1 || n > SCSP_MAX_OPS) return -1;
+    if (key < 0 || key >= SCSP_VOICE_KEYS) return -1;
+    int midi_note = key & 127;
+
+    retrigger(alloc, key);
+    int base = alloc_slots(alloc, key, n);
+    if (base < 0) return -1;
+
+    for (int i = 0; i < n; i++) {
+        const scsp_op_image_t *img = &patch->ops[i];
+        write_image(base + i, img, img->pitch[midi_note]);
+        remember_slot(alloc, base + i, img->pitch[midi_note], img->regs[0x6], img->regs[0x9], img->regs[0xB]);
+    }
+
+    return start_voice(alloc, add_voice(alloc, key, base, n, run_mask(n) << base));
+}
+
+int scsp_voice_note_on_ton(scsp_voice_alloc_t *alloc, const scsp_ton_bank_t *bank,
+                           int voice, int key)
+{
+    if (voice < 0 || voice >= bank->num_voices) return -1;
+    if (key < 0 || key >= SCSP_VOICE_KEYS) return -1;
+    int midi_note = key & 127;
+    const scsp_ton_voice_t *v = &bank->voices[voice];
+    const scsp_ton_layer_t *layers = &bank->layers[v->first_layer];
+    int n = v->num_layers;
+    if (n < 1 || n > SCSP_MAX_SLOTS) return -1;
+
+    /* Layers keep their relative slot order even when some are out of
+     * range, since FM links address modulators by slot distance */
+    retrigger(alloc, key);
+    int base = alloc_slots(alloc, key, n);
+    if (base < 0) return -1;
+
+    uint32_t keyed = 0;
+    for (int i = 0; i < n; i++) {
+        const scsp_ton_layer_t *l = &layers[i];
+        if (midi_note < l->start_note || midi_note > l->end_note) continue;
+        scsp_write_ton_layer(base + i, l, midi_note);
+        remember_slot(alloc, base + i, scsp_ton_pitch(l, midi_note), l->regs[0x6], l->regs[0x9], l->regs[0xB]);
+        keyed |= 1u << (base + i);
+    }
+
+    return start_voice(alloc, add_voice(alloc, key, base, n, keyed));
+}
+
+void scsp_voice_note_off(scsp_voice_alloc_t *alloc, int key)
+{
+    if (key < 0 || key >= SCSP_VOICE_KEYS || !alloc->note_voice[key]) return;
+    release_voice(alloc, alloc->note_voice[key] - 1);
+}
+
+void scsp_voice_channel_off(scsp_voice_alloc_t *alloc, int channel)
+{
+    for (uint32_t m = alloc->voice_used; m; m &= m - 1) {
+        int vi = __builtin_ctz(m);
+        if ((alloc->voices[vi].key >> 7) == channel) release_voice(alloc, vi);
+    }
+}
+
+void scsp_voice_all_off(scsp_voice_alloc_t *alloc)
+{
+    for (uint32_t m = alloc->voice_used; m; m &= m - 1)
+        release_voice(alloc, __builtin_ctz(m));
 }
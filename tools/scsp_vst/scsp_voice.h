@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include "../scsp_wasm/scsp_waveforms.h"
+#include "../scsp_wasm/scsp_ton.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,21 +19,56 @@ extern "C" {
 #define SCSP_MAX_SLOTS     32
 #define SCSP_MAX_OPS       6
 #define SCSP_MAX_WAVEFORMS 32
+#define SCSP_MAX_OLD_KITS  4
 
 /* ── Waveform Store ───────────────────────────────────────────── */
 
 typedef struct {
     int  ram_offset;    /* byte offset in SCSP RAM */
-    int  length;        /* total samples */
+    int  length;        /* total samples (0 = free entry) */
     int  loop_start;    /* LSA (sample index) */
     int  loop_end;      /* LEA (sample index) */
     int  loop_mode;     /* LPCTL: 0=off, 1=forward, 2=reverse, 3=ping-pong */
+    int  pcm8;          /* 1 = stored as 8-bit (PCM8B), one byte per sample */
+    uint32_t hash;      /* FNV-1a of the PCM, for sharing identical waves */
+    int  refs;          /* owners of a custom wave; built-ins are never freed */
 } scsp_waveform_t;
 
+/*
+ * How a custom wave is stored.  The 8-bit formats halve its RAM; both add
+ * TPDF dither, and SHAPED also feeds the error forward so the noise sits
+ * high in the spectrum, where drums and lo-fi material hide it best.
+ */
+typedef enum {
+    SCSP_PCM16 = 0,
+    SCSP_PCM8_DITHER,
+    SCSP_PCM8_SHAPED,
+    SCSP_PCM_FORMATS
+} scsp_pcm_format_t;
+
+/* A free block of sound RAM between custom waves */
+typedef struct {
+    int  offset;
+    int  size;
+} scsp_ram_extent_t;
+
 typedef struct {
     scsp_waveform_t waves[SCSP_MAX_WAVEFORMS];
-    int             num_waves;
+    int             num_waves;         /* entries in use or freed, built-ins first */
     int             next_free_offset;  /* next free byte in SCSP RAM */
+    int             kit_offset;        /* RAM byte offset of the loaded TON kit */
+    int             kit_end;           /* first byte after it (0 = no kit) */
+    int             custom_base;       /* first byte after the built-ins */
+    scsp_ram_extent_t holes[SCSP_MAX_WAVEFORMS + 1];  /* freed blocks, by offset */
+    int             num_holes;
+    /* Set when another thread renders: freed RAM waits in pending[] until
+     * no playing slot's SA is in it, compaction leaves such waves be, and
+     * add never compacts on its own */
+    int             guard_playing;
+    scsp_ram_extent_t pending[SCSP_MAX_WAVEFORMS];
+    int             num_pending;
+    scsp_ram_extent_t old_kits[SCSP_MAX_OLD_KITS];  /* replaced, banks maybe in use */
+    int             num_old_kits;
 } scsp_wave_store_t;
 
 /* ── Operator Definition ──────────────────────────────────────── */
@@ -57,19 +93,92 @@ typedef struct {
     int   loop_mode;    /* per-op override (-1 = use waveform default) */
 } scsp_fm_op_t;
 
+/* ── Patch Images ───────────────────────────────────────────── */
+
+/*
+ * An operator's slot registers, precomputed so note-on does no math.
+ * The MDXSL/MDYSL fields of word 0x7 are left 0 when they point at another
+ * operator (xsl_op/ysl_op), since the distance depends on the slot.
+ */
+typedef struct {
+    uint16_t regs[12];      /* slot words 0x0-0xB; 0x8 comes from pitch[] */
+    int8_t   xsl_op;        /* operator MDXSL addresses, -1 = as in regs */
+    int8_t   ysl_op;        /* operator MDYSL addresses, -1 = as in regs */
+    uint16_t pitch[128];    /* OCT/FNS word per MIDI note */
+} scsp_op_image_t;
+
+typedef struct {
+    scsp_op_image_t ops[SCSP_MAX_OPS];
+    int             num_ops;
+} scsp_patch_t;
+
 /* ── Voice Tracking ───────────────────────────────────────────── */
 
+/*
+ * Who gives up their slots when a note finds no free run.
+ *
+ * SCSP_STEAL_KEYOFF_FREE steals the oldest note like SCSP_STEAL_OLDEST,
+ * but a key-off also frees the slots at once, so a new note may cut a
+ * release tail short.  Combine it with reserved_slots to keep slots
+ * aside for PCM streams and effects.
+ */
+typedef enum {
+    SCSP_STEAL_RELEASED = 0,  /* oldest keyed-off note, else the oldest */
+    SCSP_STEAL_OLDEST,        /* oldest note, keyed or not */
+    SCSP_STEAL_QUIETEST,      /* lowest EG level across its slots */
+    SCSP_STEAL_KEYOFF_FREE,   /* oldest note; key-off frees slots: see above */
+    SCSP_STEAL_COUNT
+} scsp_steal_mode_t;
+
+/*
+ * Voices are looked up by key: a MIDI note, optionally with a channel in
+ * bits 7-10 so the same note on two channels plays two voices.
+ */
+#define SCSP_VOICE_KEYS             (16 * 128)
+#define SCSP_VOICE_KEY(ch, note)    ((((ch) & 15) << 7) | ((note) & 127))
+
 typedef struct {
-    int  active;
-    int  midi_note;
-    int  slot_base;
-    int  num_ops;
+    int      key;           /* SCSP_VOICE_KEY; the low 7 bits are the note */
+    int      slot_base;
+    int      num_ops;
+    int      released;      /* key-off sent; slots held until the EGs finish */
+    uint32_t keyed;         /* slots keyed on (all but out-of-range TON layers) */
+    uint8_t  vel_atten;     /* TL steps from velocity, on audible slots */
+    uint32_t age;
 } scsp_voice_t;
 
+/* Where notes were lost, for showing the real polyphony budget */
+typedef struct {
+    uint32_t steals;        /* notes cut to make room for another */
+    uint32_t drops;         /* notes that could not be placed at all */
+    int      last_key;      /* key of the last note stolen or dropped */
+    int      last_slot;     /* first slot it held, -1 for a drop */
+} scsp_voice_stats_t;
+
+/*
+ * Zero-initialised state is a valid empty allocator.  A slot stays held
+ * through its release tail and only returns to slot_used's complement once
+ * the SCSP reports its envelope finished.
+ */
 typedef struct {
     scsp_voice_t voices[SCSP_MAX_SLOTS];
-    int          num_voices;
-    int          slot_used[SCSP_MAX_SLOTS];
+    uint32_t     voice_used;        /* bitmap of live entries in voices[] */
+    uint32_t     slot_used;         /* bitmap of slots held by a voice */
+    uint8_t      note_voice[SCSP_VOICE_KEYS]; /* held voice index + 1 per key, 0 = none */
+    uint32_t     age;
+    int          steal_mode;        /* scsp_steal_mode_t */
+    int          reserved_slots;    /* top slots kept out of allocation (0-32) */
+    scsp_voice_stats_t stats;
+
+    /* Channel controllers (zero = neutral), and each slot's words as
+     * programmed at note-on, which the updaters work from */
+    int16_t      bend_cents[16];
+    uint8_t      volume_atten[16];  /* TL steps */
+    uint8_t      mod_depth[16];     /* CC 1 */
+    uint16_t     slot_pitch[SCSP_MAX_SLOTS];   /* word 0x8 */
+    uint16_t     slot_tl[SCSP_MAX_SLOTS];      /* word 0x6 */
+    uint16_t     slot_lfo[SCSP_MAX_SLOTS];     /* word 0x9 */
+    uint32_t     slot_audible;      /* DISDL or EFSDL set: level controls apply */
 } scsp_voice_alloc_t;
 
 /* ── API ──────────────────────────────────────────────────────── */
@@ -82,7 +191,11 @@ void scsp_voice_init(scsp_wave_store_t *store);
 
 /*
  * Add a custom waveform to the store. Writes samples to SCSP RAM.
- * Returns the waveform ID (index in store), or -1 if store is full.
+ * A wave identical to one already stored (same PCM and loop) shares that
+ * copy and takes another reference; each add needs a matching release.
+ * RAM comes from freed blocks first, then from next_free_offset, with a
+ * compaction pass before giving up (not with guard_playing).
+ * Returns the waveform ID (index in store), or -1 if store or RAM is full.
  * samples: int16_t LE samples
  * length: number of samples
  * loop_start/loop_end: loop points (sample indices)
@@ -92,6 +205,54 @@ int scsp_wave_store_add(scsp_wave_store_t *store,
                         const int16_t *samples, int length,
                         int loop_start, int loop_end, int loop_mode);
 
+/*
+ * As scsp_wave_store_add, storing the wave in the given scsp_pcm_format_t.
+ * 8-bit waves are requantized as scsp_pcm8_requantize does and played with
+ * PCM8B set.
+ */
+int scsp_wave_store_add_format(scsp_wave_store_t *store,
+                               const int16_t *samples, int length,
+                               int loop_start, int loop_end, int loop_mode,
+                               int format);
+
+/*
+ * Requantize 16-bit samples to 8 bits the way the store does, for
+ * previewing the quality cost.  The dither sequence restarts on every
+ * call, so the same input always gives the same output.
+ */
+void scsp_pcm8_requantize(const int16_t *in, int8_t *out, int length, int format);
+
+/*
+ * Drop a reference taken by scsp_wave_store_add.  The last one frees the
+ * entry and its RAM (with guard_playing, once no slot is reading it).
+ * Built-ins are ignored.
+ */
+void scsp_wave_store_release(scsp_wave_store_t *store, int id);
+
+/*
+ * Pack custom waves down over freed blocks (the TON kit stays put) and
+ * repoint slots playing them; with guard_playing, waves a slot is reading
+ * stay put too.  Patch images built before this hold stale
+ * SAs and must be rebuilt.  Returns the number of waves moved.
+ */
+int scsp_wave_store_compact(scsp_wave_store_t *store);
+
+/*
+ * Load a TON kit into SCSP RAM after the stored waveforms and parse it
+ * into bank.  A kit that is still the last thing in RAM is replaced in
+ * place.  With guard_playing the new kit always goes to free RAM and the
+ * old kit's stays in old_kits[] (SCSP_TON_ERR_RAM once that is full).
+ * Returns the number of voices, or a negative SCSP_TON_ERR_* code.
+ */
+int scsp_wave_store_load_ton(scsp_wave_store_t *store, scsp_ton_bank_t *bank,
+                             const uint8_t *ton, uint32_t size);
+
+/*
+ * Free the RAM of kits load_ton replaced, once no note can start on
+ * their banks any more (with guard_playing, as their tails finish).
+ */
+void scsp_wave_store_release_old_kits(scsp_wave_store_t *store);
+
 /*
  * Program SCSP slot with operator params, using waveform from store.
  */
@@ -99,14 +260,55 @@ void scsp_program_slot(int slot, const scsp_fm_op_t *op, int midi_note,
                        const scsp_fm_op_t *all_ops, int num_ops,
                        const scsp_wave_store_t *store);
 
+/*
+ * Precompute a patch's slot images for all 128 notes.  Rebuild whenever an
+ * operator or a waveform it uses changes.  Returns 0, or -1 if num_ops is
+ * out of range.
+ */
+int scsp_patch_build(scsp_patch_t *patch, const scsp_fm_op_t *ops, int num_ops,
+                     const scsp_wave_store_t *store);
+
 /*
  * Voice allocation: note on/off using the wave store for waveform lookup.
+ * scsp_voice_note_on_ton plays voice `voice` of a loaded TON kit instead:
+ * one slot per layer, keyed on for the layers whose range holds the note.
+ * scsp_voice_note_on_patch plays a patch from scsp_patch_build: a table
+ * lookup and one register image write per operator.
+ * key is a MIDI note or an SCSP_VOICE_KEY.  A key that is still held is
+ * released first.  When no run of free slots exists, the voices in the
+ * run whose occupants rank lowest by alloc->steal_mode are stolen, and no
+ * others.  Note-on returns the voice index, or -1 if the voice can't fit
+ * outside the reserved slots.  scsp_voice_channel_off releases the
+ * voices of one channel of SCSP_VOICE_KEYs.
  */
 int  scsp_voice_note_on(scsp_voice_alloc_t *alloc, const scsp_fm_op_t *ops,
-                        int num_ops, int midi_note, const scsp_wave_store_t *store);
-void scsp_voice_note_off(scsp_voice_alloc_t *alloc, int midi_note);
+                        int num_ops, int key, const scsp_wave_store_t *store);
+int  scsp_voice_note_on_patch(scsp_voice_alloc_t *alloc, const scsp_patch_t *patch,
+                              int key);
+int  scsp_voice_note_on_ton(scsp_voice_alloc_t *alloc, const scsp_ton_bank_t *bank,
+                            int voice, int key);
+void scsp_voice_note_off(scsp_voice_alloc_t *alloc, int key);
+void scsp_voice_channel_off(scsp_voice_alloc_t *alloc, int channel);
 void scsp_voice_all_off(scsp_voice_alloc_t *alloc);
 
+/*
+ * Controllers, applied to the sounding voices of a channel (channel 0 for
+ * plain MIDI-note keys) and to notes started afterwards.  Each rewrites
+ * one slot word per keyed slot from curves built by scsp_voice_init:
+ * OCT/FNS for bend, TL for volume and velocity (audible slots only, so
+ * FM depth is unchanged), the pitch LFO for modulation.
+ * velocity and volume are MIDI 0-127; voice is a note-on return value.
+ */
+#define SCSP_CTRL_PITCH  1
+#define SCSP_CTRL_LEVEL  2
+#define SCSP_CTRL_LFO    4
+
+void scsp_voice_velocity(scsp_voice_alloc_t *alloc, int voice, int velocity);
+void scsp_voice_pitch_bend(scsp_voice_alloc_t *alloc, int channel, int cents);
+void scsp_voice_volume(scsp_voice_alloc_t *alloc, int channel, int volume);
+void scsp_voice_modulation(scsp_voice_alloc_t *alloc, int channel, int depth);
+void scsp_voice_reset_controllers(scsp_voice_alloc_t *alloc, int channel);
+
 #ifdef __cplusplus
 }
 #endif
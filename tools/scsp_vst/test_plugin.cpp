@@ -7,9 +7,12 @@
  * Build:  c++ -std=c++17 -I. -Idpfwebui/dpf/distrho -include ../scsp_wasm/scsp_types.h \
  *         -D__AO_H -DCPUINTRF_H -D_SAT_HW_H_ -DOSD_CPU_H -DTEST_PLUGIN_STANDALONE \
  *         test_plugin.cpp ../scsp_wasm/scsp_wasm.c ../scsp_wasm/scsp.c \
- *         ../scsp_wasm/scspdsp.c ../scsp_wasm/scsp_waveforms.c scsp_voice.c \
+ *         ../scsp_wasm/scspdsp.c ../scsp_wasm/scsp_waveforms.c ../scsp_wasm/scsp_ton.c \
+ *         ../scsp_wasm/scsp_seq.c scsp_voice.c scsp_state.c \
  *         -o test_plugin -lm
- * Run:    ./test_plugin
+ * Run:    ./test_plugin            (correctness)
+ *         ./test_plugin DIR        (correctness, TON kits from DIR instead of test_ton/)
+ *         ./test_plugin --bench    (block timing against the realtime budget)
  */
 
 #include <cstdio>
@@ -18,13 +21,28 @@
 #include <cmath>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <chrono>
 
 /* Include the SCSP voice layer directly */
 extern "C" {
 #include "scsp_voice.h"
+#include "scsp_state.h"
+#include "../scsp_wasm/scsp.h"
 extern void scsp_init(void);
 extern int16_t *scsp_render(int num_samples);
+extern uint8_t *scsp_get_ram_ptr(void);
+extern int scsp_bank_load(const uint8_t *ton, uint32_t size, uint32_t ram_base);
+extern int scsp_song_load(const uint8_t *seq, uint32_t size, int index);
+extern void scsp_song_play(int loop);
+extern void scsp_song_stop(void);
+extern int scsp_song_tick(void);
+extern void scsp_meter_enable(int enable);
+extern uint32_t scsp_slots_playing(void);
+extern uint32_t scsp_slots_reading(uint32_t offset, uint32_t bytes);
+extern struct _SCSP_METER *scsp_meter_get(void);
 }
+#include "scsp_presets.h"
 
 /* ── Replicate plugin parameter layout ── */
 #define MAX_OPS 6
@@ -140,6 +158,46 @@ static int passed = 0, failed = 0;
 #define ASSERT_EQ(a, b, msg) do { if ((a) != (b)) { printf("  FAIL: %s (got %d, expected %d)\n", msg, (int)(a), (int)(b)); failed++; } else { passed++; } } while(0)
 #define ASSERT_CLOSE(a, b, tol, msg) do { if (fabs((a)-(b)) > (tol)) { printf("  FAIL: %s (got %.4f, expected %.4f)\n", msg, (double)(a), (double)(b)); failed++; } else { passed++; } } while(0)
 
+static std::vector<uint8_t> readFile(const char *path) {
+    std::vector<uint8_t> data;
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        uint8_t buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+        fclose(f);
+    }
+    return data;
+}
+
+/* Directory part of a path, "." when it has none */
+static std::string dirName(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+/* KITFM.TON from `dir` if given, else from test_ton/ at the repo root,
+ * found relative to this source file or to the test binary (when built
+ * in tools/scsp_vst), so the tests run from any directory */
+static std::vector<uint8_t> readKit(const char *dir, const char *argv0) {
+    if (dir) return readFile((std::string(dir) + "/KITFM.TON").c_str());
+    std::vector<uint8_t> data = readFile((dirName(__FILE__) + "/../../test_ton/KITFM.TON").c_str());
+    if (data.empty()) data = readFile((dirName(argv0) + "/../../test_ton/KITFM.TON").c_str());
+    return data;
+}
+
+/* Render a song from the top in blocks of `block` samples */
+static std::vector<int16_t> renderSong(int total, int block) {
+    std::vector<int16_t> out;
+    scsp_song_play(0);
+    for (int done = 0; done < total; done += block) {
+        int n = total - done < block ? total - done : block;
+        int16_t *buf = scsp_render(n);
+        out.insert(out.end(), buf, buf + n * 2);
+    }
+    return out;
+}
+
 /* Render some audio and check it's not silent */
 static bool renderHasAudio(int numSamples) {
     /* Trigger a note */
@@ -155,7 +213,203 @@ static bool renderHasAudio(int numSamples) {
     return maxVal > 100; /* not silent */
 }
 
-int main() {
+/* ── Benchmark ── */
+/*
+ * Replays MIDI the way SCSPSynthPlugin::run() does — render up to each
+ * event's frame, apply it, carry on — and times every whole block against
+ * its realtime budget.  The held and chord scenarios play patches built
+ * up front; a patch change writes the next preset's parameters and builds
+ * its patch inside the block, as run() does after the host's writes.
+ */
+#define BENCH_RATE      44100
+#define BENCH_SECONDS   2.0   /* audio per run, at least BENCH_MIN_BLOCKS */
+#define BENCH_MIN_BLOCKS 200
+
+enum BenchScenario {
+    kBenchHeld,     /* notes held, one restruck every 441 frames (100/s) */
+    kBenchChord,    /* every 1024 frames all notes released and struck on one frame */
+    kBenchPatch,    /* every 1024 frames the next preset, struck over the oldest note */
+    kBenchScenarios
+};
+static const char *const kBenchScenarioNames[] = { "held", "chord", "patch" };
+
+struct BenchStats { double avg, p99, max; };
+
+static scsp_patch_t fBenchPatches[kNumPresets];
+static scsp_patch_t fBenchLive[2];   /* built in the timed block, alternately */
+
+/* A preset's parameters as the host writes them: the plugin only stores
+ * each value and builds them all once, in run() */
+static void benchParams(int preset) {
+    const Preset& pr = kPresets[preset];
+    for (int i = 0; i < kParameterCount; i++) fParams[i] = 0.f;
+    fParams[kNumOps] = (float)pr.numOps;
+    for (int i = 0; i < MAX_OPS; i++) {
+        float *op = &fParams[i * PARAMS_PER_OP];
+        op[kOpFreqRatio] = 1.f;
+        op[kOpLevel]     = 0.8f;
+        op[kOpAR]        = 31.f;
+        op[kOpRR]        = 14.f;
+        op[kOpLoopMode]  = 1.f;
+        op[kOpLoopEnd]   = 1024.f;
+        if (i >= pr.numOps) continue;
+        const auto& o = pr.ops[i];
+        op[kOpFreqRatio] = o.ratio;
+        op[kOpLevel]     = o.level;
+        op[kOpAR]        = (float)o.ar;
+        op[kOpD1R]       = (float)o.d1r;
+        op[kOpDL]        = (float)o.dl;
+        op[kOpD2R]       = (float)o.d2r;
+        op[kOpRR]        = (float)o.rr;
+        op[kOpFeedback]  = o.fb;
+        op[kOpMDL]       = (float)o.mdl;
+        op[kOpModSource] = (float)(o.modSrc + 1);
+        fParams[kIsCarrier0 + i] = (float)o.isCarrier;
+    }
+}
+
+static void benchPatch(int preset) {
+    benchParams(preset);
+    rebuildOps();
+    scsp_patch_build(&fBenchPatches[preset], fOps, fNumOps, &fWaveStore);
+}
+
+/* Time one run in blocks of `frames`; loads are block time / budget */
+static BenchStats benchRun(BenchScenario sc, int preset, int slots, int frames) {
+    memset(&fAlloc, 0, sizeof(fAlloc));
+    scsp_voice_init(&fWaveStore);
+    for (int i = 0; i < kNumPresets; i++) benchPatch(i);
+
+    const int notes = std::max(1, slots / kPresets[preset].numOps);
+    const int numBlocks = std::max(BENCH_MIN_BLOCKS, (int)(BENCH_SECONDS * BENCH_RATE / frames));
+    const double budgetNs = frames * 1e9 / BENCH_RATE;
+    const scsp_patch_t *patch = &fBenchPatches[preset];
+    int nextPreset = preset, restrike = 0, oldest = 0, live = 0;
+    std::vector<float> outL(frames), outR(frames);
+    std::vector<double> load(numBlocks);
+
+    auto strike = [&](int key) {
+        scsp_voice_velocity(&fAlloc, scsp_voice_note_on_patch(&fAlloc, patch, key), 100);
+    };
+
+    for (int b = 0; b < numBlocks; b++) {
+        const uint64_t start = (uint64_t)b * frames;
+        auto t0 = std::chrono::steady_clock::now();
+
+        /* Event frames in this block: multiples of the scenario's period */
+        const uint64_t period = sc == kBenchHeld ? 441 : 1024;
+        uint64_t next = (start + period - 1) / period * period;
+        int done = 0;
+        while (done < frames) {
+            int until = next < start + frames ? (int)(next - start) : frames;
+            if (until > done) {
+                int16_t *buf = scsp_render(until - done);
+                for (int i = 0; i < until - done; i++) {
+                    outL[done + i] = buf[i * 2]     / 32768.0f;
+                    outR[done + i] = buf[i * 2 + 1] / 32768.0f;
+                }
+                done = until;
+            }
+            if (next >= start + frames) break;
+            if (next == 0 || sc == kBenchChord) {
+                for (int n = 0; n < notes; n++) scsp_voice_note_off(&fAlloc, 48 + n);
+                for (int n = 0; n < notes; n++) strike(48 + n);
+            } else if (sc == kBenchHeld) {
+                int key = 48 + restrike++ % notes;
+                scsp_voice_note_off(&fAlloc, key);
+                strike(key);
+            } else {
+                nextPreset = (nextPreset + 1) % kNumPresets;
+                benchParams(nextPreset);
+                rebuildOps();
+                live ^= 1;
+                scsp_patch_build(&fBenchLive[live], fOps, fNumOps, &fWaveStore);
+                patch = &fBenchLive[live];
+                int key = 48 + oldest++ % notes;
+                scsp_voice_note_off(&fAlloc, key);
+                strike(key);
+            }
+            next += period;
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        load[b] = std::chrono::duration<double, std::nano>(t1 - t0).count() / budgetNs;
+    }
+
+    BenchStats st = { 0, 0, 0 };
+    for (double l : load) st.avg += l;
+    st.avg /= numBlocks;
+    std::sort(load.begin(), load.end());
+    st.p99 = load[(size_t)ceil(0.99 * numBlocks) - 1];
+    st.max = load.back();
+    return st;
+}
+
+static int runBenchmark() {
+    static const int kSlots[] = { 1, 2, 4, 8, 16, 32 };
+    static const int kBlocks[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    double worst64 = 0;
+    std::string worstAt;
+
+    printf("\n=== SCSP FM Synth DSP Benchmark ===\n\n");
+    printf("Block time as %% of its realtime budget at %d Hz, avg/p99.\n", BENCH_RATE);
+    printf("Notes held = slots / operators, at least one.\n");
+
+    auto header = [&](const char *first) {
+        printf("%-18s", first);
+        for (int s : kSlots) printf("  %2d slots  ", s);
+        printf("\n");
+    };
+    auto cell = [&](const BenchStats& st, const std::string& where, int frames) {
+        printf("  %4.1f/%5.1f", st.avg * 100, st.p99 * 100);
+        if (frames == 64 && st.p99 > worst64) {
+            worst64 = st.p99;
+            worstAt = where;
+        }
+    };
+
+    /* Every preset at the budget that matters on stage */
+    printf("\n--- Presets, 64 frames, held notes ---\n");
+    header("preset");
+    for (int p = 0; p < kNumPresets; p++) {
+        printf("%-18s", kPresets[p].name);
+        for (int s : kSlots)
+            cell(benchRun(kBenchHeld, p, s, 64), std::string(kPresets[p].name) + ", " +
+                 std::to_string(s) + " slots", 64);
+        printf("\n");
+        fflush(stdout);
+    }
+
+    /* Block sizes and worst cases with the preset using the most operators */
+    int heavy = 0;
+    for (int p = 1; p < kNumPresets; p++)
+        if (kPresets[p].numOps > kPresets[heavy].numOps) heavy = p;
+    for (int sc = 0; sc < kBenchScenarios; sc++) {
+        printf("\n--- Block sizes, %s, %s ---\n", kPresets[heavy].name, kBenchScenarioNames[sc]);
+        header("frames");
+        double worstMax = 0;
+        for (int frames : kBlocks) {
+            printf("%-18d", frames);
+            for (int s : kSlots) {
+                BenchStats st = benchRun((BenchScenario)sc, heavy, s, frames);
+                worstMax = std::max(worstMax, st.max);
+                cell(st, std::string(kBenchScenarioNames[sc]) + ", " + std::to_string(s) + " slots", frames);
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+        printf("worst single block: %.1f%%\n", worstMax * 100);
+    }
+
+    printf("\n==================================================\n");
+    printf("64-frame p99: %.1f%% of budget (%s) — %s\n", worst64 * 100, worstAt.c_str(),
+           worst64 <= 1.0 ? "within budget" : "OVER BUDGET");
+    return worst64 <= 1.0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "--bench")) return runBenchmark();
+
     printf("\n=== SCSP FM Synth DSP Test ===\n\n");
 
     /* Initialize */
@@ -164,6 +418,9 @@ int main() {
     memset(fParams, 0, sizeof(fParams));
     scsp_voice_init(&fWaveStore);
 
+    const std::vector<uint8_t> kit = readKit(argc > 1 ? argv[1] : nullptr, argv[0]);
+    if (kit.empty()) printf("KITFM.TON not found: skipping the kit tests (5, 6, 7, 10, 17)\n");
+
     /* ── Test 1: Electric Piano preset via applyPatch ── */
     printf("--- Test 1: Electric Piano via applyPatch ---\n");
     {
@@ -262,6 +519,613 @@ int main() {
         ASSERT(renderHasAudio(512), "1-op produces audio after switch");
     }
 
+    /* ── Test 5: Native TON kit load ── */
+    printf("\n--- Test 5: Native TON kit load ---\n");
+    if (!kit.empty()) {
+        const std::vector<uint8_t> &ton = kit;
+        ASSERT(ton.size() > 0, "KITFM.TON readable");
+
+        static scsp_ton_bank_t bank;
+        int base = fWaveStore.next_free_offset;
+        int nv = scsp_wave_store_load_ton(&fWaveStore, &bank, ton.data(), (uint32_t)ton.size());
+        ASSERT_EQ(nv, 16, "16 voices");
+        ASSERT_EQ(bank.voices[0].num_layers, 2, "voice 0 has 2 layers");
+        ASSERT_EQ(bank.num_vl, 1, "one VL entry");
+        ASSERT_EQ(bank.vl[0].level[0], 54, "VL level0 = 54");
+
+        const scsp_ton_layer_t *mod = &bank.layers[0], *car = &bank.layers[1];
+        ASSERT_EQ(car->fm_layer, 0, "layer 1 modulated by layer 0");
+        ASSERT_EQ(car->regs[7], 0x9FFF, "MDL 9, MDXSL/MDYSL one slot back");
+        ASSERT_EQ(mod->sa, (uint32_t)(base + 0x372), "SA relocated past the waveforms");
+        ASSERT_EQ(mod->regs[1], (base + 0x372) & 0xFFFF, "SA low word in image");
+        ASSERT_EQ(scsp_ton_pitch(mod, mod->base_note), 0, "base note plays OCT 0 FNS 0");
+        ASSERT_EQ(scsp_ton_pitch(mod, mod->base_note + 13), (1 << 11) | 61, "+13 semitones");
+        ASSERT_EQ(fWaveStore.kit_end, base + (int)ton.size(), "store advanced past the kit");
+
+        /* PCM copied as host-order words */
+        const uint8_t *ram = scsp_get_ram_ptr();
+        uint32_t sa = 0x372;
+        ASSERT(ram[base + sa] == ton[sa + 1] && ram[base + sa + 1] == ton[sa], "PCM word swapped into RAM");
+
+        /* Reloading reuses the same space */
+        scsp_wave_store_load_ton(&fWaveStore, &bank, ton.data(), (uint32_t)ton.size());
+        ASSERT_EQ(fWaveStore.kit_offset, base, "reload in place");
+
+        scsp_voice_note_on_ton(&fAlloc, &bank, 0, 60);
+        int16_t *buf = scsp_render(2048);
+        float maxVal = 0;
+        for (int i = 0; i < 2048 * 2; i++) maxVal = fmaxf(maxVal, fabsf((float)buf[i]));
+        scsp_voice_note_off(&fAlloc, 60);
+        scsp_render(100);
+        ASSERT(maxVal > 100, "kit voice 0 produces audio");
+
+        ASSERT(scsp_ton_parse(&bank, ton.data(), 9, 0) < 0, "truncated file rejected");
+    }
+
+    /* ── Test 6: Native SEQ playback ── */
+    printf("\n--- Test 6: Native SEQ playback ---\n");
+    if (!kit.empty()) {
+        /* One song, 480 ticks/beat at 120 BPM (22050 samples per beat):
+         * program 0 on channel 0, then note 60 at tick 480 held 240 ticks */
+        static const uint8_t seq[] = {
+            0x00, 0x01, 0x00, 0x00, 0x00, 0x06,                 /* bank: 1 song at 6 */
+            0x01, 0xE0, 0x00, 0x01, 0x00, 0x10, 0x00, 0x00,     /* res, 1 tempo, data at 16 */
+            0x00, 0x00, 0x03, 0x00, 0x00, 0x07, 0xA1, 0x20,     /* 768 ticks at 500000 us */
+            0xC0, 0x00, 0x00,                                   /* PC 0, delta 0 */
+            0x20, 60, 100, 240, 224,                            /* note-on, delta 256 + 224 */
+            0x83,
+        };
+        const std::vector<uint8_t> &ton = kit;
+
+        scsp_init();
+        ASSERT(scsp_bank_load(ton.data(), (uint32_t)ton.size(), 0) > 0, "bank loaded");
+        ASSERT_EQ(scsp_song_load(seq, sizeof(seq), 0), 1, "one song in bank");
+        ASSERT_EQ(scsp_song_load(seq, 9, 0), -1, "truncated song rejected");
+        ASSERT_EQ(scsp_song_load(seq, sizeof(seq), 0), 1, "reload");
+        ASSERT_EQ(scsp_song_tick(), -1, "stopped before play");
+
+        std::vector<int16_t> a = renderSong(44100, 4096);
+        int first = -1;
+        for (size_t i = 0; i < a.size(); i++) if (a[i] != 0) { first = (int)(i / 2); break; }
+        ASSERT(first >= 22050 && first < 22050 + 16, "key-on lands on sample 22050");
+        ASSERT_EQ(scsp_song_tick(), -1, "song ends once the gate expires");
+
+        scsp_init();
+        scsp_bank_load(ton.data(), (uint32_t)ton.size(), 0);
+        std::vector<int16_t> b = renderSong(44100, 37);
+        ASSERT(a == b, "output independent of block size");
+
+        scsp_init();
+        scsp_bank_load(ton.data(), (uint32_t)ton.size(), 0);
+        scsp_song_play(1);
+        for (int i = 0; i < 10; i++) scsp_render(8192);   /* > 2 passes of 768 ticks */
+        ASSERT(scsp_song_tick() >= 1536, "looping song still running");
+        scsp_song_stop();
+        ASSERT_EQ(scsp_song_tick(), -1, "stop");
+    }
+
+    /* ── Test 7: Level meters ── */
+    printf("\n--- Test 7: Level meters ---\n");
+    if (!kit.empty()) {
+        const std::vector<uint8_t> &ton = kit;
+        static scsp_ton_bank_t bank;
+
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        memset(&fWaveStore, 0, sizeof(fWaveStore));
+        scsp_voice_init(&fWaveStore);
+        scsp_wave_store_load_ton(&fWaveStore, &bank, ton.data(), (uint32_t)ton.size());
+        const struct _SCSP_METER *m = scsp_meter_get();
+
+        scsp_voice_note_on_ton(&fAlloc, &bank, 0, 60);
+        scsp_render(512);
+        ASSERT_EQ(m->Samples, 0u, "meters off by default");
+
+        scsp_meter_enable(1);
+        int16_t *buf = scsp_render(512);
+        int peak = 0;
+        for (int i = 0; i < 512 * 2; i++) peak = std::max(peak, abs((int)buf[i]));
+        ASSERT_EQ(m->Samples, 512u, "one block accumulated");
+        ASSERT_CLOSE(std::max(m->MasterPeak[0], m->MasterPeak[1]), peak / 32768.0, 1e-4, "master peak matches output");
+        ASSERT(m->MasterSum[0] > 0, "master sum");
+        float slots = 0;
+        for (int i = 0; i < 32; i++) slots = std::max(slots, m->SlotPeak[i]);
+        ASSERT(slots > 0, "a slot is metered");
+
+        scsp_render(64);
+        ASSERT_EQ(m->Samples, 64u, "reset per render call");
+
+        scsp_init();
+        ASSERT_EQ(scsp_meter_get()->Enabled, 1u, "enable survives scsp_init");
+        scsp_meter_enable(0);
+        scsp_render(64);
+        ASSERT_EQ(scsp_meter_get()->Samples, 0u, "disabled");
+    }
+
+    /* ── Test 8: Slot allocator ── */
+    printf("\n--- Test 8: Slot allocator ---\n");
+    {
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        memset(&fWaveStore, 0, sizeof(fWaveStore));
+        scsp_voice_init(&fWaveStore);
+        applyPatch({
+            { 2.0f, 0.9f, 0.0f,  31,12,8,0,14,  0, -1,  1, 0, 1024,  false, 0 },
+            { 1.0f, 0.8f, 0.0f,  31, 6,2,0,14,  9,  0,  1, 0, 1024,  true,  0 },
+        });
+
+        int vi[16];
+        for (int i = 0; i < 16; i++) vi[i] = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 40 + i, &fWaveStore);
+        scsp_render(64);
+        ASSERT(fAlloc.slot_used == 0xFFFFFFFFu, "16 two-op notes fill 32 slots");
+
+        scsp_voice_note_off(&fAlloc, 45);
+        scsp_render(64);
+        ASSERT(fAlloc.slot_used == 0xFFFFFFFFu, "release tail keeps its slots");
+
+        int v = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 60, &fWaveStore);
+        ASSERT_EQ(fAlloc.voices[v].slot_base, 10, "released note stolen first");
+        ASSERT_EQ(fAlloc.note_voice[40], vi[0] + 1, "oldest keyed note kept");
+
+        fAlloc.steal_mode = SCSP_STEAL_OLDEST;
+        v = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 61, &fWaveStore);
+        ASSERT_EQ(fAlloc.voices[v].slot_base, 0, "oldest note stolen");
+        ASSERT_EQ(fAlloc.note_voice[40], 0, "stolen note unmapped");
+
+        fAlloc.steal_mode = SCSP_STEAL_QUIETEST;
+        scsp_voice_note_off(&fAlloc, 50);
+        scsp_render(2048);
+        v = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 62, &fWaveStore);
+        ASSERT_EQ(fAlloc.voices[v].slot_base, 20, "quietest (released) note stolen");
+
+        scsp_voice_note_on(&fAlloc, fOps, fNumOps, 62, &fWaveStore);
+        ASSERT(__builtin_popcount(fAlloc.voice_used) == 16, "retrigger releases the old note");
+
+        scsp_voice_all_off(&fAlloc);
+        for (int i = 0; i < 100 && scsp_slots_playing(); i++) scsp_render(1024);
+        ASSERT_EQ(scsp_slots_playing(), 0u, "release tails end");
+        fAlloc.steal_mode = SCSP_STEAL_RELEASED;
+        scsp_voice_note_on(&fAlloc, fOps, fNumOps, 60, &fWaveStore);
+        ASSERT_EQ(__builtin_popcount(fAlloc.voice_used), 1, "finished voices reclaimed");
+        ASSERT_EQ(__builtin_popcount(fAlloc.slot_used), 2, "their slots freed");
+        scsp_voice_all_off(&fAlloc);
+    }
+
+    /* ── Test 9: Precomputed patch images ── */
+    printf("\n--- Test 9: Patch images ---\n");
+    {
+        /* Metallic: feedback on op 0 and op 2, op 2 modulated by op 0 */
+        applyPatch({
+            { 1.414f, 0.6f, 0.4f, 31, 6,3,0,10,  0, -1,  1, 0, 1024,  false, 0 },
+            { 3.82f,  0.5f, 0.0f, 31, 8,4,0,12,  0, -1,  1, 0, 1024,  false, 0 },
+            { 1.0f,   0.7f, 0.3f, 31, 4,2,0,10, 10,  0,  1, 0, 1024,  true,  0 },
+        });
+        static scsp_patch_t patch;
+        ASSERT_EQ(scsp_patch_build(&patch, fOps, fNumOps, &fWaveStore), 0, "patch built");
+        ASSERT_EQ(scsp_patch_build(&patch, fOps, 0, &fWaveStore), -1, "zero ops rejected");
+
+        const int notes[] = { 36, 61, 60, 84 };
+        std::vector<int16_t> out[2];
+        for (int path = 0; path < 2; path++) {
+            memset(&fAlloc, 0, sizeof(fAlloc));
+            scsp_voice_init(&fWaveStore);
+            for (int n : notes) {
+                if (path) scsp_voice_note_on_patch(&fAlloc, &patch, n);
+                else      scsp_voice_note_on(&fAlloc, fOps, fNumOps, n, &fWaveStore);
+                int16_t *buf = scsp_render(256);
+                out[path].insert(out[path].end(), buf, buf + 512);
+            }
+            scsp_voice_all_off(&fAlloc);
+        }
+        ASSERT(*std::max_element(out[0].begin(), out[0].end()) > 100, "patch audible");
+        ASSERT(out[0] == out[1], "images match per-note programming");
+    }
+
+    /* ── Test 10: Multi-timbral keys ── */
+    printf("\n--- Test 10: Multi-timbral keys ---\n");
+    if (!kit.empty()) {
+        const std::vector<uint8_t> &ton = kit;
+        static scsp_ton_bank_t bank;
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        scsp_voice_init(&fWaveStore);
+        scsp_wave_store_load_ton(&fWaveStore, &bank, ton.data(), (uint32_t)ton.size());
+
+        int a = scsp_voice_note_on_ton(&fAlloc, &bank, 0, SCSP_VOICE_KEY(0, 60));
+        int b = scsp_voice_note_on_ton(&fAlloc, &bank, 1, SCSP_VOICE_KEY(1, 60));
+        int c = scsp_voice_note_on_ton(&fAlloc, &bank, 2, SCSP_VOICE_KEY(9, 60));
+        ASSERT(a >= 0 && b >= 0 && c >= 0 && a != b && b != c, "same note on three channels");
+        ASSERT_EQ(__builtin_popcount(fAlloc.voice_used), 3, "three voices share the chip");
+
+        scsp_voice_note_off(&fAlloc, SCSP_VOICE_KEY(0, 60));
+        ASSERT(fAlloc.voices[a].released && !fAlloc.voices[b].released, "note-off is per channel");
+        scsp_voice_channel_off(&fAlloc, 9);
+        ASSERT(fAlloc.voices[c].released && !fAlloc.voices[b].released, "channel off");
+        ASSERT_EQ(scsp_voice_note_on_ton(&fAlloc, &bank, 0, SCSP_VOICE_KEYS), -1, "key out of range");
+        scsp_voice_all_off(&fAlloc);
+    }
+
+    /* ── Test 11: Free-on-key-off allocation ── */
+    printf("\n--- Test 11: Free-on-key-off allocation ---\n");
+    {
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        scsp_voice_init(&fWaveStore);
+        applyPatch({
+            { 2.0f, 0.9f, 0.0f,  31,12,8,0,14,  0, -1,  1, 0, 1024,  false, 0 },
+            { 1.0f, 0.8f, 0.0f,  31, 6,2,0,14,  9,  0,  1, 0, 1024,  true,  0 },
+        });
+        fAlloc.steal_mode = SCSP_STEAL_KEYOFF_FREE;
+        fAlloc.reserved_slots = 8;
+
+        for (int i = 0; i < 12; i++) scsp_voice_note_on(&fAlloc, fOps, fNumOps, 40 + i, &fWaveStore);
+        ASSERT(fAlloc.slot_used == 0x00FFFFFFu, "reserved slots left alone");
+        ASSERT_EQ(fAlloc.stats.steals, 0u, "no steals within budget");
+
+        scsp_voice_note_off(&fAlloc, 45);
+        ASSERT(fAlloc.slot_used == 0x00FFF3FFu, "key-off frees the slots at once");
+        int v = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 60, &fWaveStore);
+        ASSERT_EQ(fAlloc.voices[v].slot_base, 10, "freed slots reused");
+
+        v = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 61, &fWaveStore);
+        ASSERT_EQ(fAlloc.voices[v].slot_base, 0, "oldest note stolen");
+        ASSERT_EQ(fAlloc.stats.steals, 1u, "steal counted");
+        ASSERT_EQ(fAlloc.stats.last_key, 40, "stolen note reported");
+        ASSERT_EQ(fAlloc.stats.last_slot, 0, "at its slot");
+
+        /* A four-op note only steals the voices in the run it takes */
+        scsp_voice_note_off(&fAlloc, 43);
+        applyPatch({
+            { 1.0f, 0.8f, 0.0f,  31, 6,2,0,14,  0, -1,  1, 0, 1024,  true,  0 },
+            { 1.0f, 0.8f, 0.0f,  31, 6,2,0,14,  0, -1,  1, 0, 1024,  true,  0 },
+            { 1.0f, 0.8f, 0.0f,  31, 6,2,0,14,  0, -1,  1, 0, 1024,  true,  0 },
+            { 1.0f, 0.8f, 0.0f,  31, 6,2,0,14,  0, -1,  1, 0, 1024,  true,  0 },
+        });
+        v = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 63, &fWaveStore);
+        ASSERT_EQ(fAlloc.voices[v].slot_base, 4, "run next to the freed slots");
+        ASSERT_EQ(fAlloc.stats.steals, 2u, "one voice stolen for it");
+        ASSERT_EQ(fAlloc.stats.last_key, 42, "the one in the run");
+        ASSERT(fAlloc.note_voice[41] != 0, "older voice outside the run kept");
+
+        fAlloc.reserved_slots = 29;
+        ASSERT_EQ(scsp_voice_note_on(&fAlloc, fOps, fNumOps, 64, &fWaveStore), -1, "four ops over the budget");
+        ASSERT_EQ(fAlloc.stats.steals, 2u, "nothing stolen for it");
+        ASSERT_EQ(fAlloc.stats.drops, 1u, "drop counted");
+        ASSERT_EQ(fAlloc.stats.last_key, 64, "dropped note reported");
+
+        scsp_voice_all_off(&fAlloc);
+        fAlloc.reserved_slots = 31;
+        applyPatch({
+            { 2.0f, 0.9f, 0.0f,  31,12,8,0,14,  0, -1,  1, 0, 1024,  false, 0 },
+            { 1.0f, 0.8f, 0.0f,  31, 6,2,0,14,  9,  0,  1, 0, 1024,  true,  0 },
+        });
+        ASSERT_EQ(scsp_voice_note_on(&fAlloc, fOps, fNumOps, 62, &fWaveStore), -1, "no room for two slots");
+        ASSERT_EQ(fAlloc.stats.drops, 2u, "drop counted");
+        ASSERT_EQ(fAlloc.stats.last_key, 62, "dropped note reported");
+        fAlloc.reserved_slots = 0;
+        fAlloc.steal_mode = SCSP_STEAL_RELEASED;
+    }
+
+    /* ── Test 12: Controller updates ── */
+    printf("\n--- Test 12: Controller updates ---\n");
+    {
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        scsp_voice_init(&fWaveStore);
+        applyPatch({ { 1.0f, 0.8f, 0.0f,  31,0,0,0,14,  0, -1,  1, 0, 1024,  true, 0 } });
+
+        /* Rising zero crossings and peak of the left channel */
+        auto measure = [](int n, int *crossings) {
+            int16_t *buf = scsp_render(n);
+            int peak = 0, c = 0;
+            for (int i = 1; i < n; i++) {
+                if (buf[2 * (i - 1)] < 0 && buf[2 * i] >= 0) c++;
+                peak = std::max(peak, abs((int)buf[2 * i]));
+            }
+            if (crossings) *crossings = c;
+            return peak;
+        };
+
+        int v = scsp_voice_note_on(&fAlloc, fOps, fNumOps, 69, &fWaveStore);
+        scsp_voice_velocity(&fAlloc, v, 127);
+        scsp_render(1024);
+        int c0, c1, c2;
+        int p0 = measure(8192, &c0);
+
+        scsp_voice_pitch_bend(&fAlloc, 0, 1200);
+        measure(256, NULL);
+        measure(8192, &c1);
+        ASSERT(abs(c1 - 2 * c0) <= 2, "bend +1200 cents doubles the pitch");
+
+        scsp_voice_pitch_bend(&fAlloc, 0, 0);
+        measure(256, NULL);
+        measure(8192, &c2);
+        ASSERT_EQ(c2, c0, "bend 0 restores the note's own pitch");
+
+        scsp_voice_velocity(&fAlloc, v, 64);
+        int p1 = measure(4096, NULL);
+        ASSERT(p1 < p0 * 3 / 4 && p1 > p0 / 8, "velocity 64 is quieter");
+
+        scsp_voice_volume(&fAlloc, 0, 0);
+        ASSERT(measure(4096, NULL) < p0 / 100, "volume 0 silences");
+
+        scsp_voice_reset_controllers(&fAlloc, 0);
+        scsp_voice_velocity(&fAlloc, v, 127);
+        ASSERT(abs(measure(4096, NULL) - p0) <= p0 / 50, "reset restores the level");
+
+        /* New notes pick up the channel's current state */
+        scsp_voice_all_off(&fAlloc);
+        scsp_render(8192);
+        scsp_voice_pitch_bend(&fAlloc, 0, 1200);
+        scsp_voice_velocity(&fAlloc, scsp_voice_note_on(&fAlloc, fOps, fNumOps, 69, &fWaveStore), 127);
+        scsp_render(1024);
+        measure(8192, &c1);
+        ASSERT(abs(c1 - 2 * c0) <= 2, "new note starts bent");
+        scsp_voice_reset_controllers(&fAlloc, 0);
+        scsp_voice_all_off(&fAlloc);
+    }
+
+    /* ── Test 13: Sound RAM allocation ── */
+    printf("\n--- Test 13: Sound RAM allocation ---\n");
+    {
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        memset(&fWaveStore, 0, sizeof(fWaveStore));
+        scsp_voice_init(&fWaveStore);
+        int top = fWaveStore.next_free_offset;
+
+        std::vector<int16_t> a(1024), b(2048);
+        for (int i = 0; i < 1024; i++) a[i] = (i & 64) ? 12000 : -12000;
+        for (int i = 0; i < 2048; i++) b[i] = (int16_t)(16000 * sin(2 * M_PI * i / 64));
+
+        int ia = scsp_wave_store_add(&fWaveStore, a.data(), 1024, 0, 1024, 1);
+        int ia2 = scsp_wave_store_add(&fWaveStore, a.data(), 1024, 0, 1024, 1);
+        ASSERT_EQ(ia2, ia, "identical PCM shares one wave");
+        ASSERT_EQ(fWaveStore.next_free_offset, top + 2048, "shared wave stored once");
+
+        int ib = scsp_wave_store_add(&fWaveStore, b.data(), 2048, 0, 2048, 1);
+        scsp_wave_store_release(&fWaveStore, ia);
+        ASSERT_EQ(fWaveStore.num_holes, 0, "still referenced after one release");
+        scsp_wave_store_release(&fWaveStore, ia);
+        ASSERT_EQ(fWaveStore.num_holes, 1, "freed after the last release");
+        ASSERT_EQ(fWaveStore.holes[0].offset, top, "hole where the wave was");
+
+        /* Play the second wave, then slide it down over the hole */
+        applyPatch({ { 1.0f, 0.8f, 0.0f,  31,0,0,0,14,  0, -1,  1, 0, 2048,  true, 0 } });
+        setParameterValue(10, (float)ib);
+        scsp_voice_note_on(&fAlloc, fOps, fNumOps, 60, &fWaveStore);
+        scsp_render(2048);
+        auto peak = [](int n) {
+            int16_t *buf = scsp_render(n);
+            int m = 0;
+            for (int i = 0; i < 2 * n; i++) m = std::max(m, abs((int)buf[i]));
+            return m;
+        };
+        int p0 = peak(4096);
+        ASSERT_EQ(scsp_wave_store_compact(&fWaveStore), 1, "compaction moved one wave");
+        ASSERT_EQ(fWaveStore.waves[ib].ram_offset, top, "wave packed to the base");
+        ASSERT_EQ(fWaveStore.num_holes, 0, "no holes after compaction");
+        ASSERT_EQ(fWaveStore.next_free_offset, top + 4096, "top follows the packed wave");
+        int p1 = peak(4096);
+        ASSERT(abs(p1 - p0) <= p0 / 20, "playing voice follows the moved wave");
+        scsp_voice_all_off(&fAlloc);
+        scsp_render(8192);
+
+        /* Churn never runs out of RAM */
+        bool ok = true;
+        for (int i = 0; i < 100 && ok; i++) {
+            a[0] = (int16_t)i;   /* distinct content each time */
+            int id = scsp_wave_store_add(&fWaveStore, a.data(), 1024, 0, 1024, 1);
+            ok = id >= 0;
+            if (ok) scsp_wave_store_release(&fWaveStore, id);
+        }
+        ASSERT(ok, "100 add/release cycles succeed");
+        ASSERT_EQ(fWaveStore.next_free_offset, top + 4096, "churn leaves the heap where it was");
+        scsp_wave_store_release(&fWaveStore, ib);
+        ASSERT_EQ(fWaveStore.next_free_offset, top, "releasing everything empties the heap");
+    }
+
+    /* ── Test 14: 8-bit custom waves ── */
+    printf("\n--- Test 14: 8-bit custom waves ---\n");
+    {
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        memset(&fWaveStore, 0, sizeof(fWaveStore));
+        scsp_voice_init(&fWaveStore);
+        int top = fWaveStore.next_free_offset;
+
+        std::vector<int16_t> sq(1024);
+        for (int i = 0; i < 1024; i++) sq[i] = (i & 64) ? 12000 : -12000;
+
+        std::vector<int8_t> q(1024);
+        bool close = true;
+        for (int f = SCSP_PCM8_DITHER; f <= SCSP_PCM8_SHAPED; f++) {
+            scsp_pcm8_requantize(sq.data(), q.data(), 1024, f);
+            for (int i = 0; i < 1024; i++) close &= abs(q[i] * 256 - sq[i]) <= 3 * 256;
+        }
+        ASSERT(close, "requantized samples stay within a few LSB");
+
+        int i16 = scsp_wave_store_add(&fWaveStore, sq.data(), 1024, 0, 1024, 1);
+        int i8 = scsp_wave_store_add_format(&fWaveStore, sq.data(), 1024, 0, 1024, 1, SCSP_PCM8_SHAPED);
+        ASSERT(i8 != i16, "8-bit and 16-bit copies are separate waves");
+        ASSERT_EQ(fWaveStore.next_free_offset, top + 2048 + 1024, "8-bit wave takes one byte per sample");
+        ASSERT_EQ(scsp_wave_store_add_format(&fWaveStore, sq.data(), 1024, 0, 1024, 1, SCSP_PCM8_SHAPED),
+                  i8, "identical 8-bit waves share");
+
+        /* Both play at the same level (mean, since dither moves the peaks) */
+        auto level = [](int n) {
+            int16_t *buf = scsp_render(n);
+            long sum = 0;
+            for (int i = 0; i < 2 * n; i++) sum += abs((int)buf[i]);
+            return (int)(sum / (2 * n));
+        };
+        int p[2];
+        for (int k = 0; k < 2; k++) {
+            applyPatch({ { 1.0f, 0.8f, 0.0f,  31,0,0,0,14,  0, -1,  1, 0, 1024,  true, 0 } });
+            setParameterValue(10, (float)(k ? i8 : i16));
+            scsp_voice_note_on(&fAlloc, fOps, fNumOps, 60, &fWaveStore);
+            scsp_render(2048);
+            p[k] = level(4096);
+            scsp_voice_all_off(&fAlloc);
+            scsp_render(8192);
+        }
+        ASSERT(p[0] > 500, "16-bit wave sounds");
+        ASSERT(abs(p[1] - p[0]) <= p[0] / 20, "8-bit wave plays at the same level");
+
+        /* Odd-length 8-bit waves keep the next 16-bit wave aligned */
+        int odd = scsp_wave_store_add_format(&fWaveStore, sq.data(), 101, 0, 101, 1, SCSP_PCM8_DITHER);
+        int after = scsp_wave_store_add(&fWaveStore, sq.data(), 100, 0, 100, 1);
+        ASSERT(odd >= 0 && after >= 0, "both stored");
+        ASSERT_EQ(fWaveStore.waves[after].ram_offset & 1, 0, "16-bit wave after an odd 8-bit one is aligned");
+    }
+
+    /* ── Test 15: RAM a slot is reading stays put ── */
+    printf("\n--- Test 15: RAM a slot is reading stays put ---\n");
+    {
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        memset(&fWaveStore, 0, sizeof(fWaveStore));
+        scsp_voice_init(&fWaveStore);
+        fWaveStore.guard_playing = 1;
+        int top = fWaveStore.next_free_offset;
+
+        std::vector<int16_t> w[4];
+        for (int k = 0; k < 4; k++) {
+            w[k].resize(1024);
+            for (int i = 0; i < 1024; i++) w[k][i] = (int16_t)(16000 * sin(2 * M_PI * i * (k + 1) / 1024));
+        }
+        int ix = scsp_wave_store_add(&fWaveStore, w[0].data(), 1024, 0, 1024, 1);
+        int ia = scsp_wave_store_add(&fWaveStore, w[1].data(), 1024, 0, 1024, 1);
+        int ib = scsp_wave_store_add(&fWaveStore, w[2].data(), 1024, 0, 1024, 1);
+
+        /* A note plays wave b */
+        applyPatch({ { 1.0f, 0.8f, 0.0f,  31,0,0,0,14,  0, -1,  1, 0, 1024,  true, 0 } });
+        setParameterValue(10, (float)ib);
+        scsp_voice_note_on(&fAlloc, fOps, fNumOps, 60, &fWaveStore);
+        scsp_render(1024);
+
+        /* Compaction moves the idle wave but not the sounding one */
+        scsp_wave_store_release(&fWaveStore, ix);
+        ASSERT_EQ(fWaveStore.num_pending, 0, "an idle wave is freed at once");
+        scsp_wave_store_compact(&fWaveStore);
+        ASSERT_EQ(fWaveStore.waves[ia].ram_offset, top, "idle wave packed down");
+        ASSERT_EQ(fWaveStore.waves[ib].ram_offset, top + 4096, "sounding wave left in place");
+
+        /* Freeing the sounding wave parks its RAM */
+        scsp_wave_store_release(&fWaveStore, ib);
+        ASSERT_EQ(fWaveStore.num_pending, 1, "freed wave waits while it plays");
+        int ic = scsp_wave_store_add(&fWaveStore, w[3].data(), 1024, 0, 1024, 1);
+        ASSERT(ic >= 0 && fWaveStore.waves[ic].ram_offset != top + 4096, "new wave avoids the sounding block");
+
+        /* Once the note ends the block is reused */
+        scsp_voice_note_off(&fAlloc, 60);
+        for (int i = 0; i < 64 && scsp_slots_reading(top + 4096, 2048); i++) scsp_render(4096);
+        int id = scsp_wave_store_add(&fWaveStore, w[2].data(), 1024, 0, 1024, 1);
+        ASSERT_EQ(fWaveStore.num_pending, 0, "block reclaimed after the note");
+        ASSERT(id >= 0 && fWaveStore.waves[id].ram_offset == top + 4096, "reclaimed RAM reused");
+        fWaveStore.guard_playing = 0;
+    }
+
+    /* ── Test 16: Binary patch state ── */
+    printf("\n--- Test 16: Binary patch state ---\n");
+    {
+        /* LZ round trip on repetitive and on noisy data */
+        std::vector<uint8_t> in(50000), packed(scsp_lz_bound(50000)), out(50000);
+        for (size_t i = 0; i < in.size(); i++) in[i] = (uint8_t)((i / 7) % 13);
+        size_t n = scsp_lz_compress(in.data(), in.size(), packed.data());
+        ASSERT(n < in.size() / 10, "repetitive data compresses");
+        ASSERT(scsp_lz_decompress(packed.data(), n, out.data(), out.size()) == (long)in.size() && out == in,
+               "repetitive data round-trips");
+        uint32_t seed = 1;
+        for (auto& b : in) { seed = seed * 1664525u + 1013904223u; b = (uint8_t)(seed >> 24); }
+        n = scsp_lz_compress(in.data(), in.size(), packed.data());
+        ASSERT(n <= scsp_lz_bound(in.size()), "noise stays within the bound");
+        ASSERT(scsp_lz_decompress(packed.data(), n, out.data(), out.size()) == (long)in.size() && out == in,
+               "noise round-trips");
+        ASSERT_EQ(scsp_lz_decompress(packed.data(), n, out.data(), 100), -1, "overflow is refused");
+
+        /* Two ops sharing one PCM store it once */
+        std::vector<int16_t> pcm(20000);
+        for (size_t i = 0; i < pcm.size(); i++) pcm[i] = (int16_t)(12000 * sin(i * 0.05));
+        float params[kParameterCount];
+        for (int i = 0; i < kParameterCount; i++) params[i] = i * 0.5f;
+        scsp_state_op_t ops[MAX_OPS] = {};
+        ops[0] = { pcm.data(), (int)pcm.size(), SCSP_PCM16 };
+        ops[2] = { pcm.data(), (int)pcm.size(), SCSP_PCM8_SHAPED };
+
+        std::vector<uint8_t> raw(scsp_state_bound(kParameterCount, ops, MAX_OPS));
+        size_t rawSize = scsp_state_save(raw.data(), params, kParameterCount, ops, MAX_OPS, 0);
+        ASSERT(rawSize < 2 * pcm.size() + 1024, "shared PCM saved once");
+        std::vector<uint8_t> lz(raw.size());
+        size_t lzSize = scsp_state_save(lz.data(), params, kParameterCount, ops, MAX_OPS, 1);
+        ASSERT(lzSize < rawSize, "compressed state is smaller");
+
+        long body = scsp_state_body_size(lz.data(), lzSize, kParameterCount, MAX_OPS);
+        ASSERT_EQ(body, (long)(rawSize - SCSP_STATE_HEADER), "header gives the body size");
+        std::vector<int16_t> scratch((body + 1) / 2);
+        float back[kParameterCount] = {};
+        scsp_state_op_t opsBack[MAX_OPS] = {};
+        int no = scsp_state_load(lz.data(), lzSize, (uint8_t *)scratch.data(),
+                                 back, kParameterCount, opsBack, MAX_OPS);
+        ASSERT_EQ(no, MAX_OPS, "all ops read");
+        ASSERT(!memcmp(back, params, sizeof(params)), "params round-trip");
+        ASSERT(opsBack[0].pcm && opsBack[0].pcm == opsBack[2].pcm, "ops share the loaded wave");
+        ASSERT(opsBack[0].length == (int)pcm.size() &&
+               !memcmp(opsBack[0].pcm, pcm.data(), pcm.size() * 2), "PCM round-trips");
+        ASSERT(!opsBack[1].pcm && opsBack[2].format == SCSP_PCM8_SHAPED, "empty ops and formats kept");
+
+        /* Old text states, newer versions and damage are told apart */
+        const char *text = "2|1.0,0.8,31,0,0,0,14";
+        ASSERT_EQ(scsp_state_body_size((const uint8_t *)text, strlen(text), kParameterCount, MAX_OPS), -1, "text state isn't binary");
+        std::vector<uint8_t> bad = lz;
+        bad[4] = SCSP_STATE_VERSION + 1;
+        ASSERT_EQ(scsp_state_body_size(bad.data(), lzSize, kParameterCount, MAX_OPS), -1, "newer version refused");
+        bad = lz;
+        bad[11] = 0xFF;
+        ASSERT_EQ(scsp_state_body_size(bad.data(), lzSize, kParameterCount, MAX_OPS), -2,
+                  "body beyond what the ops can hold refused");
+        bad = raw;
+        bad[8] ^= 1;
+        ASSERT_EQ(scsp_state_body_size(bad.data(), rawSize, kParameterCount, MAX_OPS), -2,
+                  "uncompressed body must match what's stored");
+        bad = raw;
+        bad[rawSize - 1] ^= 0x55;
+        ASSERT_EQ(scsp_state_load(bad.data(), rawSize, (uint8_t *)scratch.data(),
+                                  back, kParameterCount, opsBack, MAX_OPS), -1, "damaged PCM caught by its hash");
+    }
+
+    /* ── Test 17: Kit reloads while a kit note plays ── */
+    printf("\n--- Test 17: Kit reload while playing ---\n");
+    if (!kit.empty()) {
+        const std::vector<uint8_t> &ton = kit;
+        memset(&fAlloc, 0, sizeof(fAlloc));
+        memset(&fWaveStore, 0, sizeof(fWaveStore));
+        scsp_voice_init(&fWaveStore);
+        fWaveStore.guard_playing = 1;
+
+        static scsp_ton_bank_t oldBank, newBank;
+        int base = fWaveStore.next_free_offset;
+        scsp_wave_store_load_ton(&fWaveStore, &oldBank, ton.data(), (uint32_t)ton.size());
+        int oldEnd = fWaveStore.kit_end;
+        scsp_voice_note_on_ton(&fAlloc, &oldBank, 0, 60);
+        scsp_render(1024);
+
+        /* The new kit lands above the old one, which stays taken */
+        ASSERT_EQ(scsp_wave_store_load_ton(&fWaveStore, &newBank, ton.data(), (uint32_t)ton.size()), 16,
+                  "kit reloaded");
+        ASSERT(fWaveStore.kit_offset >= oldEnd, "new kit avoids the old kit's RAM");
+        ASSERT_EQ(fWaveStore.num_old_kits, 1, "old kit held");
+        std::vector<int16_t> pcm(1024, 1000);
+        int id = scsp_wave_store_add(&fWaveStore, pcm.data(), 1024, 0, 1024, 1);
+        ASSERT(id >= 0 && fWaveStore.waves[id].ram_offset >= fWaveStore.kit_end, "held kit not handed out");
+        scsp_wave_store_compact(&fWaveStore);
+        ASSERT(fWaveStore.waves[id].ram_offset >= fWaveStore.kit_end, "compaction leaves the held kit be");
+
+        /* Released while its note plays, it waits for the tail */
+        scsp_wave_store_release_old_kits(&fWaveStore);
+        ASSERT(fWaveStore.num_old_kits == 0 && fWaveStore.num_pending == 1, "old kit pending while read");
+        scsp_voice_note_off(&fAlloc, 60);
+        for (int i = 0; i < 64 && scsp_slots_reading(base, oldEnd - base); i++) scsp_render(4096);
+        scsp_wave_store_release(&fWaveStore, id);
+        scsp_wave_store_compact(&fWaveStore);
+        ASSERT_EQ(fWaveStore.num_pending, 0, "old kit reclaimed after its tail");
+        id = scsp_wave_store_add(&fWaveStore, pcm.data(), 1024, 0, 1024, 1);
+        ASSERT(id >= 0 && fWaveStore.waves[id].ram_offset == base, "old kit's RAM reused");
+        fWaveStore.guard_playing = 0;
+    }
+
     /* ── Summary ── */
     printf("\n==================================================\n");
     printf("Passed: %d  Failed: %d\n", passed, failed);
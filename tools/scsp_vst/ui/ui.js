@@ -67,10 +67,49 @@ function generateWaveform(type, n) {
     }
 }
 
+/* Bytes per bridge call for kit files (must not exceed kMaxChunk) */
+const FILE_CHUNK = 192 * 1024;
+
+/* Custom wave storage (must match scsp_pcm_format_t) */
+const WAVE_FORMAT_NAMES = ['16-bit', '8-bit dither', '8-bit shaped'];
+
+/* The plugin's 8-bit requantization (scsp_pcm8_requantize), for previews.
+ * Takes float samples as sent to the DSP; returns floats on the 8-bit grid. */
+function requantizePcm8(samples, format) {
+    const out = new Float32Array(samples.length);
+    let seed = 0x2545F491, err = 0;
+    for (let i = 0; i < samples.length; i++) {
+        seed = (Math.imul(seed, 1664525) + 1013904223) >>> 0;
+        const r1 = (seed >>> 8) / 16777216;
+        seed = (Math.imul(seed, 1664525) + 1013904223) >>> 0;
+        const r2 = (seed >>> 8) / 16777216;
+
+        const s16 = Math.max(-32768, Math.min(32767, Math.round(samples[i] * 32767)));
+        const v = format === 2 ? s16 / 256 - err : s16 / 256;
+        const q = Math.max(-128, Math.min(127, Math.floor(v + r1 - r2 + 0.5)));
+        err = q - v;
+        out[i] = q * 256 / 32767;
+    }
+    return out;
+}
+
 /* Global param indices (must match C++ enum) */
 const IDX_NUM_OPS = MAX_OPS * PARAMS_PER_OP;  // 84
 const IDX_CARRIER_BASE = IDX_NUM_OPS + 1;      // 85-90
 const IDX_PROGRAM_NUM = IDX_CARRIER_BASE + 6;  // 91
+const IDX_ACTIVE_SLOTS = IDX_PROGRAM_NUM + 4;  // 95-101: read-only outputs
+const IDX_NOTE_ON_LOAD = IDX_ACTIVE_SLOTS + 6;
+
+/* Output params → usage bar element, formatter */
+const USAGE_OUTPUTS = [
+    ['usage-slots',   v => Math.round(v)],
+    ['usage-peak',    v => Math.round(v)],
+    ['usage-dropped', v => Math.round(v)],
+    ['usage-stolen',  v => Math.round(v)],
+    ['usage-dsp',     v => v >= 0.5 ? 'on' : 'off'],
+    ['usage-render',  v => (v * 100).toFixed(1)],
+    ['usage-noteon',  v => (v * 100).toFixed(1)],
+];
 
 /* SCSP rate tables for envelope visualization */
 const AR_TIMES = [100000,100000,8100,6900,6000,4800,4000,3400,3000,2400,2000,1700,1500,1200,1000,860,760,600,500,430,380,300,250,220,190,150,130,110,95,76,63,55];
@@ -128,6 +167,8 @@ class SCSPSynthUI extends DISTRHO.UI {
         this.sliders = {};  // paramIndex → {input, val}
         this.numOps = 2;
         this.activeTab = 0;
+        this.kitNative = false;  // DSP is playing the shared kit natively (load_kit)
+        this.waveFormats = [0, 0, 0, 0, 0, 0];  // scsp_pcm_format_t per op
         this.buildPresets();
         this.buildJsonButtons();
         this.buildNumOps();
@@ -191,6 +232,8 @@ class SCSPSynthUI extends DISTRHO.UI {
             this.setParameterValue(IDX_PROGRAM_NUM, prog);
             if (this.tonPatches && prog < this.tonPatches.length) {
                 this._applyPatch(this.tonPatches[prog]);
+                /* load_patch switched the DSP to operators; go back to the kit */
+                if (this.kitNative) this.setState('load_kit', this.kitPath);
             }
         });
     }
@@ -481,6 +524,7 @@ class SCSPSynthUI extends DISTRHO.UI {
                         return;
                     }
                     this.tonPatches = result.patches;
+                    this.kitNative = false;
                     const progNum = parseInt(document.getElementById('program-num-select').value);
                     const idx = Math.min(progNum, this.tonPatches.length - 1);
                     document.getElementById('program-num-select').value = idx;
@@ -530,6 +574,40 @@ class SCSPSynthUI extends DISTRHO.UI {
         };
     }
 
+    /* ── Chunked native file I/O ── */
+
+    /* Read a file through the bridge a chunk at a time, decoding each into
+     * one preallocated buffer.  Returns an ArrayBuffer, or null if the file
+     * doesn't exist. */
+    async readFileChunked(path, label) {
+        const size = await this.call('fileSize', path);
+        if (!(size > 0)) return null;
+        const bytes = new Uint8Array(size);
+        for (let off = 0; off < size; off += FILE_CHUNK) {
+            const n = Math.min(FILE_CHUNK, size - off);
+            const b64 = await this.call('readFileChunk', path, off, n);
+            if (!b64 || _b64Into(b64, bytes, off) !== n) throw new Error('read failed at byte ' + off);
+            if (label && size > FILE_CHUNK) this.showStatus(label + ' ' + Math.round((off + n) * 100 / size) + '%');
+        }
+        return bytes.buffer;
+    }
+
+    /* Write a file through the bridge a chunk at a time, into a sibling
+     * temporary that replaces path only once every chunk is written.
+     * Returns false, with path untouched, if any step fails. */
+    async writeFileChunked(path, data, label) {
+        const bytes = data instanceof Uint8Array ? data : new Uint8Array(data);
+        const tmp = path + '.tmp';
+        let off = 0;
+        do {
+            const chunk = bytes.subarray(off, Math.min(off + FILE_CHUNK, bytes.length));
+            if (!await this.call('writeFileChunk', tmp, off, _arrayBufferToB64(chunk))) return false;
+            off += chunk.length;
+            if (label && bytes.length > FILE_CHUNK) this.showStatus(label + ' ' + Math.round(off * 100 / bytes.length) + '%');
+        } while (off < bytes.length);
+        return !!await this.call('replaceFile', tmp, path);
+    }
+
     async saveToKit() {
         if (typeof TonIO === 'undefined' || !TonIO) {
             this.showStatus('TON I/O not available');
@@ -543,15 +621,14 @@ class SCSPSynthUI extends DISTRHO.UI {
         const progNum = parseInt(document.getElementById('program-num-select').value);
         const patch = this._buildTonPatch();
 
-        // Read existing kit file (may not exist yet)
-        let existingBuffer = null;
+        // Read existing kit file: null means it doesn't exist yet, so start
+        // fresh.  A read that fails partway must not replace the kit.
+        let existingBuffer;
         try {
-            const b64 = await this.call('readBinaryFile', this.kitPath);
-            if (b64 && b64.length > 0) {
-                existingBuffer = _b64ToArrayBuffer(b64);
-            }
+            existingBuffer = await this.readFileChunked(this.kitPath, 'Reading kit');
         } catch (e) {
-            // File doesn't exist yet — start fresh
+            this.showStatus('Read error, kit not saved: ' + e);
+            return;
         }
 
         let tonData;
@@ -568,9 +645,8 @@ class SCSPSynthUI extends DISTRHO.UI {
         }
 
         // Write back
-        const b64out = _arrayBufferToB64(tonData);
         try {
-            const ok = await this.call('writeBinaryFile', this.kitPath, b64out);
+            const ok = await this.writeFileChunked(this.kitPath, tonData, 'Writing kit');
             this.showStatus(ok ? 'Saved prog ' + progNum + ' to kit' : 'Write failed');
         } catch (e) {
             this.showStatus('Write error: ' + e);
@@ -589,19 +665,18 @@ class SCSPSynthUI extends DISTRHO.UI {
 
         const progNum = parseInt(document.getElementById('program-num-select').value);
 
-        let b64;
+        let buffer;
         try {
-            b64 = await this.call('readBinaryFile', this.kitPath);
+            buffer = await this.readFileChunked(this.kitPath, 'Reading kit');
         } catch (e) {
             this.showStatus('Read error: ' + e);
             return;
         }
-        if (!b64 || b64.length === 0) {
+        if (!buffer) {
             this.showStatus('Kit file not found');
             return;
         }
 
-        const buffer = _b64ToArrayBuffer(b64);
         const result = TonIO.importTon(buffer);
         if (!result.patches || result.patches.length === 0) {
             this.showStatus('No voices in kit');
@@ -614,6 +689,10 @@ class SCSPSynthUI extends DISTRHO.UI {
             this.setParameterValue(IDX_PROGRAM_NUM, idx);
         }
         this._applyPatch(this.tonPatches[idx]);
+        /* The DSP reads the kit itself and plays its voices from native
+         * register images; the patch above only fills in the editor. */
+        this.setState('load_kit', this.kitPath);
+        this.kitNative = true;
         this.showStatus('Loaded kit: ' + this.tonPatches.length + ' voices, showing prog ' + idx);
     }
 
@@ -808,6 +887,23 @@ class SCSPSynthUI extends DISTRHO.UI {
         loadBtn.addEventListener('click', () => this.loadWavForOp(opIdx));
         row4.appendChild(loadBtn);
 
+        /* Storage format for custom PCM */
+        const fmtSel = document.createElement('select');
+        fmtSel.id = 'wave-format-select';
+        fmtSel.title = 'How a loaded WAV is stored in sound RAM';
+        WAVE_FORMAT_NAMES.forEach((name, i) => {
+            const opt = document.createElement('option');
+            opt.value = i; opt.textContent = name;
+            fmtSel.appendChild(opt);
+        });
+        fmtSel.value = this.waveFormats[opIdx];
+        fmtSel.addEventListener('change', () => {
+            this.waveFormats[opIdx] = parseInt(fmtSel.value);
+            this.setState('wave_format', this.waveFormats.join(','));
+            this.drawWaveformPreview(opIdx);
+        });
+        row4.appendChild(fmtSel);
+
         /* Waveform preview canvas */
         const wvCanvas = document.createElement('canvas');
         wvCanvas.id = 'waveform-preview';
@@ -1130,6 +1226,32 @@ class SCSPSynthUI extends DISTRHO.UI {
         }
         ctx.stroke();
 
+        /* 8-bit preview: the stored wave's error, and what it costs and saves */
+        const isCustom = this.customWaves && this.customWaves[opIdx];
+        const format = isCustom ? this.waveFormats[opIdx] : 0;
+        let storage = '';
+        if (isCustom) {
+            const kb = (bytes) => (bytes / 1024).toFixed(1) + ' KB';
+            storage = WAVE_FORMAT_NAMES[format] + ' ' + kb(format ? n : n * 2);
+            if (format) {
+                const q = requantizePcm8(samples, format);
+                let sig = 0, noise = 0;
+                ctx.strokeStyle = '#ff6644'; ctx.lineWidth = 1;
+                ctx.beginPath();
+                for (let i = 0; i < n; i++) {
+                    const e = q[i] - samples[i];
+                    sig += samples[i] * samples[i];
+                    noise += e * e;
+                    const x = i / n * w;
+                    const y = h / 2 - e * 16 * (h / 2 - 4);  /* error, x16 */
+                    if (i === 0) ctx.moveTo(x, y); else ctx.lineTo(x, y);
+                }
+                ctx.stroke();
+                const snr = noise > 0 ? 10 * Math.log10(sig / noise) : 99;
+                storage += ' (saves ' + kb(n) + ', SNR ' + snr.toFixed(0) + ' dB)';
+            }
+        }
+
         /* Center line */
         ctx.strokeStyle = '#333'; ctx.setLineDash([2, 4]); ctx.lineWidth = 0.5;
         ctx.beginPath(); ctx.moveTo(0, h/2); ctx.lineTo(w, h/2); ctx.stroke();
@@ -1137,8 +1259,12 @@ class SCSPSynthUI extends DISTRHO.UI {
 
         /* Label */
         ctx.fillStyle = '#555'; ctx.font = '9px monospace';
-        const isCustom = this.customWaves && this.customWaves[opIdx];
         ctx.fillText(isCustom ? 'Custom (' + n + ' smp)' : (WAVE_NAMES[waveType] || '?'), 4, 12);
+        if (storage) {
+            ctx.textAlign = 'right';
+            ctx.fillText(storage, w - 4, 12);
+            ctx.textAlign = 'left';
+        }
         if (loopMode > 0) {
             ctx.fillText(LOOP_NAMES[loopMode] + ' ' + loopStart + '-' + loopEnd, 4, h - 4);
         } else {
@@ -1151,8 +1277,18 @@ class SCSPSynthUI extends DISTRHO.UI {
     /* Stub methods for C++ bridge responses — needed so dpf.js can resolve call() promises */
     readBinaryFile() {}
     writeBinaryFile() {}
+    fileSize() {}
+    readFileChunk() {}
+    writeFileChunk() {}
+    replaceFile() {}
 
     parameterChanged(index, value) {
+        /* Usage outputs from the plugin */
+        if (index >= IDX_ACTIVE_SLOTS && index <= IDX_NOTE_ON_LOAD) {
+            const [id, fmt] = USAGE_OUTPUTS[index - IDX_ACTIVE_SLOTS];
+            document.getElementById(id).textContent = fmt(value);
+            return;
+        }
         /* Update program number */
         if (index === IDX_PROGRAM_NUM) {
             document.getElementById('program-num-select').value = Math.round(value);
@@ -1290,6 +1426,13 @@ class SCSPSynthUI extends DISTRHO.UI {
     }
 
     stateChanged(key, value) {
+        if (key === 'wave_format' && value) {
+            this.waveFormats = value.split(',').map(v => parseInt(v) || 0);
+            while (this.waveFormats.length < MAX_OPS) this.waveFormats.push(0);
+            const sel = document.getElementById('wave-format-select');
+            if (sel) sel.value = this.waveFormats[this.activeTab];
+            this.drawWaveformPreview(this.activeTab);
+        }
         if (key === 'kit_path' && value) {
             this.kitPath = value;
             const label = document.getElementById('kit-path-label');
@@ -1299,11 +1442,12 @@ class SCSPSynthUI extends DISTRHO.UI {
 }
 
 /* ── Base64 helpers for kit file I/O ── */
-function _b64ToArrayBuffer(b64) {
+/* Decode base64 into dest at offset; returns the bytes written */
+function _b64Into(b64, dest, offset) {
     const bin = atob(b64);
-    const bytes = new Uint8Array(bin.length);
-    for (let i = 0; i < bin.length; i++) bytes[i] = bin.charCodeAt(i);
-    return bytes.buffer;
+    const n = Math.min(bin.length, dest.length - offset);
+    for (let i = 0; i < n; i++) dest[offset + i] = bin.charCodeAt(i);
+    return n;
 }
 
 function _arrayBufferToB64(data) {
@@ -458,6 +458,12 @@ static void SCSP_UpdateSlotReg(struct _SCSP *SCSP,int s,int r)
 		case 0x13:
 			Compute_LFO(slot);
 			break;
+		case 0x14:
+		case 0x15:
+		case 0x16:
+		case 0x17:
+			SCSPDSP_SetRouting(&SCSP->DSP,s,IMXL(slot),EFSDL(slot));
+			break;
 	}
 }
 
@@ -560,6 +566,22 @@ static void SCSP_UpdateSlotRegR(struct _SCSP *SCSP, int slot,int reg)
 
 }
 
+//Store count slot words from word 0 and refresh the derived state once.
+//KEYONEX is masked out of word 0: keying stays with the caller.
+void SCSP_WriteSlot(struct _SCSP *SCSP, int s, const UINT16 *regs, int count)
+{
+	struct _SLOT *slot=SCSP->Slots+s;
+	int r;
+
+	if(count>0x10) count=0x10;
+	for(r=0; r<count; ++r)
+		slot->udata.data[r]=regs[r];
+	if(count>0)
+		slot->udata.data[0]&=~0x1000;
+	for(r=1; r<count; ++r)
+		SCSP_UpdateSlotReg(SCSP,s,r*2);
+}
+
 static void SCSP_UpdateRegR(struct _SCSP *SCSP, int reg)
 {
 	switch(reg&0x3f)
@@ -614,12 +636,15 @@ static void SCSP_w16(struct _SCSP *SCSP,unsigned int addr,unsigned short val)
 	else
 	{
 		//DSP
-		if(addr<0x780)	//COEF
-			*((unsigned short *) (SCSP->DSP.COEF+(addr-0x700)/2))=val;
+		if(addr<0x780)	//COEF (a register write also cancels a ramp)
+			SCSPDSP_RampCoef(&SCSP->DSP,(addr-0x700)/2,(INT16) val,0,DSPRAMP_LINEAR);
 		else if(addr<0x800)
-			*((unsigned short *) (SCSP->DSP.MADRS+(addr-0x780)/2))=val;
+			SCSPDSP_RampMadrs(&SCSP->DSP,(addr-0x780)/2,val,0,DSPRAMP_LINEAR);
 		else if(addr<0xC00)
+		{
 			*((unsigned short *) (SCSP->DSP.MPRO+(addr-0x800)/2))=val;
+			SCSP->DSP.Dirty=1;
+		}
 
 		if(addr==0xBF0)
 		{
@@ -845,11 +870,68 @@ INLINE INT32 SCSP_UpdateSlot(struct _SCSP *SCSP, struct _SLOT *slot)
 	return sample;
 }
 
+//Vectorized output mix (-msimd128 builds).  Slot outputs can't be computed
+//in parallel, FM reads the previous slots' ring buffer entries within the
+//same sample, but once they are known the level/pan products are
+//independent.  Integer sums don't depend on order, so this matches the
+//scalar mix bit for bit.  Define SCSP_SIMD_MIX to build it natively.
+#if defined(__wasm_simd128__) && !defined(SCSP_NO_SIMD)
+#define SCSP_SIMD_MIX 1
+#endif
+
+#ifdef SCSP_SIMD_MIX
+typedef INT32 MIXV __attribute__((vector_size(16)));
+
+//sum of (smp[i]*gain[i])>>SHIFT, n a multiple of 4
+static INT32 SCSP_MixSum(const INT32 *smp, const INT32 *gain, int n)
+{
+	MIXV acc={0,0,0,0};
+	int i;
+
+	for(i=0; i<n; i+=4)
+		acc+=(*(const MIXV *)(smp+i) * *(const MIXV *)(gain+i))>>SHIFT;
+	return acc[0]+acc[1]+acc[2]+acc[3];
+}
+#endif
+
+#define METER_SLOT	(1.0f/(32768*4))	//slot terms are summed before the final >>2
+#define METER_OUT	(1.0f/32768)
+
+static void SCSP_MeterAdd(float *peak, float *sum, float v)
+{
+	float a=v<0?-v:v;
+	if(a>*peak) *peak=a;
+	*sum+=v*v;
+}
+
+static void SCSP_MeterSlot(struct _SCSP_METER *m, int sl, INT32 l, INT32 r)
+{
+	float fl=l*METER_SLOT, fr=r*METER_SLOT;
+	float al=fl<0?-fl:fl, ar=fr<0?-fr:fr;
+	if(al>m->SlotPeak[sl]) m->SlotPeak[sl]=al;
+	if(ar>m->SlotPeak[sl]) m->SlotPeak[sl]=ar;
+	m->SlotSum[sl]+=(fl*fl+fr*fr)*0.5f;
+}
+
+void SCSP_MeterReset(struct _SCSP *SCSP)
+{
+	UINT32 on=SCSP->Meter.Enabled;
+	memset(&SCSP->Meter,0,sizeof(SCSP->Meter));
+	SCSP->Meter.Enabled=on;
+}
+
 static void SCSP_DoMasterSample(struct _SCSP *SCSP, stereo_sample_t *sample)
 {
 	int sl, i;
 
 	INT32 smpl, smpr;
+#ifdef SCSP_SIMD_MIX
+	//32 slots, padding to a multiple of 4, then 16 EFREGs
+	INT32 msmp[48] __attribute__((aligned(16)));
+	INT32 mlgain[48] __attribute__((aligned(16)));
+	INT32 mrgain[48] __attribute__((aligned(16)));
+	int n=0;
+#endif
 
 	smpl = smpr = 0;
 
@@ -868,13 +950,29 @@ static void SCSP_DoMasterSample(struct _SCSP *SCSP, stereo_sample_t *sample)
 
 			sample=SCSP_UpdateSlot(SCSP, slot);
 
-			Enc=((TL(slot))<<0x0)|((IMXL(slot))<<0xd);
-			SCSPDSP_SetSample(&SCSP->DSP,(sample*SCSP->LPANTABLE[Enc])>>(SHIFT-2),ISEL(slot),IMXL(slot));
+			if(IMXL(slot))	//IMXL 0 sends nothing
+			{
+				Enc=((TL(slot))<<0x0)|((IMXL(slot))<<0xd);
+				SCSPDSP_SetSample(&SCSP->DSP,(sample*SCSP->LPANTABLE[Enc])>>(SHIFT-2),ISEL(slot),IMXL(slot));
+			}
 			Enc=((TL(slot))<<0x0)|((DIPAN(slot))<<0x8)|((DISDL(slot))<<0xd);
+#ifdef SCSP_SIMD_MIX
+			msmp[n]=sample;
+			mlgain[n]=SCSP->LPANTABLE[Enc];
+			mrgain[n]=SCSP->RPANTABLE[Enc];
+			++n;
+			if(SCSP->Meter.Enabled)
+				SCSP_MeterSlot(&SCSP->Meter,sl,(sample*SCSP->LPANTABLE[Enc])>>SHIFT,(sample*SCSP->RPANTABLE[Enc])>>SHIFT);
+#else
 			{
-				smpl+=(sample*SCSP->LPANTABLE[Enc])>>SHIFT;
-				smpr+=(sample*SCSP->RPANTABLE[Enc])>>SHIFT;
+				INT32 l=(sample*SCSP->LPANTABLE[Enc])>>SHIFT;
+				INT32 r=(sample*SCSP->RPANTABLE[Enc])>>SHIFT;
+				smpl+=l;
+				smpr+=r;
+				if(SCSP->Meter.Enabled)
+					SCSP_MeterSlot(&SCSP->Meter,sl,l,r);
 			}
+#endif
 		}
 
 		#if FM_DELAY
@@ -890,6 +988,21 @@ static void SCSP_DoMasterSample(struct _SCSP *SCSP, stereo_sample_t *sample)
 
 	SCSPDSP_Step(&SCSP->DSP);
 
+#ifdef SCSP_SIMD_MIX
+	for(; n&3; ++n)
+		msmp[n]=mlgain[n]=mrgain[n]=0;
+	for(i=0; i<16; ++i, ++n)
+	{
+		struct _SLOT *slot=SCSP->Slots+i;
+		unsigned short Enc=((EFPAN(slot))<<0x8)|((EFSDL(slot))<<0xd);	//EFSDL 0 has gain 0
+
+		msmp[n]=SCSP->DSP.EFREG[i];
+		mlgain[n]=SCSP->LPANTABLE[Enc];
+		mrgain[n]=SCSP->RPANTABLE[Enc];
+	}
+	smpl=SCSP_MixSum(msmp,mlgain,n);
+	smpr=SCSP_MixSum(msmp,mrgain,n);
+#else
 	for(i=0; i<16; ++i)
 	{
 		struct _SLOT *slot=SCSP->Slots+i;
@@ -900,10 +1013,21 @@ static void SCSP_DoMasterSample(struct _SCSP *SCSP, stereo_sample_t *sample)
 			smpr+=(SCSP->DSP.EFREG[i]*SCSP->RPANTABLE[Enc])>>SHIFT;
 		}
 	}
+#endif
 
 	sample->l = ICLIP16(smpl>>2);
 	sample->r = ICLIP16(smpr>>2);
 
+	if(SCSP->Meter.Enabled)
+	{
+		struct _SCSP_METER *m=&SCSP->Meter;
+		for(i=0; i<16; ++i)
+			SCSP_MeterAdd(&m->EfPeak[i],&m->EfSum[i],SCSP->DSP.EFREG[i]*METER_OUT);
+		SCSP_MeterAdd(&m->MasterPeak[0],&m->MasterSum[0],sample->l*METER_OUT);
+		SCSP_MeterAdd(&m->MasterPeak[1],&m->MasterSum[1],sample->r*METER_OUT);
+		++m->Samples;
+	}
+
 	SCSP_TimersAddTicks(SCSP, 1);
 	CheckPendingIRQ(SCSP);
 }
@@ -140,6 +140,54 @@ struct _SLOT
 #define SCITMA	6
 #define SCITMB	7
 
+//native code generation for decoded programs, see scspdsp_jit.c
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(__EMSCRIPTEN__) && !defined(SCSPDSP_NO_JIT)
+#define SCSPDSP_JIT 1
+#endif
+
+//pre-decoded MPRO step flags (see SCSPDSP_Decode)
+#define DSPOP_TWT	0x0001
+#define DSPOP_XSEL	0x0002
+#define DSPOP_IWT	0x0004
+#define DSPOP_TABLE	0x0008
+#define DSPOP_MWT	0x0010	//only set on odd steps, memory access is ignored on even ones
+#define DSPOP_MRD	0x0020	//ditto
+#define DSPOP_EWT	0x0040
+#define DSPOP_ADRL	0x0080
+#define DSPOP_FRCL	0x0100
+#define DSPOP_YRL	0x0200
+#define DSPOP_NEGB	0x0400
+#define DSPOP_ZERO	0x0800
+#define DSPOP_BSEL	0x1000
+#define DSPOP_NOFL	0x2000
+#define DSPOP_ADREB	0x4000
+#define DSPOP_NXADR	0x8000
+
+//pre-decoded MPRO step
+struct _SCSPDSP_OP
+{
+	UINT16 FLAGS;	//DSPOP_*
+	UINT8 TRA,TWA;
+	UINT8 IRA,IWA;
+	UINT8 YSEL,SHIFT;
+	UINT8 COEF,MASA;	//indices, so live COEF/MADRS writes keep working
+	UINT8 EWA;
+	UINT8 STEP;	//original MPRO step
+};
+
+//COEF/MADRS glide shapes, see SCSPDSP_RampCoef
+#define DSPRAMP_LINEAR	0
+#define DSPRAMP_EXP	1	//one-pole approach, -60dB of the distance left at the end
+
+struct _SCSPDSP_RAMP
+{
+	double Cur;
+	double Inc;	//per sample increment (linear) or decay factor (exp)
+	INT32 Target;
+	UINT32 Left;	//samples to go
+	int Shape;
+};
+
 //the DSP Context
 struct _SCSPDSP
 {
@@ -167,12 +215,73 @@ struct _SCSPDSP
 
 	int Stopped;
 	int LastStep;
+
+//decoded program
+	struct _SCSPDSP_OP OPS[128];
+	int NumOps;
+	int Dirty;	//MPRO written since last decode
+
+//compiled program (SCSPDSP_JIT builds only)
+	void *JitCode;	//entry point, NULL = interpret OPS
+	int JitStale;	//OPS decoded since JitCode was built, interpret until SCSPDSP_Compile
+	size_t JitSize;
+	int NoJit;	//force the interpreter
+	int NoElim;	//decode every step, dead or not (reference runs)
+
+//routing, kept current by SCSPDSP_SetRouting on slot register writes
+	UINT32 InSlots;	//slots with IMXL!=0
+	UINT32 OutSlots;	//EFREG channels with EFSDL!=0
+	int Bypassed;	//program skipped until an EFREG is routed out again
+
+//parameter ramps, advanced once per sample by SCSPDSP_Step
+	struct _SCSPDSP_RAMP RAMPS[64+32];	//COEF, then MADRS
+	UINT64 RampCoef;	//active COEF ramps
+	UINT32 RampMadrs;	//active MADRS ramps
+};
+
+//result of SCSPDSP_Analyze
+struct _SCSPDSP_INFO
+{
+	int Steps;	//last non-NOP step + 1
+	int ActiveSteps;	//steps left after dead step elimination
+	int MemReads,MemWrites;	//MRD/MWT on active steps
+	UINT32 RingWords;	//highest ring buffer offset reached + 1, 0 = no delay memory
+	UINT32 TableWords;	//same for TABLE (non-ring) accesses
+	int MinRBL;	//smallest RBL selector (0-3 = 8K-64K words) covering RingWords
+	UINT32 TempRead[4],TempWrite[4];	//TRA/TWA offsets used, 128 bits
+	UINT32 MemsRead,MemsWrite;	//MEMS indices read/written
+	int TempLive;	//some active step reads TEMP, so TEMP writes matter
+	UINT32 MemsLive;	//MEMS indices read by active steps
 };
 
 void SCSPDSP_Init(struct _SCSPDSP *DSP);
+void SCSPDSP_Decode(struct _SCSPDSP *DSP);
 void SCSPDSP_SetSample(struct _SCSPDSP *DSP, INT32 sample, INT32 SEL, INT32 MXL);
 void SCSPDSP_Step(struct _SCSPDSP *DSP);
 void SCSPDSP_Start(struct _SCSPDSP *DSP);
+void SCSPDSP_Compile(struct _SCSPDSP *DSP);
+int SCSPDSP_Reload(struct _SCSPDSP *DSP, const UINT16 *MPRO, const INT16 *COEF, const UINT16 *MADRS, UINT32 ramp);
+void SCSPDSP_JitFree(struct _SCSPDSP *DSP);
+void SCSPDSP_Analyze(const struct _SCSPDSP *DSP, struct _SCSPDSP_INFO *info);
+void SCSPDSP_RampCoef(struct _SCSPDSP *DSP, int index, INT16 target, UINT32 samples, int shape);
+void SCSPDSP_RampMadrs(struct _SCSPDSP *DSP, int index, UINT16 target, UINT32 samples, int shape);
+void SCSPDSP_SetRouting(struct _SCSPDSP *DSP, int slot, int imxl, int efsdl);
+
+//Level meters, accumulated in SCSP_DoMasterSample while Enabled and
+//cleared by SCSP_MeterReset.  1.0 is full scale; sums are of squares, so
+//RMS = sqrt(Sum/Samples).  All words are 32 bit for readers mapping the
+//struct straight out of memory.
+struct _SCSP_METER
+{
+	UINT32 Enabled;
+	UINT32 Samples;		//accumulated since the last reset
+	float SlotPeak[32];	//direct output (DISDL/DIPAN applied), max of |L|,|R|
+	float SlotSum[32];	//(L*L+R*R)/2
+	float EfPeak[16];	//EFREG, before EFSDL/EFPAN
+	float EfSum[16];
+	float MasterPeak[2];	//final output L, R
+	float MasterSum[2];
+};
 
 struct _SCSP
 {
@@ -215,6 +324,8 @@ struct _SCSP
 	int ARTABLE[64], DRTABLE[64];
 
 	struct _SCSPDSP DSP;
+
+	struct _SCSP_METER Meter;
 };
 
 extern struct _SCSP SCSP;
@@ -229,6 +340,8 @@ struct SCSPinterface
 
 void *scsp_start(const void *config);
 void SCSP_Update(void *param, INT16 **inputs, stereo_sample_t *sample);
+void SCSP_MeterReset(struct _SCSP *SCSP);
+void SCSP_WriteSlot(struct _SCSP *SCSP, int s, const UINT16 *regs, int count);
 
 #define READ16_HANDLER(name)	data16_t name(offs_t offset, data16_t mem_mask)
 #define WRITE16_HANDLER(name)	void     name(offs_t offset, data16_t data, data16_t mem_mask)
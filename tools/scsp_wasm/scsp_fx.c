@@ -0,0 +1,188 @@
+/*
+ * scsp_fx.c — Standalone SCSP DSP effect processor (see scsp_fx.h).
+ *
+ * Levels and pans use the same fixed-point gains SCSP_Init builds into
+ * LPANTABLE/RPANTABLE, and the same shifts SCSP_DoMasterSample applies,
+ * so a program sounds the same here as it does inside the chip.
+ */
+
+#include <math.h>
+
+#include "scsp.h"
+#include "scsp_fx.h"
+
+#define FX_SHIFT     12
+#define FX_FIX(v)    ((UINT32)((float)(1 << FX_SHIFT) * (v)))
+#define FX_RAM_WORDS 0x10000    /* 64K-word ring, also covers TABLE reads */
+
+struct scsp_fx {
+    struct _SCSPDSP dsp;
+    scsp_fx_config_t cfg;
+    INT32 in_gain;
+    INT32 dry_gain;
+    INT32 ef_l[16], ef_r[16];
+    UINT16 ram[FX_RAM_WORDS];
+};
+
+static const float fx_sdl_db[8] = { -1000000.0, -36.0, -30.0, -24.0, -18.0, -12.0, -6.0, 0.0 };
+
+/* One LPANTABLE/RPANTABLE entry at TL 0, computed the way SCSP_Init does */
+static INT32 fx_gain(int sdl, int pan, int right)
+{
+    float SegaDB = 0;
+    float fSDL, PAN, LPAN, RPAN;
+    float TL = 1.0;
+
+    if (pan & 0x1) SegaDB -= 3;
+    if (pan & 0x2) SegaDB -= 6;
+    if (pan & 0x4) SegaDB -= 12;
+    if (pan & 0x8) SegaDB -= 24;
+
+    if ((pan & 0xf) == 0xf) PAN = 0.0;
+    else PAN = pow(10.0, SegaDB / 20.0);
+
+    if (pan < 0x10) { LPAN = PAN; RPAN = 1.0; }
+    else            { RPAN = PAN; LPAN = 1.0; }
+
+    if (sdl) fSDL = pow(10.0, (fx_sdl_db[sdl]) / 20.0);
+    else     fSDL = 0.0;
+
+    return (INT32)FX_FIX((4.0 * (right ? RPAN : LPAN) * TL * fSDL));
+}
+
+void scsp_fx_default_config(scsp_fx_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->in_mixs[0] = 0;
+    cfg->in_mixs[1] = 1;
+    cfg->in_level = 7;
+    cfg->efsdl[0] = 7;
+    cfg->efpan[0] = 0x1F;
+    cfg->efsdl[1] = 7;
+    cfg->efpan[1] = 0x0F;
+}
+
+void scsp_fx_set_config(scsp_fx_t *fx, const scsp_fx_config_t *cfg)
+{
+    int i, sends;
+
+    fx->cfg = *cfg;
+    fx->in_gain = fx_gain(cfg->in_level & 7, 0, 0);
+    fx->dry_gain = fx_gain(cfg->dry_level & 7, 0, 0);
+    sends = cfg->in_level && (cfg->in_mixs[0] >= 0 || cfg->in_mixs[1] >= 0 || cfg->use_exts);
+    for (i = 0; i < 16; i++) {
+        fx->ef_l[i] = fx_gain(cfg->efsdl[i] & 7, cfg->efpan[i] & 0x1F, 0);
+        fx->ef_r[i] = fx_gain(cfg->efsdl[i] & 7, cfg->efpan[i] & 0x1F, 1);
+        /* slot 0 stands in for the input send */
+        SCSPDSP_SetRouting(&fx->dsp, i, i == 0 ? sends : 0, cfg->efsdl[i] & 7);
+    }
+}
+
+scsp_fx_t *scsp_fx_create(const scsp_fx_config_t *cfg)
+{
+    scsp_fx_config_t def;
+    scsp_fx_t *fx = (scsp_fx_t *)calloc(1, sizeof(scsp_fx_t));
+    if (!fx) return NULL;
+
+    fx->dsp.SCSPRAM = fx->ram;
+    fx->dsp.SCSPRAM_LENGTH = FX_RAM_WORDS;
+    fx->dsp.RBL = 0x2000;
+    fx->dsp.Stopped = 1;
+    if (!cfg) {
+        scsp_fx_default_config(&def);
+        cfg = &def;
+    }
+    scsp_fx_set_config(fx, cfg);
+    return fx;
+}
+
+void scsp_fx_destroy(scsp_fx_t *fx)
+{
+    if (!fx) return;
+    SCSPDSP_JitFree(&fx->dsp);
+    free(fx);
+}
+
+void scsp_fx_reset(scsp_fx_t *fx)
+{
+    memset(fx->dsp.TEMP, 0, sizeof(fx->dsp.TEMP));
+    memset(fx->dsp.MEMS, 0, sizeof(fx->dsp.MEMS));
+    memset(fx->dsp.MIXS, 0, sizeof(fx->dsp.MIXS));
+    memset(fx->dsp.EFREG, 0, sizeof(fx->dsp.EFREG));
+    memset(fx->dsp.EXTS, 0, sizeof(fx->dsp.EXTS));
+    memset(fx->ram, 0, sizeof(fx->ram));
+    fx->dsp.DEC = 0;
+    fx->dsp.Bypassed = 0;
+}
+
+int scsp_fx_load_exb(scsp_fx_t *fx, const uint8_t *exb, int size)
+{
+    int i;
+
+    if (size < 0x540) return -1;
+
+    fx->dsp.RBP = 0;
+    fx->dsp.RBL = 0x2000 << (exb[0x20] & 0x03);
+    for (i = 0; i < 64; i++)
+        fx->dsp.COEF[i] = (INT16)((exb[0x40 + i * 2] << 8) | exb[0x40 + i * 2 + 1]);
+    for (i = 0; i < 32; i++)
+        fx->dsp.MADRS[i] = (UINT16)((exb[0xC0 + i * 2] << 8) | exb[0xC0 + i * 2 + 1]);
+    for (i = 0; i < 512; i++)
+        fx->dsp.MPRO[i] = (UINT16)((exb[0x140 + i * 2] << 8) | exb[0x140 + i * 2 + 1]);
+
+    scsp_fx_reset(fx);
+    SCSPDSP_Start(&fx->dsp);
+    SCSPDSP_Compile(&fx->dsp);
+    fx->dsp.Stopped = (fx->dsp.LastStep == 0) ? 1 : 0;
+    return 0;
+}
+
+void scsp_fx_ramp_coef(scsp_fx_t *fx, int index, int16_t target, uint32_t num_samples, int shape)
+{
+    if (index < 0 || index > 63) return;
+    SCSPDSP_RampCoef(&fx->dsp, index, target, num_samples, shape ? DSPRAMP_EXP : DSPRAMP_LINEAR);
+}
+
+void scsp_fx_ramp_madrs(scsp_fx_t *fx, int index, uint16_t target, uint32_t num_samples, int shape)
+{
+    if (index < 0 || index > 31) return;
+    SCSPDSP_RampMadrs(&fx->dsp, index, target, num_samples, shape ? DSPRAMP_EXP : DSPRAMP_LINEAR);
+}
+
+void scsp_fx_process(scsp_fx_t *fx, const int16_t *in, int16_t *out, int frames)
+{
+    struct _SCSPDSP *dsp = &fx->dsp;
+    const scsp_fx_config_t *cfg = &fx->cfg;
+    int n, i;
+
+    for (n = 0; n < frames; n++) {
+        INT32 l = in ? in[n * 2] : 0;
+        INT32 r = in ? in[n * 2 + 1] : 0;
+        INT32 smpl, smpr;
+
+        if (cfg->in_level) {
+            if (cfg->in_mixs[0] >= 0)
+                dsp->MIXS[cfg->in_mixs[0] & 15] += (l * fx->in_gain) >> (FX_SHIFT - 2);
+            if (cfg->in_mixs[1] >= 0)
+                dsp->MIXS[cfg->in_mixs[1] & 15] += (r * fx->in_gain) >> (FX_SHIFT - 2);
+        }
+        if (cfg->use_exts) {
+            dsp->EXTS[0] = (INT16)l;
+            dsp->EXTS[1] = (INT16)r;
+        }
+
+        SCSPDSP_Step(dsp);
+
+        smpl = (l * fx->dry_gain) >> FX_SHIFT;
+        smpr = (r * fx->dry_gain) >> FX_SHIFT;
+        for (i = 0; i < 16; i++) {
+            if (!cfg->efsdl[i]) continue;
+            smpl += (dsp->EFREG[i] * fx->ef_l[i]) >> FX_SHIFT;
+            smpr += (dsp->EFREG[i] * fx->ef_r[i]) >> FX_SHIFT;
+        }
+        smpl >>= 2;
+        smpr >>= 2;
+        out[n * 2]     = (int16_t)(smpl < -32768 ? -32768 : smpl > 32767 ? 32767 : smpl);
+        out[n * 2 + 1] = (int16_t)(smpr < -32768 ? -32768 : smpr > 32767 ? 32767 : smpr);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * scsp_fx.h — Standalone SCSP DSP effect processor.
+ *
+ * Runs an EXB program on PCM input without the rest of the chip: input
+ * is fed to MIXS (and optionally EXTS) the way a slot's IMXL send would,
+ * and the output is the EFREG mix the way EFSDL/EFPAN would mix it.
+ * Each processor owns its DSP context and 128 KB of delay memory, so
+ * several can run on different threads at once.
+ */
+
+#ifndef SCSP_FX_H
+#define SCSP_FX_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct scsp_fx scsp_fx_t;
+
+typedef struct {
+    int8_t  in_mixs[2];     /* MIXS channel fed by input L/R, -1 = none */
+    uint8_t in_level;       /* IMXL 0-7 for the input send */
+    uint8_t use_exts;       /* also present input L/R on EXTS0/EXTS1 */
+    uint8_t efsdl[16];      /* EFREG output level 0-7 */
+    uint8_t efpan[16];      /* EFREG pan 0-31 (0x0F = right, 0x1F = left) */
+    uint8_t dry_level;      /* DISDL 0-7 for the dry input, 0 = wet only */
+} scsp_fx_config_t;
+
+/* Defaults: input on MIXS 0/1 at IMXL 7, EFREG0 left and EFREG1 right at
+   EFSDL 7, no dry signal. */
+void scsp_fx_default_config(scsp_fx_config_t *cfg);
+
+/* cfg may be NULL for the defaults.  Returns NULL on allocation failure. */
+scsp_fx_t *scsp_fx_create(const scsp_fx_config_t *cfg);
+void scsp_fx_destroy(scsp_fx_t *fx);
+
+void scsp_fx_set_config(scsp_fx_t *fx, const scsp_fx_config_t *cfg);
+
+/* Load an EXB image (see scsp_dsp_load_exb for the layout).  Clears the
+   delay memory.  Returns 0 on success, -1 if the image is too short. */
+int scsp_fx_load_exb(scsp_fx_t *fx, const uint8_t *exb, int size);
+
+/* Clear delay memory and DSP working state, keep the program. */
+void scsp_fx_reset(scsp_fx_t *fx);
+
+/* Glide COEF[index] / MADRS[index] to target over num_samples processed
+   samples (shape 0 = linear, 1 = exponential); 0 samples sets it now. */
+void scsp_fx_ramp_coef(scsp_fx_t *fx, int index, int16_t target, uint32_t num_samples, int shape);
+void scsp_fx_ramp_madrs(scsp_fx_t *fx, int index, uint16_t target, uint32_t num_samples, int shape);
+
+/* Process frames of interleaved stereo 16-bit PCM at 44.1 kHz.  in may be
+   NULL to render the tail with silent input; in and out may alias. */
+void scsp_fx_process(scsp_fx_t *fx, const int16_t *in, int16_t *out, int frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCSP_FX_H */
@@ -0,0 +1,321 @@
+/*
+ * scsp_fx_cli.c — Run SCSP DSP (EXB) effect programs over WAV files.
+ *
+ * Every combination of program and input file is one job; jobs run in
+ * parallel on a pool of worker threads, one scsp_fx_t per job.
+ *
+ * Usage:
+ *   scsp_fx [options] -p effect.exb [-p more.exb ...] in.wav [more.wav ...]
+ *
+ * Options:
+ *   -p FILE     EXB program (repeatable)
+ *   -o DIR      output directory (default: current directory)
+ *   -j N        worker threads (default: number of CPUs)
+ *   -t SEC      tail rendered after the input ends (default: 2)
+ *   -l N        input send level, IMXL 0-7 (default: 7)
+ *   -d N        dry level, DISDL 0-7 (default: 0, wet only)
+ *   -x          also feed the input to EXTS0/EXTS1
+ *
+ * Output files are named <input>.<program>.wav, 16-bit stereo at the input
+ * sample rate (the DSP always runs one step per sample, as at 44.1 kHz).
+ *
+ * Build:  make scsp_fx   (in tools/scsp_wasm)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "scsp_fx.h"
+
+#define BLOCK_FRAMES 1024
+
+typedef struct {
+    char     path[1024];
+    int16_t *pcm;           /* interleaved stereo */
+    int      frames;
+    int      rate;
+} wav_t;
+
+typedef struct {
+    char     path[1024];
+    uint8_t *data;
+    int      size;
+} exb_t;
+
+static wav_t *g_inputs;
+static int    g_num_inputs;
+static exb_t *g_progs;
+static int    g_num_progs;
+static const char *g_outdir = ".";
+static double g_tail = 2.0;
+static scsp_fx_config_t g_cfg;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_next_job;
+static int g_failures;
+
+/* ── File helpers ─────────────────────────────────────────────── */
+
+static uint8_t *read_file(const char *path, int *size)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long len;
+
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = (uint8_t *)malloc(len > 0 ? len : 1);
+    if (!buf || fread(buf, 1, len, f) != (size_t)len) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = (int)len;
+    return buf;
+}
+
+static uint32_t rd32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+/* 16-bit PCM, mono or stereo.  Mono is duplicated to both channels. */
+static int load_wav(wav_t *w, const char *path)
+{
+    int size, pos = 12, channels = 0, bits = 0, i;
+    const uint8_t *data = NULL;
+    uint32_t data_len = 0;
+    uint8_t *buf = read_file(path, &size);
+
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    if (!buf) {
+        fprintf(stderr, "%s: can't read\n", path);
+        return -1;
+    }
+    if (size < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        free(buf);
+        return -1;
+    }
+    while (pos + 8 <= size) {
+        uint32_t len = rd32(buf + pos + 4);
+        if (len > (uint32_t)(size - pos - 8)) len = size - pos - 8;
+        if (!memcmp(buf + pos, "fmt ", 4) && len >= 16) {
+            if (rd16(buf + pos + 8) != 1) break;    /* not PCM */
+            channels = rd16(buf + pos + 10);
+            w->rate = (int)rd32(buf + pos + 12);
+            bits = rd16(buf + pos + 22);
+        } else if (!memcmp(buf + pos, "data", 4)) {
+            data = buf + pos + 8;
+            data_len = len;
+        }
+        pos += 8 + len + (len & 1);
+    }
+    if (!data || bits != 16 || channels < 1 || channels > 2) {
+        fprintf(stderr, "%s: only 16-bit PCM mono/stereo is supported\n", path);
+        free(buf);
+        return -1;
+    }
+
+    w->frames = (int)(data_len / (2 * channels));
+    w->pcm = (int16_t *)malloc((size_t)w->frames * 4 + 4);
+    for (i = 0; i < w->frames; i++) {
+        int16_t l = (int16_t)rd16(data + i * 2 * channels);
+        int16_t r = channels == 2 ? (int16_t)rd16(data + i * 4 + 2) : l;
+        w->pcm[i * 2] = l;
+        w->pcm[i * 2 + 1] = r;
+    }
+    if (w->rate != 44100)
+        fprintf(stderr, "%s: %d Hz input, the DSP assumes 44100 Hz (delay times will scale)\n",
+                path, w->rate);
+    free(buf);
+    return 0;
+}
+
+static void put32(FILE *f, uint32_t v) { fputc(v & 0xFF, f); fputc((v >> 8) & 0xFF, f); fputc((v >> 16) & 0xFF, f); fputc(v >> 24, f); }
+static void put16(FILE *f, uint16_t v) { fputc(v & 0xFF, f); fputc(v >> 8, f); }
+
+static int save_wav(const char *path, const int16_t *pcm, int frames, int rate)
+{
+    FILE *f = fopen(path, "wb");
+    uint32_t bytes = (uint32_t)frames * 4;
+    int i;
+
+    if (!f) return -1;
+    fwrite("RIFF", 1, 4, f); put32(f, 36 + bytes); fwrite("WAVE", 1, 4, f);
+    fwrite("fmt ", 1, 4, f); put32(f, 16); put16(f, 1); put16(f, 2);
+    put32(f, rate); put32(f, rate * 4); put16(f, 4); put16(f, 16);
+    fwrite("data", 1, 4, f); put32(f, bytes);
+    for (i = 0; i < frames * 2; i++) put16(f, (uint16_t)pcm[i]);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/* File name without directory and extension */
+static void base_name(char *dst, size_t n, const char *path)
+{
+    const char *s = strrchr(path, '/');
+    const char *bs = strrchr(path, '\\');
+    char *dot;
+
+    if (bs && (!s || bs > s)) s = bs;
+    snprintf(dst, n, "%s", s ? s + 1 : path);
+    dot = strrchr(dst, '.');
+    if (dot && dot != dst) *dot = 0;
+}
+
+/*
+ * base_name of entry index out of count, with "-index" appended when
+ * another entry has the same one (same file name from different
+ * directories, or the same file twice), so parallel jobs never share an
+ * output path.
+ */
+static void unique_name(char *dst, size_t n, int index, int count, const char *(*path_of)(int))
+{
+    int i;
+
+    base_name(dst, n, path_of(index));
+    for (i = 0; i < count; i++) {
+        char other[256];
+        if (i == index) continue;
+        base_name(other, sizeof(other), path_of(i));
+        if (!strcmp(other, dst)) {
+            snprintf(dst + strlen(dst), n - strlen(dst), "-%d", index);
+            break;
+        }
+    }
+}
+
+static const char *input_path(int i) { return g_inputs[i].path; }
+static const char *prog_path(int i) { return g_progs[i].path; }
+
+/* ── Jobs ─────────────────────────────────────────────────────── */
+
+static int run_job(int job)
+{
+    const wav_t *in = &g_inputs[job % g_num_inputs];
+    const exb_t *prog = &g_progs[job / g_num_inputs];
+    int tail = (int)(g_tail * in->rate);
+    int total = in->frames + tail, done, n;
+    char in_name[256], prog_name[256], out_path[1024 + 512];
+    int16_t *out;
+    scsp_fx_t *fx;
+
+    out = (int16_t *)malloc((size_t)total * 4 + 4);
+    fx = scsp_fx_create(&g_cfg);
+    if (!out || !fx || scsp_fx_load_exb(fx, prog->data, prog->size) != 0) {
+        fprintf(stderr, "%s: not a valid EXB program\n", prog->path);
+        free(out);
+        scsp_fx_destroy(fx);
+        return -1;
+    }
+
+    for (done = 0; done < total; done += n) {
+        n = total - done < BLOCK_FRAMES ? total - done : BLOCK_FRAMES;
+        if (done + n <= in->frames) {
+            scsp_fx_process(fx, in->pcm + done * 2, out + done * 2, n);
+        } else if (done < in->frames) {
+            n = in->frames - done;
+            scsp_fx_process(fx, in->pcm + done * 2, out + done * 2, n);
+        } else {
+            scsp_fx_process(fx, NULL, out + done * 2, n);
+        }
+    }
+    scsp_fx_destroy(fx);
+
+    unique_name(in_name, sizeof(in_name), job % g_num_inputs, g_num_inputs, input_path);
+    unique_name(prog_name, sizeof(prog_name), job / g_num_inputs, g_num_progs, prog_path);
+    snprintf(out_path, sizeof(out_path), "%s/%s.%s.wav", g_outdir, in_name, prog_name);
+    if (save_wav(out_path, out, total, in->rate) != 0) {
+        fprintf(stderr, "%s: can't write\n", out_path);
+        free(out);
+        return -1;
+    }
+    free(out);
+    printf("%s\n", out_path);
+    return 0;
+}
+
+static void *worker(void *arg)
+{
+    int total = g_num_inputs * g_num_progs;
+    (void)arg;
+
+    for (;;) {
+        int job, rc;
+        pthread_mutex_lock(&g_lock);
+        job = g_next_job++;
+        pthread_mutex_unlock(&g_lock);
+        if (job >= total) break;
+
+        rc = run_job(job);
+        pthread_mutex_lock(&g_lock);
+        if (rc != 0) g_failures++;
+        pthread_mutex_unlock(&g_lock);
+    }
+    return NULL;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: scsp_fx [-o dir] [-j threads] [-t tail_sec] [-l imxl] [-d disdl] [-x]\n"
+        "               -p effect.exb [-p ...] in.wav [...]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t *tids;
+    int c, i, jobs;
+
+    scsp_fx_default_config(&g_cfg);
+    g_progs = (exb_t *)calloc(argc, sizeof(exb_t));
+    g_inputs = (wav_t *)calloc(argc, sizeof(wav_t));
+
+    while ((c = getopt(argc, argv, "p:o:j:t:l:d:xh")) != -1) {
+        switch (c) {
+        case 'p': {
+            exb_t *p = &g_progs[g_num_progs];
+            snprintf(p->path, sizeof(p->path), "%s", optarg);
+            p->data = read_file(optarg, &p->size);
+            if (!p->data) {
+                fprintf(stderr, "%s: can't read\n", optarg);
+                return 1;
+            }
+            g_num_progs++;
+            break;
+        }
+        case 'o': g_outdir = optarg; break;
+        case 'j': threads = atoi(optarg); break;
+        case 't': g_tail = atof(optarg); break;
+        case 'l': g_cfg.in_level = (uint8_t)(atoi(optarg) & 7); break;
+        case 'd': g_cfg.dry_level = (uint8_t)(atoi(optarg) & 7); break;
+        case 'x': g_cfg.use_exts = 1; break;
+        default:  usage(); return 1;
+        }
+    }
+    for (i = optind; i < argc; i++) {
+        if (load_wav(&g_inputs[g_num_inputs], argv[i]) != 0) return 1;
+        g_num_inputs++;
+    }
+    if (!g_num_progs || !g_num_inputs) {
+        usage();
+        return 1;
+    }
+    if (g_tail < 0) g_tail = 0;
+
+    jobs = g_num_progs * g_num_inputs;
+    if (threads < 1) threads = 1;
+    if (threads > jobs) threads = jobs;
+
+    tids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    for (i = 0; i < threads; i++) pthread_create(&tids[i], NULL, worker, NULL);
+    for (i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+    free(tids);
+
+    return g_failures ? 1 : 0;
+}
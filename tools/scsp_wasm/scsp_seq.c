@@ -0,0 +1,384 @@
+/*
+ * scsp_seq.c — Native SEQ player.
+ *
+ * Decodes the event stream the same way as parseSEQ (tools/seq_io.js)
+ * and allocates slots the way the engine's voice allocator does: each
+ * note takes a run of consecutive slots, one per layer, stealing the
+ * oldest notes when no run is free.
+ */
+
+#include "scsp_seq.h"
+#include <string.h>
+
+extern void scsp_key_on(int slot);
+extern void scsp_key_off(int slot);
+extern void scsp_write_ton_layer(int slot, const scsp_ton_layer_t *layer, int note);
+
+#define DEFAULT_MSPB   500000   /* 120 BPM when the song has no tempo track */
+#define MAX_STEP       0x10000  /* ticks per clock step, keeps the math in 64 bits */
+#define NEVER          0xFFFFFFFFu
+
+/* ── Helpers ──────────────────────────────────────────────────── */
+
+static uint16_t be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/*
+ * Decode the next event into seq->next.  Returns 0 at the end marker or
+ * on a truncated or unknown event.
+ */
+static int decode(scsp_seq_t *seq)
+{
+    const uint8_t *d = seq->data;
+    uint32_t delta = 0, gate = 0;
+    scsp_seq_event_t *ev = &seq->next;
+
+    for (;;) {
+        uint8_t b, type;
+
+        if (seq->pos >= seq->size) return 0;
+        b = d[seq->pos++];
+        switch (b) {
+        case 0x83: return 0;
+        case 0x8F: delta += 0x1000; continue;
+        case 0x8E: delta += 0x0800; continue;
+        case 0x8D: delta += 0x0200; continue;
+        case 0x8C: delta += 0x0100; continue;
+        case 0x8B: gate  += 0x2000; continue;
+        case 0x8A: gate  += 0x1000; continue;
+        case 0x89: gate  += 0x0800; continue;
+        case 0x88: gate  += 0x0200; continue;
+        default: break;
+        }
+
+        type = b & 0xF0;
+        if (b < 0x80) {
+            if (seq->pos + 4 > seq->size) return 0;
+            ev->status = 0x90 | (b & 0x0F);
+            ev->d1     = d[seq->pos];
+            ev->d2     = d[seq->pos + 1];
+            gate      += d[seq->pos + 2] + ((b & 0x40) ? 256 : 0);
+            delta     += d[seq->pos + 3] + ((b & 0x20) ? 256 : 0);
+            seq->pos  += 4;
+        } else if (type == 0xB0 || type == 0xA0) {
+            if (seq->pos + 3 > seq->size) return 0;
+            ev->status = b;
+            ev->d1     = d[seq->pos];
+            ev->d2     = d[seq->pos + 1];
+            delta     += d[seq->pos + 2];
+            seq->pos  += 3;
+        } else if (type == 0xC0 || type == 0xD0 || type == 0xE0) {
+            if (seq->pos + 2 > seq->size) return 0;
+            ev->status = b;
+            ev->d1     = d[seq->pos];
+            ev->d2     = 0;
+            delta     += d[seq->pos + 1];
+            seq->pos  += 2;
+        } else {
+            return 0;
+        }
+
+        seq->stream_tick += delta;
+        ev->tick = seq->stream_tick;
+        ev->gate = gate;
+        return 1;
+    }
+}
+
+static void set_tempo(scsp_seq_t *seq, int index)
+{
+    seq->tempo_index = index;
+    seq->tempo_end = index < seq->num_tempo ? seq->tick + seq->tempo[index].step : NEVER;
+}
+
+/* Move to the next tempo event, wrapping to tempo_loop past the last. */
+static void next_tempo(scsp_seq_t *seq)
+{
+    int i = seq->tempo_index + 1;
+
+    if (i >= seq->num_tempo) {
+        if (seq->tempo_loop < 0) { seq->tempo_end = NEVER; return; }
+        i = seq->tempo_loop;
+    }
+    set_tempo(seq, i);
+}
+
+static uint32_t mspb(const scsp_seq_t *seq)
+{
+    if (seq->tempo_index < seq->num_tempo && seq->tempo[seq->tempo_index].mspb)
+        return seq->tempo[seq->tempo_index].mspb;
+    return DEFAULT_MSPB;
+}
+
+/* ── Voices ───────────────────────────────────────────────────── */
+
+static void voice_off(scsp_seq_t *seq, scsp_seq_voice_t *v)
+{
+    for (int s = 0; s < 32; s++)
+        if (v->keyed & (1u << s)) scsp_key_off(s);
+    seq->slots_used &= ~v->slots;
+    v->active = 0;
+}
+
+static scsp_seq_voice_t *oldest_voice(scsp_seq_t *seq)
+{
+    scsp_seq_voice_t *best = NULL;
+    for (int i = 0; i < SCSP_SEQ_MAX_VOICES; i++) {
+        scsp_seq_voice_t *v = &seq->voices[i];
+        if (v->active && (!best || v->age < best->age)) best = v;
+    }
+    return best;
+}
+
+/* First free run of n slots, stealing the oldest notes until one opens. */
+static int alloc_slots(scsp_seq_t *seq, int n)
+{
+    uint32_t run = n >= 32 ? 0xFFFFFFFFu : (1u << n) - 1;
+
+    for (;;) {
+        scsp_seq_voice_t *victim;
+        for (int s = 0; s + n <= 32; s++)
+            if (!(seq->slots_used & (run << s))) return s;
+        victim = oldest_voice(seq);
+        if (!victim) return -1;
+        voice_off(seq, victim);
+    }
+}
+
+static void note_on(scsp_seq_t *seq, int ch, int note, uint32_t gate)
+{
+    const scsp_ton_voice_t *tv;
+    scsp_seq_voice_t *v = NULL;
+    int i, n, first;
+
+    if (!seq->bank || seq->program[ch] >= seq->bank->num_voices) return;
+    tv = &seq->bank->voices[seq->program[ch]];
+    n = tv->num_layers > 32 ? 32 : tv->num_layers;
+
+    /* Retrigger: the sound driver cuts the previous note of the same key */
+    for (i = 0; i < SCSP_SEQ_MAX_VOICES; i++) {
+        scsp_seq_voice_t *o = &seq->voices[i];
+        if (o->active && o->ch == ch && o->note == note) voice_off(seq, o);
+    }
+
+    first = alloc_slots(seq, n);
+    if (first < 0) return;
+    for (i = 0; i < SCSP_SEQ_MAX_VOICES && !v; i++)
+        if (!seq->voices[i].active) v = &seq->voices[i];
+    if (!v) return;
+
+    v->active   = 1;
+    v->ch       = (uint8_t)ch;
+    v->note     = (uint8_t)note;
+    v->slots    = (n >= 32 ? 0xFFFFFFFFu : (1u << n) - 1) << first;
+    v->keyed    = 0;
+    v->off_tick = seq->tick + gate;
+    v->age      = seq->age++;
+    seq->slots_used |= v->slots;
+
+    for (i = 0; i < n; i++) {
+        const scsp_ton_layer_t *l = &seq->bank->layers[tv->first_layer + i];
+        if (note < l->start_note || note > l->end_note) continue;
+        scsp_write_ton_layer(first + i, l, note);
+        v->keyed |= 1u << (first + i);
+    }
+    for (i = 0; i < n; i++)
+        if (v->keyed & (1u << (first + i))) scsp_key_on(first + i);
+}
+
+static void release_all(scsp_seq_t *seq, int ch)
+{
+    for (int i = 0; i < SCSP_SEQ_MAX_VOICES; i++) {
+        scsp_seq_voice_t *v = &seq->voices[i];
+        if (v->active && (ch < 0 || v->ch == ch)) voice_off(seq, v);
+    }
+}
+
+/* ── Scheduling ───────────────────────────────────────────────── */
+
+static void restart_stream(scsp_seq_t *seq)
+{
+    seq->pos = seq->events_start;
+    seq->stream_tick = seq->pass_tick = seq->tick;
+    set_tempo(seq, 0);
+    seq->have_next = decode(seq);
+}
+
+/* Fire everything due at seq->tick. */
+static void dispatch(scsp_seq_t *seq)
+{
+    int i;
+
+    /* Zero-step tempo events take effect and end on the same tick; a loop
+     * made only of them would spin, so give up after one lap */
+    for (i = 0; seq->tick >= seq->tempo_end; i++) {
+        if (i > seq->num_tempo) { seq->tempo_end = NEVER; break; }
+        next_tempo(seq);
+    }
+
+    /* Gate expiries first, so a note ending where the next begins is cut
+     * before the new one is keyed (mid2seq sorts note-offs first too). */
+    for (i = 0; i < SCSP_SEQ_MAX_VOICES; i++) {
+        scsp_seq_voice_t *v = &seq->voices[i];
+        if (v->active && seq->tick >= v->off_tick) voice_off(seq, v);
+    }
+
+    for (;;) {
+        const scsp_seq_event_t *ev = &seq->next;
+
+        if (!seq->have_next) {
+            /* End marker: loop once the pass has lasted the song's length,
+             * unless it was empty */
+            if (!seq->loop || seq->tick == seq->pass_tick) return;
+            if (seq->tick < seq->pass_tick + seq->length) return;
+            restart_stream(seq);
+            continue;
+        }
+        if (seq->tick < ev->tick) return;
+
+        switch (ev->status & 0xF0) {
+        case 0x90:
+            note_on(seq, ev->status & 0x0F, ev->d1, ev->gate);
+            break;
+        case 0xC0:
+            seq->program[ev->status & 0x0F] = ev->d1 & 0x7F;
+            break;
+        case 0xB0:
+            if (ev->d1 == 120 || ev->d1 == 123) release_all(seq, ev->status & 0x0F);
+            break;
+        default:
+            break;
+        }
+        seq->have_next = decode(seq);
+    }
+}
+
+/*
+ * Pick the next tick anything happens at and convert the distance to
+ * samples at the current tempo.  The remainder carries over in frac, so
+ * the tick clock never drifts from the sample clock.
+ */
+static void schedule(scsp_seq_t *seq)
+{
+    uint32_t target = seq->tempo_end;
+    uint64_t num, den;
+    int i, busy = seq->have_next;
+
+    if (seq->have_next && seq->next.tick < target) target = seq->next.tick;
+    if (!seq->have_next && seq->loop && seq->tick < seq->pass_tick + seq->length) {
+        busy = 1;
+        if (seq->pass_tick + seq->length < target) target = seq->pass_tick + seq->length;
+    }
+    for (i = 0; i < SCSP_SEQ_MAX_VOICES; i++) {
+        const scsp_seq_voice_t *v = &seq->voices[i];
+        if (!v->active) continue;
+        busy = 1;
+        if (v->off_tick < target) target = v->off_tick;
+    }
+
+    /* Past the end marker with every gate expired: the song is over (a
+     * looping song only gets here if a pass is empty) */
+    if (!busy) {
+        seq->playing = 0;
+        return;
+    }
+    if (target - seq->tick > MAX_STEP) target = seq->tick + MAX_STEP;
+
+    num = seq->frac + (uint64_t)(target - seq->tick) * mspb(seq) * SCSP_SEQ_RATE;
+    den = (uint64_t)1000000 * seq->resolution;
+    seq->samples_left = (uint32_t)(num / den);
+    seq->frac = num % den;
+    seq->target_tick = target;
+}
+
+/* ── API ──────────────────────────────────────────────────────── */
+
+int scsp_seq_open(scsp_seq_t *seq, const uint8_t *data, uint32_t size, int song)
+{
+    uint32_t song_off, tempo_loop;
+    int num_songs, i;
+
+    memset(seq, 0, sizeof(*seq));
+    if (size < 6) return SCSP_SEQ_ERR_SHORT;
+    num_songs = be16(data);
+    if (song < 0 || song >= num_songs) return SCSP_SEQ_ERR_HEADER;
+    if (2 + (uint32_t)song * 4 + 4 > size) return SCSP_SEQ_ERR_SHORT;
+    song_off = be32(data + 2 + song * 4);
+    if (song_off > size || size - song_off < 8) return SCSP_SEQ_ERR_SHORT;
+
+    seq->resolution = be16(data + song_off);
+    seq->num_tempo  = be16(data + song_off + 2);
+    seq->events_start = song_off + be16(data + song_off + 4);
+    tempo_loop = be16(data + song_off + 6);
+    if (!seq->resolution || seq->num_tempo > SCSP_SEQ_MAX_TEMPO) return SCSP_SEQ_ERR_HEADER;
+    if (song_off + 8 + (uint32_t)seq->num_tempo * 8 > size) return SCSP_SEQ_ERR_SHORT;
+    if (seq->events_start < song_off + 8 + (uint32_t)seq->num_tempo * 8 || seq->events_start > size)
+        return SCSP_SEQ_ERR_HEADER;
+
+    for (i = 0; i < seq->num_tempo; i++) {
+        seq->tempo[i].step = be32(data + song_off + 8 + i * 8);
+        seq->tempo[i].mspb = be32(data + song_off + 12 + i * 8);
+        seq->length += seq->tempo[i].step;
+    }
+    /* The loop offset counts from the song header like data_offset does */
+    seq->tempo_loop = -1;
+    if (tempo_loop >= 8 && (tempo_loop - 8) % 8 == 0 && (int)(tempo_loop - 8) / 8 < seq->num_tempo)
+        seq->tempo_loop = (int)(tempo_loop - 8) / 8;
+
+    seq->data = data;
+    seq->size = size;
+    return num_songs;
+}
+
+void scsp_seq_start(scsp_seq_t *seq, const scsp_ton_bank_t *bank, int loop)
+{
+    if (seq->playing) scsp_seq_stop(seq);
+    if (!seq->data) return;
+
+    seq->bank = bank;
+    seq->loop = loop;
+    seq->tick = 0;
+    seq->frac = 0;
+    seq->age = 0;
+    seq->slots_used = 0;
+    memset(seq->program, 0, sizeof(seq->program));
+    memset(seq->voices, 0, sizeof(seq->voices));
+    restart_stream(seq);
+
+    seq->playing = 1;
+    seq->samples_left = 0;
+    seq->target_tick = 0;
+}
+
+void scsp_seq_stop(scsp_seq_t *seq)
+{
+    release_all(seq, -1);
+    seq->playing = 0;
+}
+
+int scsp_seq_advance(scsp_seq_t *seq, int max_samples)
+{
+    int n;
+
+    if (!seq->playing) return max_samples;
+
+    /* Several steps can land on the same sample (zero-length gates,
+     * sub-sample deltas): fire them all before rendering anything. */
+    while (seq->samples_left == 0) {
+        seq->tick = seq->target_tick;
+        dispatch(seq);
+        schedule(seq);
+        if (!seq->playing) return max_samples;
+    }
+
+    n = seq->samples_left < (uint32_t)max_samples ? (int)seq->samples_left : max_samples;
+    seq->samples_left -= n;
+    return n;
+}
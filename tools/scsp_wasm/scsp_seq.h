@@ -0,0 +1,124 @@
+/*
+ * scsp_seq.h — Native player for Saturn SEQ (sequence) files.
+ *
+ * Plays the bank/tempo/event layout written by tools/mid2seq.c and
+ * seq_io.js buildSEQ against a TON bank loaded with scsp_ton_load.  The
+ * player runs inside the render loop: scsp_seq_advance fires every event
+ * due at the current sample and says how many samples to render before
+ * the next one, so key-ons, key-offs and gate expiries land on exact
+ * sample positions whatever the block size.
+ *
+ * File layout (all big-endian, see SEQUENCES.md):
+ *   bank:   u16 num_songs, u32 song offset[num_songs]
+ *   song:   u16 resolution, u16 num_tempo, u16 data_offset, u16 tempo_loop
+ *           then num_tempo × { u32 step ticks, u32 µs per beat }
+ *   events: note-on  ctl note vel gate delta, ctl < 0x80: bits 3-0 channel,
+ *                    bit 5 delta += 256, bit 6 gate += 256
+ *           other    status data… delta (one data byte for Cx/Dx/Ex)
+ *           0x88-0x8B gate extend, 0x8C-0x8F delta extend, 0x83 end
+ *   A delta is the time since the previous event.
+ */
+
+#ifndef SCSP_SEQ_H
+#define SCSP_SEQ_H
+
+#include <stdint.h>
+#include "scsp_ton.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCSP_SEQ_RATE          44100
+#define SCSP_SEQ_MAX_TEMPO     256
+#define SCSP_SEQ_MAX_VOICES    32    /* one per slot at most */
+
+/* Error codes returned by scsp_seq_open */
+#define SCSP_SEQ_ERR_SHORT    -1  /* truncated bank or song header */
+#define SCSP_SEQ_ERR_HEADER   -2  /* song index or offsets out of range */
+
+typedef struct {
+    uint32_t step;          /* ticks this tempo lasts */
+    uint32_t mspb;          /* microseconds per beat */
+} scsp_seq_tempo_t;
+
+/* A decoded event from the stream */
+typedef struct {
+    uint32_t tick;
+    uint32_t gate;          /* note-on only, in ticks */
+    uint8_t  status;        /* 0x90 | ch for note-on, else the raw status */
+    uint8_t  d1, d2;
+} scsp_seq_event_t;
+
+typedef struct {
+    uint8_t  active;
+    uint8_t  ch, note;
+    uint32_t slots;         /* slots reserved, one per layer of the TON voice */
+    uint32_t keyed;         /* the subset keyed on (layers covering the note) */
+    uint32_t off_tick;      /* gate expiry */
+    uint32_t age;
+} scsp_seq_voice_t;
+
+typedef struct {
+    /* Song, set by scsp_seq_open */
+    const uint8_t   *data;
+    uint32_t         size;
+    uint32_t         events_start;
+    uint16_t         resolution;
+    int              num_tempo;
+    int              tempo_loop;    /* index to wrap to, -1 = hold the last */
+    uint32_t         length;        /* sum of tempo steps: the song's length */
+    scsp_seq_tempo_t tempo[SCSP_SEQ_MAX_TEMPO];
+
+    /* Playback */
+    const scsp_ton_bank_t *bank;
+    int              playing;
+    int              loop;
+    uint32_t         pos;           /* read position in data */
+    int              have_next;     /* next holds an undispatched event */
+    scsp_seq_event_t next;
+    uint32_t         stream_tick;   /* tick of the last decoded event */
+    uint32_t         pass_tick;     /* tick the current pass started at */
+    uint32_t         tick;          /* current tick */
+    uint32_t         target_tick;   /* tick reached when samples_left hits 0 */
+    uint32_t         samples_left;
+    uint64_t         frac;          /* sub-sample remainder of the tick clock */
+    int              tempo_index;
+    uint32_t         tempo_end;     /* tick at which tempo_index runs out */
+    uint8_t          program[16];
+    uint32_t         slots_used;    /* bitmap of slots held by voices */
+    uint32_t         age;
+    scsp_seq_voice_t voices[SCSP_SEQ_MAX_VOICES];
+} scsp_seq_t;
+
+/*
+ * Parse the bank header and the headers of song `song`.  data is not
+ * copied and must stay valid while the song plays.  Returns the number
+ * of songs in the bank, or a negative SCSP_SEQ_ERR_* code.
+ */
+int scsp_seq_open(scsp_seq_t *seq, const uint8_t *data, uint32_t size, int song);
+
+/*
+ * Start from the top, playing program changes as voices of bank.  With
+ * loop set, the song restarts at its end marker or at the end of its tempo
+ * track, whichever comes later (so trailing rests are kept); otherwise
+ * playback ends once the last gate has expired.
+ */
+void scsp_seq_start(scsp_seq_t *seq, const scsp_ton_bank_t *bank, int loop);
+
+/* Stop and key off every slot the player holds. */
+void scsp_seq_stop(scsp_seq_t *seq);
+
+/*
+ * Fire everything due at the current sample, then consume up to
+ * max_samples samples.  Returns how many samples the caller should
+ * render before calling again (at least 1 when max_samples > 0);
+ * max_samples when not playing.
+ */
+int scsp_seq_advance(scsp_seq_t *seq, int max_samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCSP_SEQ_H */
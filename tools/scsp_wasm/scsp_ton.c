@@ -0,0 +1,203 @@
+/*
+ * scsp_ton.c — Native TON bank loader.
+ *
+ * Mirrors TonIO.importTon (tools/ton_io.js) and the register setup of
+ * programSlotRaw (tools/scsp_engine.js), minus the PCM decode: samples go
+ * straight from the file into sound RAM.
+ */
+
+#include "scsp_ton.h"
+#include <string.h>
+
+/* FNS for 0-11 semitones above the octave: round(1024 * (2^(k/12) - 1)) */
+static const uint16_t FNS_SEMITONE[12] = {
+    0, 61, 125, 194, 266, 343, 424, 510, 601, 698, 801, 909
+};
+
+/* ── Helpers ──────────────────────────────────────────────────── */
+
+static uint16_t be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/*
+ * Sound RAM holds 16-bit words in host order (scsp.c reads them through
+ * LE16, a no-op), so big-endian file bytes land at index ^ 1 on
+ * little-endian hosts.  dst and src must start on the same word parity.
+ */
+static void copy_be_words(uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    memcpy(dst, src, n);
+#else
+    uint32_t i;
+    for (i = 0; i + 1 < n; i += 2) {
+        dst[i]     = src[i + 1];
+        dst[i + 1] = src[i];
+    }
+    if (i < n) dst[i + 1] = src[i];
+#endif
+}
+
+static void parse_layer(scsp_ton_layer_t *l, const uint8_t *p, int index,
+                        uint32_t ram_base)
+{
+    uint16_t w0 = be16(p + 0x02);
+    uint32_t sa = ((uint32_t)(w0 & 0xF) << 16) | be16(p + 0x04);
+    uint16_t d7 = be16(p + 0x10);
+    int mdl = (d7 >> 12) & 0xF;
+
+    l->start_note = p[0x00];
+    l->end_note   = p[0x01];
+    l->flags      = p[0x02] & (SCSP_TON_PEON | SCSP_TON_PLON | SCSP_TON_FMCB);
+    l->base_note  = p[0x19];
+    l->fine_tune  = (int8_t)p[0x1A];
+    l->fm_layer   = (p[0x1B] & 0x80) ? (int8_t)(p[0x1B] & 0x7F) : -1;
+    l->vl_id      = p[0x1D];
+    l->peg_id     = p[0x1E];
+    l->plfo_id    = p[0x1F];
+
+    sa += ram_base;
+    l->sa = sa;
+
+    /* Layers of a voice take consecutive slots, so the modulator's ring
+     * buffer entry is (fm_layer - index) slots away regardless of where
+     * the voice lands.  Without a link, MDL means self-feedback. */
+    if (mdl > 0 && l->fm_layer >= 0) {
+        int dist = (l->fm_layer - index) & 63;
+        d7 = (uint16_t)((mdl << 12) | (dist << 6) | dist);
+    } else if (mdl > 0) {
+        d7 = (uint16_t)((mdl << 12) | (32 << 6) | 32);
+    }
+
+    l->regs[0x0] = (uint16_t)((w0 & 0x07F0) | ((sa >> 16) & 0xF));
+    l->regs[0x1] = (uint16_t)(sa & 0xFFFF);
+    l->regs[0x2] = be16(p + 0x06);              /* LSA */
+    l->regs[0x3] = be16(p + 0x08);              /* LEA */
+    l->regs[0x4] = be16(p + 0x0A);              /* D2R | D1R | EGHOLD | AR */
+    l->regs[0x5] = be16(p + 0x0C);              /* LPSLNK | KRS | DL | RR */
+    l->regs[0x6] = be16(p + 0x0E) & 0x03FF;     /* STWINH | SDIR | TL */
+    l->regs[0x7] = d7;                          /* MDL | MDXSL | MDYSL */
+    l->regs[0x8] = be16(p + 0x12);              /* OCT | FNS */
+    l->regs[0x9] = be16(p + 0x14);              /* LFO */
+    l->regs[0xA] = be16(p + 0x16);              /* ISEL | IMXL */
+    l->regs[0xB] = (uint16_t)(p[0x18] << 8);    /* DISDL | DIPAN */
+}
+
+/* ── API ──────────────────────────────────────────────────────── */
+
+int scsp_ton_parse(scsp_ton_bank_t *bank, const uint8_t *ton, uint32_t size,
+                   uint32_t ram_base)
+{
+    uint32_t mixer_off, vl_off, peg_off, plfo_off, first_voice, pcm_start;
+    int nvoices, v, i;
+
+    bank->num_voices = bank->num_layers = 0;
+    bank->num_vl = bank->num_peg = bank->num_plfo = 0;
+    if (size < 10) return SCSP_TON_ERR_SHORT;
+
+    mixer_off = be16(ton + 0);
+    vl_off    = be16(ton + 2);
+    peg_off   = be16(ton + 4);
+    plfo_off  = be16(ton + 6);
+    if (mixer_off < 10 || (mixer_off & 1)) return SCSP_TON_ERR_HEADER;
+    nvoices = (int)(mixer_off - 8) / 2;
+    if (nvoices > SCSP_TON_MAX_VOICES) return SCSP_TON_ERR_HEADER;
+    if (!(mixer_off + SCSP_TON_MIXER_SIZE <= vl_off && vl_off <= peg_off && peg_off <= plfo_off))
+        return SCSP_TON_ERR_HEADER;
+    if (mixer_off > size) return SCSP_TON_ERR_SHORT;
+
+    first_voice = be16(ton + 8);
+    if (first_voice < plfo_off || first_voice > size) return SCSP_TON_ERR_HEADER;
+
+    memcpy(bank->mixer, ton + mixer_off, SCSP_TON_MIXER_SIZE);
+
+    bank->num_vl = (int)((peg_off - vl_off) / SCSP_TON_VL_SIZE);
+    if (bank->num_vl > SCSP_TON_MAX_TABLE) bank->num_vl = SCSP_TON_MAX_TABLE;
+    for (i = 0; i < bank->num_vl; i++) {
+        const uint8_t *p = ton + vl_off + i * SCSP_TON_VL_SIZE;
+        scsp_ton_vl_t *vl = &bank->vl[i];
+        vl->slope[0] = (int8_t)p[0]; vl->point[0] = p[1]; vl->level[0] = p[2];
+        vl->slope[1] = (int8_t)p[3]; vl->point[1] = p[4]; vl->level[1] = p[5];
+        vl->slope[2] = (int8_t)p[6]; vl->point[2] = p[7]; vl->level[2] = p[8];
+        vl->slope[3] = (int8_t)p[9];
+    }
+
+    bank->num_peg = (int)((plfo_off - peg_off) / SCSP_TON_PEG_SIZE);
+    if (bank->num_peg > SCSP_TON_MAX_TABLE) bank->num_peg = SCSP_TON_MAX_TABLE;
+    for (i = 0; i < bank->num_peg; i++)
+        memcpy(bank->peg[i].data, ton + peg_off + i * SCSP_TON_PEG_SIZE, SCSP_TON_PEG_SIZE);
+
+    bank->num_plfo = (int)((first_voice - plfo_off) / SCSP_TON_PLFO_SIZE);
+    if (bank->num_plfo > SCSP_TON_MAX_TABLE) bank->num_plfo = SCSP_TON_MAX_TABLE;
+    for (i = 0; i < bank->num_plfo; i++)
+        memcpy(bank->plfo[i].data, ton + plfo_off + i * SCSP_TON_PLFO_SIZE, SCSP_TON_PLFO_SIZE);
+
+    /* The PCM block starts at the lowest sample address; anything below
+     * it is tables and voices, which the chip never reads. */
+    pcm_start = size;
+    for (v = 0; v < nvoices; v++) {
+        uint32_t voff = be16(ton + 8 + v * 2);
+        scsp_ton_voice_t *voice = &bank->voices[v];
+        int nlayers, li;
+
+        if (voff + SCSP_TON_VOICE_HEADER > size) return SCSP_TON_ERR_SHORT;
+        nlayers = (int8_t)ton[voff + 2] + 1;
+        if (nlayers < 1) nlayers = 1;
+        if (voff + SCSP_TON_VOICE_HEADER + (uint32_t)nlayers * SCSP_TON_LAYER_SIZE > size)
+            return SCSP_TON_ERR_SHORT;
+        if (bank->num_layers + nlayers > SCSP_TON_MAX_LAYERS) return SCSP_TON_ERR_LAYERS;
+
+        voice->play_mode   = (ton[voff] >> 4) & 0x7;
+        voice->bend_range  = ton[voff] & 0xF;
+        voice->portamento  = ton[voff + 1];
+        voice->volume_bias = (int8_t)ton[voff + 3];
+        voice->num_layers  = nlayers;
+        voice->first_layer = bank->num_layers;
+
+        for (li = 0; li < nlayers; li++) {
+            const uint8_t *p = ton + voff + SCSP_TON_VOICE_HEADER + li * SCSP_TON_LAYER_SIZE;
+            uint32_t sa = ((uint32_t)(p[0x03] & 0xF) << 16) | be16(p + 0x04);
+            parse_layer(&bank->layers[bank->num_layers + li], p, li, ram_base);
+            if (sa < pcm_start) pcm_start = sa;
+        }
+        bank->num_layers += nlayers;
+    }
+
+    bank->num_voices = nvoices;
+    bank->ram_base   = ram_base;
+    bank->pcm_start  = pcm_start & ~1u;
+    bank->size       = size;
+    return nvoices;
+}
+
+int scsp_ton_load(scsp_ton_bank_t *bank, uint8_t *ram, uint32_t ram_size,
+                  const uint8_t *ton, uint32_t size, uint32_t ram_base)
+{
+    int ret;
+
+    if ((ram_base & 1) || ram_base > ram_size || size > ram_size - ram_base)
+        return SCSP_TON_ERR_RAM;
+    ret = scsp_ton_parse(bank, ton, size, ram_base);
+    if (ret < 0) return ret;
+
+    copy_be_words(ram + ram_base + bank->pcm_start, ton + bank->pcm_start,
+                  size - bank->pcm_start);
+    return (int)(ram_base + size);
+}
+
+uint16_t scsp_ton_pitch(const scsp_ton_layer_t *layer, int note)
+{
+    int semi = note - layer->base_note;
+    int octave = semi >= 0 ? semi / 12 : -((11 - semi) / 12);
+    int frac, fns;
+
+    if (octave < -8) octave = -8;
+    if (octave > 7)  octave = 7;
+    frac = semi - octave * 12;
+    if (frac < 0)        fns = 0;
+    else if (frac > 11)  fns = 1023;
+    else                 fns = FNS_SEMITONE[frac];
+    return (uint16_t)(((octave & 0xF) << 11) | fns);
+}
@@ -0,0 +1,129 @@
+/*
+ * scsp_ton.h — Native loader for Saturn TON (tone bank) files.
+ *
+ * Parses the TON offset table, the mixer and VL/PEG/PLFO tables, voice
+ * headers and 32-byte layer records, copies the PCM block into sound RAM
+ * in one pass, and turns every layer into a slot register image that only
+ * needs OCT/FNS filled in at note-on.  No emulator dependency: the WASM
+ * wrapper, the VST and host tools all link the same code.
+ *
+ * File layout (all big-endian, see SEQUENCES.md):
+ *   0x00  mixer, VL, PEG, PLFO offsets, then one offset per voice
+ *   voice: bend/play mode, portamento, nlayers - 1 (signed), volume bias,
+ *          then nlayers × 32-byte layers
+ *   layer: 0x00 start note, 0x01 end note, 0x02-0x17 slot words 0x0-0xA,
+ *          0x18 DISDL/DIPAN, 0x19 base note, 0x1A fine tune,
+ *          0x1B FM link (bit 7 = on, bits 6-0 = modulator layer),
+ *          0x1D VL entry, 0x1E PEG entry, 0x1F PLFO entry
+ */
+
+#ifndef SCSP_TON_H
+#define SCSP_TON_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCSP_TON_LAYER_SIZE    0x20
+#define SCSP_TON_VOICE_HEADER  4
+#define SCSP_TON_MIXER_SIZE    0x12
+#define SCSP_TON_VL_SIZE       0x0A
+#define SCSP_TON_PEG_SIZE      0x0A
+#define SCSP_TON_PLFO_SIZE     0x04
+
+#define SCSP_TON_MAX_VOICES    128
+#define SCSP_TON_MAX_LAYERS    1024  /* across all voices */
+#define SCSP_TON_MAX_TABLE     256   /* VL/PEG/PLFO entries (indexed by a byte) */
+#define SCSP_TON_REGS          12    /* slot words 0x0-0xB */
+
+/* Error codes returned by scsp_ton_parse / scsp_ton_load */
+#define SCSP_TON_ERR_SHORT    -1  /* truncated header, voice or layer */
+#define SCSP_TON_ERR_HEADER   -2  /* offset table out of range or out of order */
+#define SCSP_TON_ERR_LAYERS   -3  /* more than SCSP_TON_MAX_LAYERS layers */
+#define SCSP_TON_ERR_RAM      -4  /* bank doesn't fit in sound RAM at ram_base */
+
+/* One layer, ready for a slot. */
+typedef struct {
+    /* Slot register image.  KYONB/KYONEX clear, SA relocated to the
+     * bank's RAM base, MDXSL/MDYSL pointing at the modulator layer's slot
+     * (or at the slot's own output 32 samples back for feedback), OCT/FNS
+     * from the file (scsp_ton_pitch replaces it per note), EFSDL/EFPAN 0. */
+    uint16_t regs[SCSP_TON_REGS];
+    uint32_t sa;            /* relocated sample address (bytes) */
+    uint8_t  start_note;
+    uint8_t  end_note;
+    uint8_t  base_note;
+    int8_t   fine_tune;
+    int8_t   fm_layer;      /* modulator layer within the voice, -1 = none */
+    uint8_t  flags;         /* SCSP_TON_PEON | SCSP_TON_PLON | SCSP_TON_FMCB */
+    uint8_t  vl_id;
+    uint8_t  peg_id;
+    uint8_t  plfo_id;
+} scsp_ton_layer_t;
+
+#define SCSP_TON_PEON  0x80  /* pitch envelope on */
+#define SCSP_TON_PLON  0x40  /* pitch LFO on */
+#define SCSP_TON_FMCB  0x20  /* FM carrier */
+
+typedef struct {
+    uint8_t  play_mode;     /* header byte 0 bits 6-4 */
+    uint8_t  bend_range;    /* header byte 0 bits 3-0 */
+    uint8_t  portamento;
+    int8_t   volume_bias;
+    int      num_layers;
+    int      first_layer;   /* index into scsp_ton_bank_t.layers */
+} scsp_ton_voice_t;
+
+/* Velocity → TL curve: 4 slopes joined at 3 (velocity, level) points */
+typedef struct {
+    int8_t   slope[4];
+    uint8_t  point[3];
+    uint8_t  level[3];
+} scsp_ton_vl_t;
+
+typedef struct { uint8_t data[SCSP_TON_PEG_SIZE]; } scsp_ton_peg_t;
+typedef struct { uint8_t data[SCSP_TON_PLFO_SIZE]; } scsp_ton_plfo_t;
+
+typedef struct {
+    int              num_voices;
+    int              num_layers;
+    int              num_vl, num_peg, num_plfo;
+    uint32_t         ram_base;      /* byte offset the file was placed at */
+    uint32_t         pcm_start;     /* first PCM byte, relative to the file */
+    uint32_t         size;          /* file size in bytes */
+    uint8_t          mixer[SCSP_TON_MIXER_SIZE];
+    scsp_ton_voice_t voices[SCSP_TON_MAX_VOICES];
+    scsp_ton_layer_t layers[SCSP_TON_MAX_LAYERS];
+    scsp_ton_vl_t    vl[SCSP_TON_MAX_TABLE];
+    scsp_ton_peg_t   peg[SCSP_TON_MAX_TABLE];
+    scsp_ton_plfo_t  plfo[SCSP_TON_MAX_TABLE];
+} scsp_ton_bank_t;
+
+/*
+ * Parse a TON file into bank, with sample addresses relocated by
+ * ram_base (the byte offset the file will occupy in sound RAM).
+ * Returns the number of voices, or a negative SCSP_TON_ERR_* code.
+ */
+int scsp_ton_parse(scsp_ton_bank_t *bank, const uint8_t *ton, uint32_t size,
+                   uint32_t ram_base);
+
+/*
+ * Parse, then copy the PCM block into ram (ram_size bytes) at
+ * ram_base + pcm_start, converting the big-endian 16-bit words to the
+ * emulator's host-order layout on the way.  ram_base must be even.
+ * Returns the first free RAM byte after the bank, or a negative
+ * SCSP_TON_ERR_* code (RAM is left untouched on error).
+ */
+int scsp_ton_load(scsp_ton_bank_t *bank, uint8_t *ram, uint32_t ram_size,
+                  const uint8_t *ton, uint32_t size, uint32_t ram_base);
+
+/* OCT/FNS word (slot register 0x8) for a layer played at a MIDI note. */
+uint16_t scsp_ton_pitch(const scsp_ton_layer_t *layer, int note);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCSP_TON_H */
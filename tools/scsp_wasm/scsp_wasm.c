@@ -18,6 +18,8 @@
 /* scsp_types.h is force-included via -include flag in the Makefile.
    It provides all types, stubs, and guard defines. */
 #include "scsp.h"
+#include "scsp_ton.h"
+#include "scsp_seq.h"
 
 /* ── Globals provided by this file ──────────────────────────────── */
 
@@ -39,12 +41,19 @@ static void dummy_irq_cb(int irq) { (void)irq; }
 /* Output buffer for rendering */
 #define MAX_RENDER_SAMPLES 8192
 static int16_t render_buf[MAX_RENDER_SAMPLES * 2]; /* stereo interleaved */
+static float render_f32[MAX_RENDER_SAMPLES * 2];   /* planar L then R */
+static int dsp_no_jit = 0; /* survives scsp_init() */
+static int meter_on = 0;   /* likewise */
+
+/* SEQ player, advanced from inside the render loops */
+static scsp_seq_t song_player;
 
 /* ── Exported WASM API ─────────────────────────────────────────── */
 
 EMSCRIPTEN_KEEPALIVE
 void scsp_init(void) {
-    /* Zero all state */
+    /* Zero all state (release compiled DSP code first, it lives outside SCSP) */
+    SCSPDSP_JitFree(&SCSP.DSP);
     memset(&SCSP, 0, sizeof(struct _SCSP));
     memset(sat_ram, 0, sizeof(sat_ram));
 
@@ -57,6 +66,9 @@ void scsp_init(void) {
     intf.irq_callback[0] = dummy_irq_cb;
 
     scsp_start(&intf);
+    SCSP.DSP.NoJit = dsp_no_jit;
+    SCSP.Meter.Enabled = meter_on;
+    song_player.playing = 0;    /* its slots were just cleared */
 
     /* Write to slot 0 register 0 — this was in the original init code.
      * While not MVOL (as originally commented), it may trigger necessary
@@ -74,6 +86,27 @@ uint32_t scsp_get_ram_size(void) {
     return sizeof(sat_ram);
 }
 
+/*
+ * Move a block of sound RAM (overlap allowed) and repoint every slot whose
+ * SA lies inside it, including the read pointer of slots already playing,
+ * so waveforms can be compacted between render calls without a glitch.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_ram_move(uint32_t dst, uint32_t src, uint32_t bytes) {
+    if (dst == src || src + bytes > sizeof(sat_ram) || dst + bytes > sizeof(sat_ram)) return;
+    memmove(sat_ram + dst, sat_ram + src, bytes);
+
+    for (int i = 0; i < 32; i++) {
+        struct _SLOT *slot = &SCSP.Slots[i];
+        uint32_t sa = ((uint32_t)(slot->udata.data[0] & 0xF) << 16) | slot->udata.data[1];
+        if (sa < src || sa >= src + bytes) continue;
+        sa = sa - src + dst;
+        slot->udata.data[0] = (slot->udata.data[0] & ~0xF) | (sa >> 16);
+        slot->udata.data[1] = sa & 0xFFFF;
+        if (slot->active) slot->base += (int32_t)(dst - src);
+    }
+}
+
 /*
  * Write a 16-bit value to the SCSP register space.
  * addr: byte address in SCSP register map (0x000 - 0xFFF)
@@ -97,6 +130,16 @@ void scsp_write_slot(int slot, int reg_word, uint16_t value) {
     SCSP_0_w(addr / 2, value, 0x0000);
 }
 
+/*
+ * Write slot words 0..count-1 from a precomputed image in one call.
+ * KEYONEX in word 0 is ignored; key the slot with scsp_key_on.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_write_slot_image(int slot, const uint16_t *regs, int count) {
+    if (slot < 0 || slot > 31) return;
+    SCSP_WriteSlot(&SCSP, slot, regs, count);
+}
+
 /*
  * Trigger key-on for a slot.
  * The SCSP requires EG.state == RELEASE before a slot can start.
@@ -127,6 +170,42 @@ void scsp_key_off(int slot) {
     SCSP_0_w(addr / 2, val, 0x0000);
 }
 
+/*
+ * Bitmap of slots whose envelope is still running, keyed or releasing.
+ * Voice allocators treat a slot as free only once its bit clears.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t scsp_slots_playing(void) {
+    uint32_t mask = 0;
+    for (int i = 0; i < 32; i++)
+        if (SCSP.Slots[i].active) mask |= 1u << i;
+    return mask;
+}
+
+/*
+ * Bitmap of playing slots whose SA lies in [offset, offset + bytes), i.e.
+ * that may still read that block of sound RAM.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t scsp_slots_reading(uint32_t offset, uint32_t bytes) {
+    uint32_t mask = 0;
+    for (int i = 0; i < 32; i++) {
+        struct _SLOT *slot = &SCSP.Slots[i];
+        uint32_t sa = ((uint32_t)(slot->udata.data[0] & 0xF) << 16) | slot->udata.data[1];
+        if (slot->active && sa >= offset && sa < offset + bytes) mask |= 1u << i;
+    }
+    return mask;
+}
+
+/*
+ * Current EG level of a slot: 0 (silent or stopped) to 0x3FF (full).
+ */
+EMSCRIPTEN_KEEPALIVE
+int scsp_slot_level(int slot) {
+    if (slot < 0 || slot >= 32 || !SCSP.Slots[slot].active) return 0;
+    return SCSP.Slots[slot].EG.volume >> 16;   /* EG_SHIFT */
+}
+
 /*
  * Render audio samples.
  * Returns pointer to interleaved stereo int16 buffer (L,R,L,R,...).
@@ -135,12 +214,17 @@ void scsp_key_off(int slot) {
 EMSCRIPTEN_KEEPALIVE
 int16_t *scsp_render(int num_samples) {
     if (num_samples > MAX_RENDER_SAMPLES) num_samples = MAX_RENDER_SAMPLES;
-
-    for (int i = 0; i < num_samples; i++) {
-        stereo_sample_t sample;
-        SCSP_Update(NULL, NULL, &sample);
-        render_buf[i * 2]     = sample.l;
-        render_buf[i * 2 + 1] = sample.r;
+    if (meter_on) SCSP_MeterReset(&SCSP);
+
+    for (int i = 0; i < num_samples; ) {
+        /* Render up to the next song event, which lands on this sample */
+        int end = i + scsp_seq_advance(&song_player, num_samples - i);
+        for (; i < end; i++) {
+            stereo_sample_t sample;
+            SCSP_Update(NULL, NULL, &sample);
+            render_buf[i * 2]     = sample.l;
+            render_buf[i * 2 + 1] = sample.r;
+        }
     }
     return render_buf;
 }
@@ -153,6 +237,55 @@ int16_t *scsp_get_render_buf(void) {
     return render_buf;
 }
 
+/* ── Worker render path ──────────────────────────────────────────── */
+
+/*
+ * Render into a planar float buffer: num_samples left samples, then
+ * num_samples right samples, scaled to -1..1.  The render worker copies
+ * the two halves straight into the shared audio ring (scsp_ring.js),
+ * without converting per sample in JS.
+ */
+EMSCRIPTEN_KEEPALIVE
+float *scsp_render_f32(int num_samples) {
+    if (num_samples > MAX_RENDER_SAMPLES) num_samples = MAX_RENDER_SAMPLES;
+    if (meter_on) SCSP_MeterReset(&SCSP);
+
+    for (int i = 0; i < num_samples; ) {
+        int end = i + scsp_seq_advance(&song_player, num_samples - i);
+        for (; i < end; i++) {
+            stereo_sample_t sample;
+            SCSP_Update(NULL, NULL, &sample);
+            render_f32[i]               = sample.l * (1.0f / 32768.0f);
+            render_f32[num_samples + i] = sample.r * (1.0f / 32768.0f);
+        }
+    }
+    return render_f32;
+}
+
+/* ── Level meters ────────────────────────────────────────────────── */
+
+/*
+ * Turn metering on or off.  While on, every render call starts a fresh
+ * struct _SCSP_METER (see scsp.h) that accumulates peak and sum of
+ * squares per slot, per EFREG and for the master output as it renders,
+ * so after the call it describes exactly that block.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_meter_enable(int enable) {
+    meter_on = enable ? 1 : 0;
+    SCSP.Meter.Enabled = meter_on;
+    SCSP_MeterReset(&SCSP);
+}
+
+/*
+ * Address of the meter struct, for JS to map once and read after each
+ * render without further calls.
+ */
+EMSCRIPTEN_KEEPALIVE
+struct _SCSP_METER *scsp_meter_get(void) {
+    return &SCSP.Meter;
+}
+
 /* ── DSP program API ─────────────────────────────────────────────── */
 
 /*
@@ -177,65 +310,52 @@ static void dsp_setup_ringbuf(int rbl) {
     memset(sat_ram + rb_byte_offset, 0, rb_words * 2);
 }
 
-/*
- * Load a DSP program from EXB binary format (1344 bytes).
- *
- * EXB layout:
- *   0x000-0x01F:  name (ignored here)
- *   0x020:        RBL  (ring buffer length: 0=8Kw, 1=16Kw, 2=32Kw, 3=64Kw)
- *   0x040-0x0BF:  COEF (64 × 16-bit big-endian)
- *   0x0C0-0x13F:  MADRS (64 × 16-bit big-endian, first 32 used by DSP)
- *   0x140-0x53F:  MPRO (128 × 64-bit big-endian instructions, stored as 4×16-bit)
- *
- * Ring buffer is placed at the top of sound RAM, below the 512KB ceiling.
- */
-EMSCRIPTEN_KEEPALIVE
-void scsp_dsp_load_exb(const uint8_t *exb, int size) {
-    if (size < 0x540) return;  /* minimum valid EXB size */
-
-    /* ── RBL and ring buffer allocation (also clears the region) ── */
-    dsp_setup_ringbuf(exb[0x20] & 0x03);
+void scsp_dsp_load_arrays(const uint16_t *mpro, int mpro_len,
+                          const int16_t *coef, int coef_len,
+                          const uint16_t *madrs, int madrs_len,
+                          int rbl);
 
+/* Unpack the COEF, MADRS and MPRO tables of an EXB image (layout below) */
+static void dsp_parse_exb(const uint8_t *exb, uint16_t *mpro, int16_t *coef, uint16_t *madrs) {
     /* ── COEF (64 entries, 16-bit signed big-endian) ────────────── */
     for (int i = 0; i < 64; i++) {
         int off = 0x40 + i * 2;
-        SCSP.DSP.COEF[i] = (int16_t)((exb[off] << 8) | exb[off + 1]);
+        coef[i] = (int16_t)((exb[off] << 8) | exb[off + 1]);
     }
 
     /* ── MADRS (32 entries used by DSP, 16-bit unsigned big-endian) */
     for (int i = 0; i < 32; i++) {
         int off = 0xC0 + i * 2;
-        SCSP.DSP.MADRS[i] = (uint16_t)((exb[off] << 8) | exb[off + 1]);
+        madrs[i] = (uint16_t)((exb[off] << 8) | exb[off + 1]);
     }
 
     /* ── MPRO (128 instructions × 4 words, big-endian) ──────────── */
-    for (int i = 0; i < 128; i++) {
-        int off = 0x140 + i * 8;
-        for (int w = 0; w < 4; w++) {
-            int woff = off + w * 2;
-            SCSP.DSP.MPRO[i * 4 + w] = (uint16_t)((exb[woff] << 8) | exb[woff + 1]);
-        }
+    for (int i = 0; i < 512; i++) {
+        int off = 0x140 + i * 2;
+        mpro[i] = (uint16_t)((exb[off] << 8) | exb[off + 1]);
     }
+}
 
-    /* ── Clear DSP working state ─────────────────────────────────── */
-    memset(SCSP.DSP.TEMP, 0, sizeof(SCSP.DSP.TEMP));
-    memset(SCSP.DSP.MEMS, 0, sizeof(SCSP.DSP.MEMS));
-    memset(SCSP.DSP.MIXS, 0, sizeof(SCSP.DSP.MIXS));
-    memset(SCSP.DSP.EFREG, 0, sizeof(SCSP.DSP.EFREG));
-    SCSP.DSP.DEC = 0;
-
-    /* ── Find last active MPRO step ──────────────────────────────── */
-    SCSP.DSP.LastStep = 0;
-    for (int i = 127; i >= 0; i--) {
-        if (SCSP.DSP.MPRO[i * 4] || SCSP.DSP.MPRO[i * 4 + 1] ||
-            SCSP.DSP.MPRO[i * 4 + 2] || SCSP.DSP.MPRO[i * 4 + 3]) {
-            SCSP.DSP.LastStep = i + 1;
-            break;
-        }
-    }
+/*
+ * Load a DSP program from EXB binary format (1344 bytes).
+ *
+ * EXB layout:
+ *   0x000-0x01F:  name (ignored here)
+ *   0x020:        RBL  (ring buffer length: 0=8Kw, 1=16Kw, 2=32Kw, 3=64Kw)
+ *   0x040-0x0BF:  COEF (64 × 16-bit big-endian)
+ *   0x0C0-0x13F:  MADRS (64 × 16-bit big-endian, first 32 used by DSP)
+ *   0x140-0x53F:  MPRO (128 × 64-bit big-endian instructions, stored as 4×16-bit)
+ *
+ * Ring buffer is placed at the top of sound RAM, below the 512KB ceiling.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_dsp_load_exb(const uint8_t *exb, int size) {
+    uint16_t mpro[512], madrs[32];
+    int16_t coef[64];
 
-    /* ── Start DSP ───────────────────────────────────────────────── */
-    SCSP.DSP.Stopped = (SCSP.DSP.LastStep == 0) ? 1 : 0;
+    if (size < 0x540) return;  /* minimum valid EXB size */
+    dsp_parse_exb(exb, mpro, coef, madrs);
+    scsp_dsp_load_arrays(mpro, 512, coef, 64, madrs, 32, exb[0x20] & 0x03);
 }
 
 /*
@@ -277,18 +397,113 @@ void scsp_dsp_load_arrays(const uint16_t *mpro, int mpro_len,
     memset(SCSP.DSP.EFREG, 0, sizeof(SCSP.DSP.EFREG));
     SCSP.DSP.DEC = 0;
 
-    /* Find last active step */
-    SCSP.DSP.LastStep = 0;
-    for (int i = 127; i >= 0; i--) {
-        if (SCSP.DSP.MPRO[i * 4] || SCSP.DSP.MPRO[i * 4 + 1] ||
-            SCSP.DSP.MPRO[i * 4 + 2] || SCSP.DSP.MPRO[i * 4 + 3]) {
-            SCSP.DSP.LastStep = i + 1;
-            break;
-        }
-    }
+    /* Find last active step and decode the program */
+    SCSPDSP_Start(&SCSP.DSP);
+    SCSPDSP_Compile(&SCSP.DSP);
     SCSP.DSP.Stopped = (SCSP.DSP.LastStep == 0) ? 1 : 0;
 }
 
+/*
+ * Hot-swap a DSP program (for live coding).  Same arguments as
+ * scsp_dsp_load_arrays, plus ramp_samples: if MPRO is unchanged, COEF and
+ * MADRS glide to the new values over that many samples.
+ *
+ * When the ring buffer already has the requested size, TEMP, MEMS, DEC and
+ * the ring buffer are kept, so echoes and reverb tails continue through the
+ * edit.  The whole program changes between two output samples (renders
+ * never see a half-written program).  If RBL changed, this falls back to a
+ * full load.
+ *
+ * Returns the number of changed MPRO steps, or -1 after a full load.
+ */
+EMSCRIPTEN_KEEPALIVE
+int scsp_dsp_reload_arrays(const uint16_t *mpro, int mpro_len,
+                           const int16_t *coef, int coef_len,
+                           const uint16_t *madrs, int madrs_len,
+                           int rbl, uint32_t ramp_samples) {
+    static const uint32_t rbl_words[] = { 0x2000, 0x4000, 0x8000, 0x10000 };
+    uint16_t new_mpro[512] = { 0 }, new_madrs[32] = { 0 };
+    int16_t new_coef[64] = { 0 };
+
+    if (rbl < 0) rbl = 0;
+    if (rbl > 3) rbl = 3;
+    if (SCSP.DSP.RBL != rbl_words[rbl] ||
+        SCSP.DSP.RBP != ((512 * 1024 / 2) - rbl_words[rbl]) >> 12) {
+        scsp_dsp_load_arrays(mpro, mpro_len, coef, coef_len, madrs, madrs_len, rbl);
+        return -1;
+    }
+
+    memcpy(new_mpro, mpro, (mpro_len < 512 ? mpro_len : 512) * sizeof(uint16_t));
+    memcpy(new_coef, coef, (coef_len < 64 ? coef_len : 64) * sizeof(int16_t));
+    memcpy(new_madrs, madrs, (madrs_len < 32 ? madrs_len : 32) * sizeof(uint16_t));
+    int changed = SCSPDSP_Reload(&SCSP.DSP, new_mpro, new_coef, new_madrs, ramp_samples);
+    if (SCSP.DSP.JitStale) SCSPDSP_Compile(&SCSP.DSP);
+    return changed;
+}
+
+/*
+ * Hot-swap an EXB program, see scsp_dsp_reload_arrays.
+ * Returns -2 if the image is too short.
+ */
+EMSCRIPTEN_KEEPALIVE
+int scsp_dsp_reload_exb(const uint8_t *exb, int size, uint32_t ramp_samples) {
+    uint16_t mpro[512], madrs[32];
+    int16_t coef[64];
+
+    if (size < 0x540) return -2;
+    dsp_parse_exb(exb, mpro, coef, madrs);
+    return scsp_dsp_reload_arrays(mpro, 512, coef, 64, madrs, 32,
+                                  exb[0x20] & 0x03, ramp_samples);
+}
+
+/*
+ * Statically analyze a DSP program (see SCSPDSP_Analyze).
+ * mpro/madrs as for scsp_dsp_load_arrays; pass mpro = NULL to analyze the
+ * program currently loaded.  Fills out[DSP_INFO_WORDS]:
+ *   [0] steps          [1] active steps    [2] memory reads  [3] memory writes
+ *   [4] ring words     [5] table words     [6] minimum RBL (0-3)
+ *   [7..10] TEMP offsets read (128-bit mask)
+ *   [11..14] TEMP offsets written
+ *   [15] MEMS read mask  [16] MEMS write mask
+ *   [17] TEMP live flag  [18] MEMS live mask
+ */
+#define DSP_INFO_WORDS 19
+
+EMSCRIPTEN_KEEPALIVE
+void scsp_dsp_analyze(const uint16_t *mpro, int mpro_len,
+                      const uint16_t *madrs, int madrs_len,
+                      uint32_t *out) {
+    static struct _SCSPDSP scratch;
+    const struct _SCSPDSP *dsp = &SCSP.DSP;
+    struct _SCSPDSP_INFO info;
+
+    if (mpro) {
+        int nw = mpro_len < 512 ? mpro_len : 512;
+        int nm = madrs_len < 32 ? madrs_len : 32;
+        memset(&scratch, 0, sizeof(scratch));
+        memcpy(scratch.MPRO, mpro, nw * sizeof(uint16_t));
+        if (madrs) memcpy(scratch.MADRS, madrs, nm * sizeof(uint16_t));
+        dsp = &scratch;
+    }
+    SCSPDSP_Analyze(dsp, &info);
+
+    out[0] = info.Steps;
+    out[1] = info.ActiveSteps;
+    out[2] = info.MemReads;
+    out[3] = info.MemWrites;
+    out[4] = info.RingWords;
+    out[5] = info.TableWords;
+    out[6] = info.MinRBL;
+    for (int i = 0; i < 4; i++) {
+        out[7 + i] = info.TempRead[i];
+        out[11 + i] = info.TempWrite[i];
+    }
+    out[15] = info.MemsRead;
+    out[16] = info.MemsWrite;
+    out[17] = info.TempLive;
+    out[18] = info.MemsLive;
+}
+
 /*
  * Stop/start DSP execution.
  */
@@ -302,6 +517,35 @@ void scsp_dsp_start(void) {
     SCSP.DSP.Stopped = (SCSP.DSP.LastStep == 0) ? 1 : 0;
 }
 
+/* Nonzero while the DSP has a program and is running it */
+EMSCRIPTEN_KEEPALIVE
+int scsp_dsp_running(void) {
+    return !SCSP.DSP.Stopped;
+}
+
+/*
+ * Enable/disable native compilation of DSP programs.  Only has an effect
+ * on x86-64 native builds (SCSPDSP_JIT); elsewhere the interpreter is
+ * always used.  Takes effect immediately by recompiling the current program.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_dsp_set_jit(int enable) {
+    dsp_no_jit = enable ? 0 : 1;
+    SCSP.DSP.NoJit = dsp_no_jit;
+    SCSPDSP_Compile(&SCSP.DSP);
+}
+
+/*
+ * Build native code for a program the sound driver loaded through the
+ * DSP registers.  Register writes happen while rendering, so those
+ * programs are interpreted until this runs; call it from a non-audio
+ * thread (x86-64 native builds only, a no-op elsewhere).
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_dsp_compile(void) {
+    if (SCSP.DSP.JitStale) SCSPDSP_Compile(&SCSP.DSP);
+}
+
 /*
  * Clear DSP working state (TEMP, MEMS, ring buffer) without reloading
  * the program.  Useful when switching songs or stopping playback to
@@ -335,8 +579,10 @@ EMSCRIPTEN_KEEPALIVE
 void scsp_slot_set_effect_send(int slot, int isel, int imxl) {
     if (slot < 0 || slot > 31) return;
     uint16_t val = ((isel & 0xF) << 3) | (imxl & 0x7);
-    SCSP.Slots[slot].udata.data[0xA] =
-        (SCSP.Slots[slot].udata.data[0xA] & 0xFF80) | val;
+    struct _SLOT *s = SCSP.Slots + slot;
+    s->udata.data[0xA] = (s->udata.data[0xA] & 0xFF80) | val;
+    /* bypasses SCSP_0_w, so keep the DSP's routing masks current here */
+    SCSPDSP_SetRouting(&SCSP.DSP, slot, IMXL(s), EFSDL(s));
 }
 
 /*
@@ -350,8 +596,9 @@ EMSCRIPTEN_KEEPALIVE
 void scsp_slot_set_effect_output(int slot, int efsdl, int efpan) {
     if (slot < 0 || slot > 15) return;
     uint16_t val = ((efsdl & 0x7) << 5) | (efpan & 0x1F);
-    SCSP.Slots[slot].udata.data[0xB] =
-        (SCSP.Slots[slot].udata.data[0xB] & 0xFF00) | val;
+    struct _SLOT *s = SCSP.Slots + slot;
+    s->udata.data[0xB] = (s->udata.data[0xB] & 0xFF00) | val;
+    SCSPDSP_SetRouting(&SCSP.DSP, slot, IMXL(s), EFSDL(s));
 }
 
 /*
@@ -377,7 +624,7 @@ int16_t scsp_dsp_get_efreg(int index) {
 EMSCRIPTEN_KEEPALIVE
 void scsp_dsp_set_coef(int index, int16_t value) {
     if (index < 0 || index > 63) return;
-    SCSP.DSP.COEF[index] = value;
+    SCSPDSP_RampCoef(&SCSP.DSP, index, value, 0, DSPRAMP_LINEAR);
 }
 
 /*
@@ -392,12 +639,33 @@ int16_t scsp_dsp_get_coef(int index) {
 /*
  * Set a single MADRS entry (delay line tap offset in words).
  * Changing MADRS at runtime adjusts delay times.  May cause clicks if
- * the tap jumps discontinuously — for smooth changes, interpolate in JS.
+ * the tap jumps discontinuously — for smooth changes use
+ * scsp_dsp_ramp_madrs().
  */
 EMSCRIPTEN_KEEPALIVE
 void scsp_dsp_set_madrs(int index, uint16_t value) {
     if (index < 0 || index > 31) return;
-    SCSP.DSP.MADRS[index] = value;
+    SCSPDSP_RampMadrs(&SCSP.DSP, index, value, 0, DSPRAMP_LINEAR);
+}
+
+/*
+ * Glide a COEF or MADRS entry to target over num_samples output samples.
+ * The DSP advances the ramp once per sample inside scsp_render(), so one
+ * call per gesture is enough.
+ *   shape: 0 = linear, 1 = exponential (fast start, settles on target)
+ * A new ramp on the same entry starts from its current value; the set
+ * functions above cancel any ramp in progress.  num_samples 0 = set now.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_dsp_ramp_coef(int index, int16_t target, uint32_t num_samples, int shape) {
+    if (index < 0 || index > 63) return;
+    SCSPDSP_RampCoef(&SCSP.DSP, index, target, num_samples, shape ? DSPRAMP_EXP : DSPRAMP_LINEAR);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void scsp_dsp_ramp_madrs(int index, uint16_t target, uint32_t num_samples, int shape) {
+    if (index < 0 || index > 31) return;
+    SCSPDSP_RampMadrs(&SCSP.DSP, index, target, num_samples, shape ? DSPRAMP_EXP : DSPRAMP_LINEAR);
 }
 
 /*
@@ -428,3 +696,160 @@ void scsp_slot_set_direct_output(int slot, int disdl, int dipan) {
     SCSP.Slots[slot].udata.data[0xB] =
         (SCSP.Slots[slot].udata.data[0xB] & 0x00FF) | upper;
 }
+
+/* ── TON banks ─────────────────────────────────────────────────── */
+
+static scsp_ton_bank_t ton_bank;
+
+/*
+ * Program a slot from a parsed TON layer at a MIDI note: the layer's
+ * register image with OCT/FNS for the note.  Like the sound driver, it
+ * keeps EFSDL/EFPAN (lower byte of 0xB) and leaves the slot keyed off.
+ */
+void scsp_write_ton_layer(int slot, const scsp_ton_layer_t *layer, int note) {
+    uint16_t regs[SCSP_TON_REGS];
+
+    if (slot < 0 || slot > 31) return;
+    memcpy(regs, layer->regs, sizeof(regs));
+    regs[0x8] = scsp_ton_pitch(layer, note);
+    regs[0xB] = (SCSP.Slots[slot].udata.data[0xB] & 0x00FF) | (layer->regs[0xB] & 0xFF00);
+    scsp_write_slot_image(slot, regs, SCSP_TON_REGS);
+}
+
+/*
+ * Load a whole TON file in one call: parse it and copy its PCM into
+ * sound RAM at ram_base (even).  Replaces the previously loaded bank.
+ * Returns the first free RAM byte after the bank, or a negative
+ * SCSP_TON_ERR_* code.
+ */
+EMSCRIPTEN_KEEPALIVE
+int scsp_bank_load(const uint8_t *ton, uint32_t size, uint32_t ram_base) {
+    return scsp_ton_load(&ton_bank, sat_ram, sizeof(sat_ram), ton, size, ram_base);
+}
+
+/*
+ * Program a slot from layer `layer` of voice `voice` of the loaded bank.
+ * The layers of a voice must go to consecutive slots, in order, for FM
+ * links to reach their modulators.  Returns 0, or -1 if out of range.
+ */
+EMSCRIPTEN_KEEPALIVE
+int scsp_bank_program(int slot, int voice, int layer, int note) {
+    if (voice < 0 || voice >= ton_bank.num_voices) return -1;
+    if (layer < 0 || layer >= ton_bank.voices[voice].num_layers) return -1;
+    scsp_write_ton_layer(slot, &ton_bank.layers[ton_bank.voices[voice].first_layer + layer], note);
+    return 0;
+}
+
+/* ── Song playback ─────────────────────────────────────────────── */
+
+static uint8_t *song_data;
+
+/*
+ * Load song `index` of a SEQ bank (as written by mid2seq / buildSEQ).
+ * The bytes are copied, so the caller may free them.  Stops the current
+ * song.  Returns the number of songs in the bank, or a negative
+ * SCSP_SEQ_ERR_* code.
+ */
+EMSCRIPTEN_KEEPALIVE
+int scsp_song_load(const uint8_t *seq, uint32_t size, int index) {
+    int ret;
+
+    scsp_seq_stop(&song_player);
+    free(song_data);
+    song_data = (uint8_t *)malloc(size ? size : 1);
+    if (!song_data) return SCSP_SEQ_ERR_SHORT;
+    memcpy(song_data, seq, size);
+    ret = scsp_seq_open(&song_player, song_data, size, index);
+    if (ret < 0) {
+        free(song_data);
+        song_data = NULL;
+    }
+    return ret;
+}
+
+/*
+ * Play the loaded song from the top with voices from the loaded TON bank
+ * (program n = voice n).  Events fire inside scsp_render/scsp_render_f32
+ * at their exact sample, so the caller just renders blocks.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_song_play(int loop) {
+    scsp_seq_start(&song_player, &ton_bank, loop);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void scsp_song_stop(void) {
+    scsp_seq_stop(&song_player);
+}
+
+/* Tick of the last song event fired, or -1 when stopped. */
+EMSCRIPTEN_KEEPALIVE
+int scsp_song_tick(void) {
+    return song_player.playing ? (int)song_player.tick : -1;
+}
+
+/* ── Command queue ─────────────────────────────────────────────── */
+
+/*
+ * Command records for scsp_exec: four words { op, a, b, c }.  The main
+ * thread queues them through a lock-free SharedArrayBuffer queue and the
+ * render worker executes each batch between two render blocks, so a
+ * command never lands in the middle of a sample.
+ */
+#define SCSP_CMD_WRITE_REG       1  /* a = byte address, b = value */
+#define SCSP_CMD_WRITE_SLOT      2  /* a = slot, b = register word, c = value */
+#define SCSP_CMD_KEY_ON          3  /* a = slot */
+#define SCSP_CMD_KEY_OFF         4  /* a = slot */
+#define SCSP_CMD_EFFECT_SEND     5  /* a = slot, b = isel, c = imxl */
+#define SCSP_CMD_EFFECT_OUTPUT   6  /* a = slot, b = efsdl, c = efpan */
+#define SCSP_CMD_DIRECT_OUTPUT   7  /* a = slot, b = disdl, c = dipan */
+#define SCSP_CMD_DSP_RAMP_COEF   8  /* a = index | shape << 8, b = value, c = samples */
+#define SCSP_CMD_DSP_RAMP_MADRS  9  /* a = index | shape << 8, b = value, c = samples */
+#define SCSP_CMD_DSP_START      10
+#define SCSP_CMD_DSP_STOP       11
+#define SCSP_CMD_DSP_CLEAR      12
+#define SCSP_CMD_BANK_PROGRAM   13  /* a = slot, b = voice << 8 | layer, c = note */
+#define SCSP_CMD_SONG_PLAY      14  /* a = loop */
+#define SCSP_CMD_SONG_STOP      15
+#define SCSP_CMD_METER_ENABLE   16  /* a = enable */
+
+#define SCSP_CMD_MAX 256
+static uint32_t cmd_buf[SCSP_CMD_MAX * 4];
+
+/*
+ * Get the static command buffer (SCSP_CMD_MAX records) for scsp_exec.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t *scsp_get_cmd_buf(void) {
+    return cmd_buf;
+}
+
+/*
+ * Execute count command records.  Unknown opcodes are skipped.
+ */
+EMSCRIPTEN_KEEPALIVE
+void scsp_exec(const uint32_t *cmds, int count) {
+    for (int i = 0; i < count; i++, cmds += 4) {
+        uint32_t a = cmds[1], b = cmds[2], c = cmds[3];
+
+        switch (cmds[0]) {
+        case SCSP_CMD_WRITE_REG:      scsp_write_reg(a, (uint16_t)b); break;
+        case SCSP_CMD_WRITE_SLOT:     scsp_write_slot((int)a, (int)b, (uint16_t)c); break;
+        case SCSP_CMD_KEY_ON:         scsp_key_on((int)a); break;
+        case SCSP_CMD_KEY_OFF:        scsp_key_off((int)a); break;
+        case SCSP_CMD_EFFECT_SEND:    scsp_slot_set_effect_send((int)a, (int)b, (int)c); break;
+        case SCSP_CMD_EFFECT_OUTPUT:  scsp_slot_set_effect_output((int)a, (int)b, (int)c); break;
+        case SCSP_CMD_DIRECT_OUTPUT:  scsp_slot_set_direct_output((int)a, (int)b, (int)c); break;
+        case SCSP_CMD_DSP_RAMP_COEF:  scsp_dsp_ramp_coef(a & 0xFF, (int16_t)b, c, (a >> 8) & 1); break;
+        case SCSP_CMD_DSP_RAMP_MADRS: scsp_dsp_ramp_madrs(a & 0xFF, (uint16_t)b, c, (a >> 8) & 1); break;
+        case SCSP_CMD_DSP_START:      scsp_dsp_start(); break;
+        case SCSP_CMD_DSP_STOP:       scsp_dsp_stop(); break;
+        case SCSP_CMD_DSP_CLEAR:      scsp_dsp_clear(); break;
+        case SCSP_CMD_BANK_PROGRAM:   scsp_bank_program((int)a, (int)(b >> 8), (int)(b & 0xFF), (int)c); break;
+        case SCSP_CMD_SONG_PLAY:      scsp_song_play((int)a); break;
+        case SCSP_CMD_SONG_STOP:      scsp_song_stop(); break;
+        case SCSP_CMD_METER_ENABLE:   scsp_meter_enable((int)a); break;
+        default: break;
+        }
+    }
+}
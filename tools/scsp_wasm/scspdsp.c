@@ -8,21 +8,37 @@
 
 #include "scsp.h"
 
+#ifdef SCSPDSP_JIT
+#include "scspdsp_jit.c"
+#endif
+
+//count leading zeros of a nonzero 32 bit value
+INLINE int CLZ32(UINT32 v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_clz(v);
+#else
+	int n=0;
+	while(!(v&0x80000000))
+	{
+		v<<=1;
+		++n;
+	}
+	return n;
+#endif
+}
+
 static UINT16 PACK(INT32 val)
 {
 	UINT32 temp;
-	int sign,exponent,k;
+	int sign,exponent;
 
 	sign = (val >> 23) & 0x1;
 	temp = (val ^ (val << 1)) & 0xFFFFFF;
-	exponent = 0;
-	for (k=0; k<12; k++)
-	{
-		if (temp & 0x800000)
-			break;
-		temp <<= 1;
-		exponent += 1;
-	}
+	//exponent is the number of redundant sign bits, saturating at 12
+	exponent = temp ? CLZ32(temp)-8 : 12;
+	if (exponent > 12)
+		exponent = 12;
 	if (exponent < 12)
 		val = (val << exponent) & 0x3FFFFF;
 	else
@@ -66,270 +82,565 @@ void SCSPDSP_Init(struct _SCSPDSP *DSP)
 	DSP->Stopped=1;
 }
 
-void SCSPDSP_Step(struct _SCSPDSP *DSP)
+//registers tracked by the dead step analysis in SCSPDSP_Decode
+#define LIVE_ACC	0x01
+#define LIVE_INPUTS	0x02
+#define LIVE_YREG	0x04
+#define LIVE_FRC	0x08
+#define LIVE_ADRS	0x10
+#define LIVE_MEMVAL	0x20
+
+/*
+    Backward liveness pass over MPRO[0..LastStep-1].  ACC, INPUTS, Y_REG,
+    FRC_REG, ADRS_REG and MEMVAL start from 0 on every sample, so they are
+    dead after the last step.  TEMP and MEMS persist across samples: TEMP is
+    addressed relative to DEC so any TEMP read may see any TEMP write, MEMS
+    is absolute so only MEMS[n] reads keep MEMS[n] writes alive.  EFREG and
+    ring buffer writes are the outputs.  Returns the number of kept steps,
+    with keep[] set for each one and reads of TEMP/MEMS reported back.
+*/
+static int DSP_MarkLive(const struct _SCSPDSP *DSP, int last, int temp_live, UINT32 mems_live,
+			UINT8 *keep, int *temp_read, UINT32 *mems_read)
 {
-	INT32 ACC=0;	//26 bit
-	INT32 SHIFTED=0;	//24 bit
-	INT32 X=0;	//24 bit
-	INT32 Y=0;	//13 bit
-	INT32 B=0;	//26 bit
-	INT32 INPUTS=0;	//24 bit
-	INT32 MEMVAL=0;
-	INT32 FRC_REG=0;	//13 bit
-	INT32 Y_REG=0;		//24 bit
-	UINT32 ADDR=0;
-	UINT32 ADRS_REG=0;	//13 bit
-	int step;
+	UINT32 live=0;
+	int step,kept=0;
 
-	if(DSP->Stopped)
-		return;
-
-	memset(DSP->EFREG,0,2*16);
-	#if 0
-	int dump=0;
-	FILE *f=NULL;
-	if(dump)
-		f=fopen("dsp.txt","wt");
-	#endif
-	for(step=0; step</*128*/DSP->LastStep; ++step)
+	*temp_read=0;
+	*mems_read=0;
+	for(step=last-1; step>=0; --step)
 	{
-		UINT16 *IPtr=DSP->MPRO+step*4;
+		const UINT16 *IPtr=DSP->MPRO+step*4;
+		UINT32 TRA_used=0,inputs_used=0,shifted_used=0;
+		UINT32 defs,uses=0,need;
 
-//      if(IPtr[0]==0 && IPtr[1]==0 && IPtr[2]==0 && IPtr[3]==0)
-//          break;
-
-		UINT32 TRA=(IPtr[0]>>8)&0x7F;
 		UINT32 TWT=(IPtr[0]>>7)&0x01;
-		UINT32 TWA=(IPtr[0]>>0)&0x7F;
-
 		UINT32 XSEL=(IPtr[1]>>15)&0x01;
 		UINT32 YSEL=(IPtr[1]>>13)&0x03;
 		UINT32 IRA=(IPtr[1]>>6)&0x3F;
 		UINT32 IWT=(IPtr[1]>>5)&0x01;
 		UINT32 IWA=(IPtr[1]>>0)&0x1F;
-
-		UINT32 TABLE=(IPtr[2]>>15)&0x01;
-		UINT32 MWT=(IPtr[2]>>14)&0x01;
-		UINT32 MRD=(IPtr[2]>>13)&0x01;
+		UINT32 MWT=((IPtr[2]>>14)&0x01) && (step&1);	//see SCSPDSP_Step
+		UINT32 MRD=((IPtr[2]>>13)&0x01) && (step&1);
 		UINT32 EWT=(IPtr[2]>>12)&0x01;
-		UINT32 EWA=(IPtr[2]>>8)&0x0F;
 		UINT32 ADRL=(IPtr[2]>>7)&0x01;
 		UINT32 FRCL=(IPtr[2]>>6)&0x01;
 		UINT32 SHIFT=(IPtr[2]>>4)&0x03;
 		UINT32 YRL=(IPtr[2]>>3)&0x01;
-		UINT32 NEGB=(IPtr[2]>>2)&0x01;
 		UINT32 ZERO=(IPtr[2]>>1)&0x01;
 		UINT32 BSEL=(IPtr[2]>>0)&0x01;
+		UINT32 ADREB=(IPtr[3]>>1)&0x1;
 
-		UINT32 NOFL=(IPtr[3]>>15)&1;		//????
-		UINT32 COEF=(IPtr[3]>>9)&0x3f;
+		defs=LIVE_ACC;
+		if(IRA<0x32)
+			defs|=LIVE_INPUTS;
+		if(YRL)
+			defs|=LIVE_YREG;
+		if(FRCL)
+			defs|=LIVE_FRC;
+		if(ADRL)
+			defs|=LIVE_ADRS;
+		if(MRD)
+			defs|=LIVE_MEMVAL;
 
-		UINT32 MASA=(IPtr[3]>>2)&0x1f;	//???
-		UINT32 ADREB=(IPtr[3]>>1)&0x1;
-		UINT32 NXADR=(IPtr[3]>>0)&0x1;
+		need=EWT || MWT || (TWT && temp_live) || (IWT && ((mems_live>>IWA)&1)) || (live&defs);
+		if(!need)
+		{
+			keep[step]=0;
+			continue;
+		}
+		keep[step]=1;
+		++kept;
 
-		INT64 v;
+		if(live&LIVE_ACC)
+		{
+			if(XSEL)
+				inputs_used=1;
+			else
+				TRA_used=1;
+			if(YSEL==0)
+				uses|=LIVE_FRC;
+			else if(YSEL>=2)
+				uses|=LIVE_YREG;
+			if(!ZERO)
+			{
+				if(BSEL)
+					uses|=LIVE_ACC;
+				else
+					TRA_used=1;
+			}
+		}
+		if((live&LIVE_INPUTS) && IRA<0x32)	//a later step reads what this one latched
+			inputs_used=1;
+		if((live&LIVE_YREG) && YRL)
+			inputs_used=1;
+		if((live&LIVE_ADRS) && ADRL)
+		{
+			if(SHIFT==3)
+				shifted_used=1;
+			else
+				inputs_used=1;
+		}
+		if(EWT || MWT || (TWT && temp_live) || ((live&LIVE_FRC) && FRCL))
+			shifted_used=1;
+		if(shifted_used)
+			uses|=LIVE_ACC;
+		if((MWT || ((live&LIVE_MEMVAL) && MRD)) && ADREB)
+			uses|=LIVE_ADRS;
+		if(IWT && ((mems_live>>IWA)&1))
+			uses|=LIVE_MEMVAL;
+		if(inputs_used)
+		{
+			if(IWT && IRA==IWA)
+				uses|=LIVE_MEMVAL;
+			else if(IRA<=0x1f)
+				*mems_read|=1u<<IRA;
+			else if(IRA>=0x32)
+				uses|=LIVE_INPUTS;
+		}
+		if(TRA_used)
+			*temp_read=1;
 
-		//operations are done at 24 bit precision
-		#if 0
-		if(MASA)
-			int a=1;
-		if(NOFL)
-			int a=1;
+		live=(live&~defs)|uses;
+	}
+	return kept;
+}
+
+//shrink the persistent live sets until they only contain what kept steps read
+static int DSP_Liveness(const struct _SCSPDSP *DSP, int last, UINT8 *keep,
+			int *temp_live, UINT32 *mems_live)
+{
+	int temp_read,kept;
+	UINT32 mems_read;
+
+	*temp_live=1;
+	*mems_live=0xFFFFFFFF;
+	for(;;)
+	{
+		kept=DSP_MarkLive(DSP,last,*temp_live,*mems_live,keep,&temp_read,&mems_read);
+		if(temp_read==*temp_live && mems_read==*mems_live)
+			return kept;
+		*temp_live=temp_read;
+		*mems_live=mems_read;
+	}
+}
+
+//index of the last non-NOP step + 1
+static int DSP_ProgramLength(const struct _SCSPDSP *DSP)
+{
+	int i;
+	for(i=127; i>=0; --i)
+	{
+		const UINT16 *IPtr=DSP->MPRO+i*4;
+
+		if(IPtr[0]!=0 || IPtr[1]!=0 || IPtr[2]!=0 || IPtr[3]!=0)
+			break;
+	}
+	return i+1;
+}
+
+/*
+    Decode MPRO[0..LastStep-1] into OPS[], dropping steps that can't reach
+    EFREG or the ring buffer.  Called from SCSPDSP_Start and lazily from
+    SCSPDSP_Step after MPRO writes.  Doesn't allocate, so it is safe on the
+    render thread; native code for the new OPS waits for SCSPDSP_Compile.
+*/
+void SCSPDSP_Decode(struct _SCSPDSP *DSP)
+{
+	UINT8 keep[128];
+	int temp_live;
+	UINT32 mems_live;
+	int step,n;
+
+	DSP_Liveness(DSP,DSP->LastStep,keep,&temp_live,&mems_live);
+	if(DSP->NoElim)
+		memset(keep,1,sizeof(keep));
+
+	n=0;
+	for(step=0; step<DSP->LastStep; ++step)
+	{
+		UINT16 *IPtr=DSP->MPRO+step*4;
+		struct _SCSPDSP_OP *op;
+		UINT16 f=0;
+
+		if(!keep[step])
+			continue;
+		op=DSP->OPS+n++;
+
+		if((IPtr[0]>>7)&0x01)	f|=DSPOP_TWT;
+		if((IPtr[1]>>15)&0x01)	f|=DSPOP_XSEL;
+		if((IPtr[1]>>5)&0x01)	f|=DSPOP_IWT;
+		if((IPtr[2]>>15)&0x01)	f|=DSPOP_TABLE;
+		if(((IPtr[2]>>14)&0x01) && (step&1))	f|=DSPOP_MWT;	//memory only allowed on odd? DoA inserts NOPs on even
+		if(((IPtr[2]>>13)&0x01) && (step&1))	f|=DSPOP_MRD;
+		if((IPtr[2]>>12)&0x01)	f|=DSPOP_EWT;
+		if((IPtr[2]>>7)&0x01)	f|=DSPOP_ADRL;
+		if((IPtr[2]>>6)&0x01)	f|=DSPOP_FRCL;
+		if((IPtr[2]>>3)&0x01)	f|=DSPOP_YRL;
+		if((IPtr[2]>>2)&0x01)	f|=DSPOP_NEGB;
+		if((IPtr[2]>>1)&0x01)	f|=DSPOP_ZERO;
+		if((IPtr[2]>>0)&0x01)	f|=DSPOP_BSEL;
+		if((IPtr[3]>>15)&1)	f|=DSPOP_NOFL;
+		if((IPtr[3]>>1)&0x1)	f|=DSPOP_ADREB;
+		if((IPtr[3]>>0)&0x1)	f|=DSPOP_NXADR;
+
+		op->FLAGS=f;
+		op->TRA=(IPtr[0]>>8)&0x7F;
+		op->TWA=(IPtr[0]>>0)&0x7F;
+		op->IRA=(IPtr[1]>>6)&0x3F;
+		op->IWA=(IPtr[1]>>0)&0x1F;
+		op->YSEL=(IPtr[1]>>13)&0x03;
+		op->SHIFT=(IPtr[2]>>4)&0x03;
+		op->EWA=(IPtr[2]>>8)&0x0F;
+		op->COEF=(IPtr[3]>>9)&0x3f;
+		op->MASA=(IPtr[3]>>2)&0x1f;
+		op->STEP=step;
+	}
+	DSP->NumOps=n;
+	DSP->Dirty=0;
+	DSP->JitStale=1;
+}
+
+/*
+    Build native code for the decoded program (SCSPDSP_JIT builds).  This
+    maps executable memory, so call it where a program is loaded, never
+    from the render thread; SCSPDSP_Step interprets until it has run.
+*/
+void SCSPDSP_Compile(struct _SCSPDSP *DSP)
+{
+	if(DSP->Dirty)
+		SCSPDSP_Decode(DSP);
+	SCSPDSP_JitFree(DSP);
+#ifdef SCSPDSP_JIT
+	if(!DSP->NoJit)
+		DSP->JitCode=DSP_JitCompile(DSP,&DSP->JitSize);
+#endif
+	DSP->JitStale=0;
+}
+
+/*
+    Parameter ramps.  Each active ramp moves its COEF/MADRS entry one sample
+    further per SCSPDSP_Step and lands exactly on the target after the
+    requested number of samples.  samples==0 sets the value and cancels any
+    ramp in progress on that entry.
+*/
+static void DSP_StartRamp(struct _SCSPDSP_RAMP *r,INT32 from,INT32 target,UINT32 samples,int shape)
+{
+	r->Cur=from;
+	r->Target=target;
+	r->Left=samples;
+	r->Shape=shape;
+	if(shape==DSPRAMP_EXP)
+		r->Inc=pow(0.001,1.0/samples);
+	else
+		r->Inc=(double) (target-from)/samples;
+}
+
+static INT32 DSP_RampStep(struct _SCSPDSP_RAMP *r)
+{
+	if(--r->Left==0)
+		return r->Target;
+	if(r->Shape==DSPRAMP_EXP)
+		r->Cur=r->Target+(r->Cur-r->Target)*r->Inc;
+	else
+		r->Cur+=r->Inc;
+	return (INT32) floor(r->Cur+0.5);
+}
+
+void SCSPDSP_RampCoef(struct _SCSPDSP *DSP,int index,INT16 target,UINT32 samples,int shape)
+{
+	UINT64 bit=(UINT64) 1<<index;
+
+	if(!samples || DSP->COEF[index]==target)
+	{
+		DSP->COEF[index]=target;
+		DSP->RampCoef&=~bit;
+		return;
+	}
+	DSP_StartRamp(DSP->RAMPS+index,DSP->COEF[index],target,samples,shape);
+	DSP->RampCoef|=bit;
+}
+
+void SCSPDSP_RampMadrs(struct _SCSPDSP *DSP,int index,UINT16 target,UINT32 samples,int shape)
+{
+	UINT32 bit=1u<<index;
+
+	if(!samples || DSP->MADRS[index]==target)
+	{
+		DSP->MADRS[index]=target;
+		DSP->RampMadrs&=~bit;
+		return;
+	}
+	DSP_StartRamp(DSP->RAMPS+64+index,DSP->MADRS[index],target,samples,shape);
+	DSP->RampMadrs|=bit;
+}
+
+static void DSP_UpdateRamps(struct _SCSPDSP *DSP)
+{
+	int i;
 
-//      int dump=0;
+	for(i=0; i<64 && DSP->RampCoef; ++i)
+	{
+		if(!((DSP->RampCoef>>i)&1))
+			continue;
+		DSP->COEF[i]=(INT16) DSP_RampStep(DSP->RAMPS+i);
+		if(!DSP->RAMPS[i].Left)
+			DSP->RampCoef&=~((UINT64) 1<<i);
+	}
+	for(i=0; i<32 && DSP->RampMadrs; ++i)
+	{
+		if(!((DSP->RampMadrs>>i)&1))
+			continue;
+		DSP->MADRS[i]=(UINT16) DSP_RampStep(DSP->RAMPS+64+i);
+		if(!DSP->RAMPS[64+i].Left)
+			DSP->RampMadrs&=~(1u<<i);
+	}
+}
+
+//Leave bypass.  Whatever recirculated in feedback paths would have decayed
+//while the program wasn't running, so start again from silence.
+static void DSP_Resume(struct _SCSPDSP *DSP)
+{
+	UINT32 base=DSP->RBP<<12;
+
+	memset(DSP->TEMP,0,sizeof(DSP->TEMP));
+	memset(DSP->MEMS,0,sizeof(DSP->MEMS));
+	if(DSP->SCSPRAM && base+DSP->RBL<=DSP->SCSPRAM_LENGTH)
+		memset(DSP->SCSPRAM+base,0,DSP->RBL*2);
+	DSP->Bypassed=0;
+}
+
+void SCSPDSP_SetRouting(struct _SCSPDSP *DSP,int slot,int imxl,int efsdl)
+{
+	UINT32 bit=1u<<slot;
+
+	if(imxl)
+		DSP->InSlots|=bit;
+	else
+		DSP->InSlots&=~bit;
+	if(slot<16 && efsdl)
+		DSP->OutSlots|=bit;
+	else
+		DSP->OutSlots&=~bit;
+}
+
+void SCSPDSP_Step(struct _SCSPDSP *DSP)
+{
+	INT32 ACC=0;	//26 bit
+	INT32 SHIFTED=0;	//24 bit
+	INT32 X=0;	//24 bit
+	INT32 Y=0;	//13 bit
+	INT32 B=0;	//26 bit
+	INT32 INPUTS=0;	//24 bit
+	INT32 MEMVAL=0;
+	INT32 FRC_REG=0;	//13 bit
+	INT32 Y_REG=0;		//24 bit
+	UINT32 ADDR=0;
+	UINT32 ADRS_REG=0;	//13 bit
+	const struct _SCSPDSP_OP *op,*end;
+
+	if(DSP->RampCoef || DSP->RampMadrs)
+		DSP_UpdateRamps(DSP);
 
-		if(f)
+	if(DSP->Stopped)
+		return;
+
+	//No EFREG is mixed out, so nothing the program computes can be heard,
+	//whatever slots still send to it: stop running it.  DEC keeps moving
+	//so delay taps stay aligned when an output is routed again.
+	if(!DSP->OutSlots)
+	{
+		if(!DSP->Bypassed)
 		{
-#define DUMP(v)	fprintf(f," " #v ": %04X",v);
-
-			fprintf(f,"%d: ",step);
-			DUMP(ACC);
-			DUMP(SHIFTED);
-			DUMP(X);
-			DUMP(Y);
-			DUMP(B);
-			DUMP(INPUTS);
-			DUMP(MEMVAL);
-			DUMP(FRC_REG);
-			DUMP(Y_REG);
-			DUMP(ADDR);
-			DUMP(ADRS_REG);
-			fprintf(f,"\n");
+			memset(DSP->EFREG,0,2*16);
+			DSP->Bypassed=1;
 		}
-		#endif
+		--DSP->DEC;
+		memset(DSP->MIXS,0,4*16);
+		return;
+	}
+	if(DSP->Bypassed)
+		DSP_Resume(DSP);
+
+	if(DSP->Dirty)
+		SCSPDSP_Decode(DSP);
+
+	memset(DSP->EFREG,0,2*16);
+#ifdef SCSPDSP_JIT
+	if(DSP->JitCode && !DSP->JitStale)
+	{
+		((void (*)(struct _SCSPDSP *))DSP->JitCode)(DSP);
+		--DSP->DEC;
+		memset(DSP->MIXS,0,4*16);
+		return;
+	}
+#endif
+	for(op=DSP->OPS, end=DSP->OPS+DSP->NumOps; op<end; ++op)
+	{
+		UINT32 f=op->FLAGS;
+		INT64 v;
+
+		//operations are done at 24 bit precision
+
 		//INPUTS RW
-		assert(IRA<0x32);
-		if(IRA<=0x1f)
-			INPUTS=DSP->MEMS[IRA];
-		else if(IRA<=0x2F)
-			INPUTS=DSP->MIXS[IRA-0x20]<<4;	//MIXS is 20 bit
-		else if(IRA<=0x31)
-			INPUTS=0;
+		//(IRA 0x32-0x3F is invalid and leaves INPUTS unchanged)
+		if(op->IRA<=0x1f)
+			INPUTS=DSP->MEMS[op->IRA];
+		else if(op->IRA<=0x2F)
+			INPUTS=DSP->MIXS[op->IRA-0x20]<<4;	//MIXS is 20 bit
+		else if(op->IRA<=0x31)
+			INPUTS=DSP->EXTS[op->IRA-0x30]<<8;	//EXTS is 16 bit
 
 		INPUTS<<=8;
 		INPUTS>>=8;
-		//if(INPUTS&0x00800000)
-		//  INPUTS|=0xFF000000;
 
-		if(IWT)
+		if(f&DSPOP_IWT)
 		{
-			DSP->MEMS[IWA]=MEMVAL;	//MEMVAL was selected in previous MRD
-			if(IRA==IWA)
+			DSP->MEMS[op->IWA]=MEMVAL;	//MEMVAL was selected in previous MRD
+			if(op->IRA==op->IWA)
 				INPUTS=MEMVAL;
 		}
 
 		//Operand sel
 		//B
-		if(!ZERO)
+		if(!(f&DSPOP_ZERO))
 		{
-			if(BSEL)
+			if(f&DSPOP_BSEL)
 				B=ACC;
 			else
 			{
-				B=DSP->TEMP[(TRA+DSP->DEC)&0x7F];
+				B=DSP->TEMP[(op->TRA+DSP->DEC)&0x7F];
 				B<<=8;
 				B>>=8;
-				//if(B&0x00800000)
-				//  B|=0xFF000000;  //Sign extend
 			}
-			if(NEGB)
+			if(f&DSPOP_NEGB)
 				B=0-B;
 		}
 		else
 			B=0;
 
 		//X
-		if(XSEL)
+		if(f&DSPOP_XSEL)
 			X=INPUTS;
 		else
 		{
-			X=DSP->TEMP[(TRA+DSP->DEC)&0x7F];
+			X=DSP->TEMP[(op->TRA+DSP->DEC)&0x7F];
 			X<<=8;
 			X>>=8;
-			//if(X&0x00800000)
-			//  X|=0xFF000000;
 		}
 
 		//Y
-		if(YSEL==0)
-			Y=FRC_REG;
-		else if(YSEL==1)
-			Y=DSP->COEF[COEF]>>3;	//COEF is 16 bits
-		else if(YSEL==2)
-			Y=(Y_REG>>11)&0x1FFF;
-		else if(YSEL==3)
-			Y=(Y_REG>>4)&0x0FFF;
+		switch(op->YSEL)
+		{
+			case 0: Y=FRC_REG; break;
+			case 1: Y=DSP->COEF[op->COEF]>>3; break;	//COEF is 16 bits
+			case 2: Y=(Y_REG>>11)&0x1FFF; break;
+			case 3: Y=(Y_REG>>4)&0x0FFF; break;
+		}
 
-		if(YRL)
+		if(f&DSPOP_YRL)
 			Y_REG=INPUTS;
 
 		//Shifter
-		if(SHIFT==0)
+		switch(op->SHIFT)
 		{
-			SHIFTED=ACC;
-			if(SHIFTED>0x007FFFFF)
-				SHIFTED=0x007FFFFF;
-			if(SHIFTED<(-0x00800000))
-				SHIFTED=-0x00800000;
-		}
-		else if(SHIFT==1)
-		{
-			SHIFTED=ACC*2;
-			if(SHIFTED>0x007FFFFF)
-				SHIFTED=0x007FFFFF;
-			if(SHIFTED<(-0x00800000))
-				SHIFTED=-0x00800000;
-		}
-		else if(SHIFT==2)
-		{
-			SHIFTED=ACC*2;
-			SHIFTED<<=8;
-			SHIFTED>>=8;
-			//SHIFTED&=0x00FFFFFF;
-			//if(SHIFTED&0x00800000)
-			//  SHIFTED|=0xFF000000;
-		}
-		else if(SHIFT==3)
-		{
-			SHIFTED=ACC;
-			SHIFTED<<=8;
-			SHIFTED>>=8;
-			//SHIFTED&=0x00FFFFFF;
-			//if(SHIFTED&0x00800000)
-			//  SHIFTED|=0xFF000000;
+			case 0:
+				SHIFTED=ACC;
+				if(SHIFTED>0x007FFFFF)
+					SHIFTED=0x007FFFFF;
+				if(SHIFTED<(-0x00800000))
+					SHIFTED=-0x00800000;
+				break;
+			case 1:
+				SHIFTED=ACC*2;
+				if(SHIFTED>0x007FFFFF)
+					SHIFTED=0x007FFFFF;
+				if(SHIFTED<(-0x00800000))
+					SHIFTED=-0x00800000;
+				break;
+			case 2:
+				SHIFTED=ACC*2;
+				SHIFTED<<=8;
+				SHIFTED>>=8;
+				break;
+			case 3:
+				SHIFTED=ACC;
+				SHIFTED<<=8;
+				SHIFTED>>=8;
+				break;
 		}
 
 		//ACCUM
 		Y<<=19;
 		Y>>=19;
-		//if(Y&0x1000)
-		//  Y|=0xFFFFF000;
 
 		v=(((INT64) X*(INT64) Y)>>12);
 		ACC=(int) v+B;
 
-		if(TWT)
-			DSP->TEMP[(TWA+DSP->DEC)&0x7F]=SHIFTED;
+		if(f&DSPOP_TWT)
+			DSP->TEMP[(op->TWA+DSP->DEC)&0x7F]=SHIFTED;
 
-		if(FRCL)
+		if(f&DSPOP_FRCL)
 		{
-			if(SHIFT==3)
+			if(op->SHIFT==3)
 				FRC_REG=SHIFTED&0x0FFF;
 			else
 				FRC_REG=(SHIFTED>>11)&0x1FFF;
 		}
 
-		if(MRD || MWT)
-		//if(0)
+		if(f&(DSPOP_MRD|DSPOP_MWT))
 		{
-			ADDR=DSP->MADRS[MASA];
-			if(!TABLE)
+			ADDR=DSP->MADRS[op->MASA];
+			if(!(f&DSPOP_TABLE))
 				ADDR+=DSP->DEC;
-			if(ADREB)
+			if(f&DSPOP_ADREB)
 				ADDR+=ADRS_REG&0x0FFF;
-			if(NXADR)
+			if(f&DSPOP_NXADR)
 				ADDR++;
-			if(!TABLE)
+			if(!(f&DSPOP_TABLE))
 				ADDR&=DSP->RBL-1;
 			else
 				ADDR&=0xFFFF;
-			//ADDR<<=1;
-			//ADDR+=DSP->RBP<<13;
-			//MEMVAL=DSP->SCSPRAM[ADDR>>1];
 			ADDR+=DSP->RBP<<12;
-			if(MRD && (step&1))	//memory only allowed on odd? DoA inserts NOPs on even
+			if(f&DSPOP_MRD)
 			{
-				if(NOFL)
+				if(f&DSPOP_NOFL)
 					MEMVAL=DSP->SCSPRAM[ADDR]<<8;
 				else
 					MEMVAL=UNPACK(DSP->SCSPRAM[ADDR]);
 			}
-			if(MWT && (step&1))
+			if(f&DSPOP_MWT)
 			{
-				if(NOFL)
+				if(f&DSPOP_NOFL)
 					DSP->SCSPRAM[ADDR]=SHIFTED>>8;
 				else
 					DSP->SCSPRAM[ADDR]=PACK(SHIFTED);
 			}
 		}
 
-		if(ADRL)
+		if(f&DSPOP_ADRL)
 		{
-			if(SHIFT==3)
+			if(op->SHIFT==3)
 				ADRS_REG=(SHIFTED>>12)&0xFFF;
 			else
 				ADRS_REG=(INPUTS>>16);
 		}
 
-		if(EWT)
-			DSP->EFREG[EWA]+=SHIFTED>>8;
+		if(f&DSPOP_EWT)
+			DSP->EFREG[op->EWA]+=SHIFTED>>8;
 
 	}
 	--DSP->DEC;
 	memset(DSP->MIXS,0,4*16);
-//  if(f)
-//      fclose(f);
+}
+
+void SCSPDSP_JitFree(struct _SCSPDSP *DSP)
+{
+#ifdef SCSPDSP_JIT
+	if(DSP->JitCode)
+		jit_free_exec(DSP->JitCode,DSP->JitSize);
+#endif
+	DSP->JitCode=NULL;
+	DSP->JitSize=0;
 }
 
 void SCSPDSP_SetSample(struct _SCSPDSP *DSP,INT32 sample,int SEL,int MXL)
@@ -342,15 +653,117 @@ void SCSPDSP_SetSample(struct _SCSPDSP *DSP,INT32 sample,int SEL,int MXL)
 
 void SCSPDSP_Start(struct _SCSPDSP *DSP)
 {
-	int i;
 	DSP->Stopped=0;
-	for(i=127; i>=0; --i)
+	DSP->RampCoef=0;	//glides belong to the previous program
+	DSP->RampMadrs=0;
+	DSP->LastStep=DSP_ProgramLength(DSP);
+	SCSPDSP_Decode(DSP);
+}
+
+/*
+    Swap in a new program between two samples, keeping TEMP, MEMS, DEC and
+    the ring buffer, so delay lines and reverb tails carry on through the
+    edit.  Only steps whose MPRO words differ count as changed; when none
+    do, COEF/MADRS glide to their new values over ramp samples instead of
+    jumping.  Returns the number of changed steps.
+*/
+int SCSPDSP_Reload(struct _SCSPDSP *DSP,const UINT16 *MPRO,const INT16 *COEF,const UINT16 *MADRS,UINT32 ramp)
+{
+	int step,i,changed=0;
+
+	for(step=0; step<128; ++step)
+		if(memcmp(DSP->MPRO+step*4,MPRO+step*4,4*sizeof(UINT16)))
+			++changed;
+
+	if(changed)
+	{
+		memcpy(DSP->MPRO,MPRO,sizeof(DSP->MPRO));
+		ramp=0;		//coefficients may mean something else in the edited program
+	}
+	for(i=0; i<64; ++i)
+		SCSPDSP_RampCoef(DSP,i,COEF[i],ramp,DSPRAMP_LINEAR);
+	for(i=0; i<32; ++i)
+		SCSPDSP_RampMadrs(DSP,i,MADRS[i],ramp,DSPRAMP_LINEAR);
+
+	if(changed || DSP->Dirty)
 	{
-		UINT16 *IPtr=DSP->MPRO+i*4;
+		DSP->LastStep=DSP_ProgramLength(DSP);
+		SCSPDSP_Decode(DSP);
+	}
+	if(DSP->LastStep==0)	//nothing left to run; a stopped DSP stays stopped otherwise
+		DSP->Stopped=1;
+	return changed;
+}
 
-		if(IPtr[0]!=0 || IPtr[1]!=0 || IPtr[2]!=0 || IPtr[3]!=0)
-			break;
+/*
+    Static analysis of the program in MPRO/MADRS, without touching the
+    running state.  Only steps that survive dead step elimination count.
+    Ring offsets assume the worst case for ADREB (ADRS_REG up to 0xFFF).
+*/
+void SCSPDSP_Analyze(const struct _SCSPDSP *DSP, struct _SCSPDSP_INFO *info)
+{
+	UINT8 keep[128];
+	int step,last;
+	UINT32 ring_top=0,table_top=0;
+
+	memset(info,0,sizeof(*info));
+	last=DSP_ProgramLength(DSP);
+	info->Steps=last;
+	info->ActiveSteps=DSP_Liveness(DSP,last,keep,&info->TempLive,&info->MemsLive);
+
+	for(step=0; step<last; ++step)
+	{
+		const UINT16 *IPtr=DSP->MPRO+step*4;
+		UINT32 TWT=(IPtr[0]>>7)&0x01;
+		UINT32 TRA=(IPtr[0]>>8)&0x7F;
+		UINT32 TWA=(IPtr[0]>>0)&0x7F;
+		UINT32 XSEL=(IPtr[1]>>15)&0x01;
+		UINT32 IRA=(IPtr[1]>>6)&0x3F;
+		UINT32 IWT=(IPtr[1]>>5)&0x01;
+		UINT32 IWA=(IPtr[1]>>0)&0x1F;
+		UINT32 TABLE=(IPtr[2]>>15)&0x01;
+		UINT32 MWT=((IPtr[2]>>14)&0x01) && (step&1);
+		UINT32 MRD=((IPtr[2]>>13)&0x01) && (step&1);
+		UINT32 ZERO=(IPtr[2]>>1)&0x01;
+		UINT32 BSEL=(IPtr[2]>>0)&0x01;
+		UINT32 MASA=(IPtr[3]>>2)&0x1f;
+		UINT32 ADREB=(IPtr[3]>>1)&0x1;
+		UINT32 NXADR=(IPtr[3]>>0)&0x1;
+
+		if(!keep[step])
+			continue;
+
+		if(!XSEL || (!ZERO && !BSEL))
+			info->TempRead[TRA>>5]|=1u<<(TRA&31);
+		if(TWT)
+			info->TempWrite[TWA>>5]|=1u<<(TWA&31);
+		if(IRA<=0x1f)
+			info->MemsRead|=1u<<IRA;
+		if(IWT)
+			info->MemsWrite|=1u<<IWA;
+
+		if(MRD || MWT)
+		{
+			UINT32 top=DSP->MADRS[MASA]+(ADREB?0xFFF:0)+NXADR+1;
+
+			if(MRD)
+				++info->MemReads;
+			if(MWT)
+				++info->MemWrites;
+			if(TABLE)
+			{
+				if(top>0x10000)
+					top=0x10000;
+				if(top>table_top)
+					table_top=top;
+			}
+			else if(top>ring_top)
+				ring_top=top;
+		}
 	}
-	DSP->LastStep=i+1;
 
+	info->RingWords=ring_top;
+	info->TableWords=table_top;
+	for(info->MinRBL=0; info->MinRBL<3 && (0x2000u<<info->MinRBL)<ring_top; ++info->MinRBL)
+		;
 }
@@ -0,0 +1,501 @@
+/*
+ * scspdsp_jit.c — x86-64 native code generator for the SCSP DSP.
+ *
+ * Included by scspdsp.c when SCSPDSP_JIT is defined (x86-64, non-WASM).
+ * Translates the decoded op array (DSP->OPS, see SCSPDSP_Decode) into one
+ * straight-line function with the same semantics as the interpreter loop
+ * in SCSPDSP_Step.  COEF, MADRS, RBL, RBP and DEC are read from the DSP
+ * struct at run time, so live edits through scsp_dsp_set_coef() and
+ * scsp_dsp_set_madrs() keep working without recompiling.
+ *
+ * Register assignment (callee-saved, so no spills):
+ *   rbx = DSP          r12d = ACC        r13d = FRC_REG
+ *   r14d = Y_REG       r15d = ADRS_REG   ebp  = MEMVAL
+ *   esi = INPUTS       edi  = DEC
+ * Scratch: eax, ecx, edx, r8d (Y, then ADDR), r9d (SHIFTED),
+ *          r10 (sound RAM base), r11d.
+ *
+ * If executable memory can't be obtained (W^X policies, hardened runtime)
+ * compilation fails and SCSPDSP_Step keeps using the interpreter.
+ */
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+/* ALU opcodes (reg, r/m form) and their /digit for the immediate form */
+#define ALU_ADD 0x01
+#define ALU_OR  0x09
+#define ALU_AND 0x21
+#define ALU_SUB 0x29
+#define ALU_XOR 0x31
+#define ALU_CMP 0x39
+#define EXT_ADD 0
+#define EXT_AND 4
+#define EXT_XOR 6
+#define EXT_CMP 7
+#define EXT_SHL 4
+#define EXT_SHR 5
+#define EXT_SAR 7
+
+/* Worst case is a step with every flag set plus inline PACK/UNPACK */
+#define JIT_MAX_OP_BYTES 512
+#define JIT_MAX_BYTES    (128 * JIT_MAX_OP_BYTES + 64)
+
+typedef struct {
+    uint8_t *buf;
+    int      len;
+} jit_emit_t;
+
+static void e8(jit_emit_t *e, int b) { e->buf[e->len++] = (uint8_t)b; }
+
+static void e32(jit_emit_t *e, uint32_t v)
+{
+    e8(e, v & 0xFF); e8(e, (v >> 8) & 0xFF);
+    e8(e, (v >> 16) & 0xFF); e8(e, (v >> 24) & 0xFF);
+}
+
+static void rex(jit_emit_t *e, int w, int reg, int index, int base)
+{
+    int r = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0);
+    if (r != 0x40) e8(e, r);
+}
+
+/* ModRM for a register-direct operand */
+static void modrm_rr(jit_emit_t *e, int reg, int rm)
+{
+    e8(e, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* ModRM/SIB/disp32 for [base + index*scale + disp] (index < 0 = none) */
+static void modrm_mem(jit_emit_t *e, int reg, int base, int index, int scale, int32_t disp)
+{
+    if (index < 0 && (base & 7) != RSP) {
+        e8(e, 0x80 | ((reg & 7) << 3) | (base & 7));
+    } else {
+        int ss = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+        e8(e, 0x80 | ((reg & 7) << 3) | 4);
+        e8(e, (ss << 6) | ((index < 0 ? RSP : index) & 7) << 3 | (base & 7));
+    }
+    e32(e, (uint32_t)disp);
+}
+
+/* ── Instruction forms (32-bit operand size unless noted) ─────── */
+
+static void op_rr(jit_emit_t *e, int opc, int dst, int src)
+{
+    rex(e, 0, src, 0, dst); e8(e, opc); modrm_rr(e, src, dst);
+}
+
+static void mov_rr(jit_emit_t *e, int dst, int src) { op_rr(e, 0x89, dst, src); }
+
+static void mov_ri(jit_emit_t *e, int dst, uint32_t imm)
+{
+    rex(e, 0, 0, 0, dst); e8(e, 0xB8 + (dst & 7)); e32(e, imm);
+}
+
+static void alu_ri(jit_emit_t *e, int ext, int dst, uint32_t imm)
+{
+    rex(e, 0, 0, 0, dst); e8(e, 0x81); modrm_rr(e, ext, dst); e32(e, imm);
+}
+
+static void shift_ri(jit_emit_t *e, int ext, int dst, int n)
+{
+    rex(e, 0, 0, 0, dst); e8(e, 0xC1); modrm_rr(e, ext, dst); e8(e, n);
+}
+
+static void shift_cl(jit_emit_t *e, int ext, int dst)
+{
+    rex(e, 0, 0, 0, dst); e8(e, 0xD3); modrm_rr(e, ext, dst);
+}
+
+static void neg_r(jit_emit_t *e, int dst)
+{
+    rex(e, 0, 0, 0, dst); e8(e, 0xF7); modrm_rr(e, 3, dst);
+}
+
+/* cmovcc dst, src */
+static void cmov(jit_emit_t *e, int cc, int dst, int src)
+{
+    rex(e, 0, dst, 0, src); e8(e, 0x0F); e8(e, 0x40 | cc); modrm_rr(e, dst, src);
+}
+#define CC_A 0x7
+#define CC_L 0xC
+#define CC_G 0xF
+
+static void bsr_rr(jit_emit_t *e, int dst, int src)
+{
+    rex(e, 0, dst, 0, src); e8(e, 0x0F); e8(e, 0xBD); modrm_rr(e, dst, src);
+}
+
+static void load32(jit_emit_t *e, int dst, int base, int index, int scale, int32_t disp)
+{
+    rex(e, 0, dst, index < 0 ? 0 : index, base); e8(e, 0x8B);
+    modrm_mem(e, dst, base, index, scale, disp);
+}
+
+static void load64(jit_emit_t *e, int dst, int base, int32_t disp)
+{
+    rex(e, 1, dst, 0, base); e8(e, 0x8B); modrm_mem(e, dst, base, -1, 1, disp);
+}
+
+static void store32(jit_emit_t *e, int base, int index, int scale, int32_t disp, int src)
+{
+    rex(e, 0, src, index < 0 ? 0 : index, base); e8(e, 0x89);
+    modrm_mem(e, src, base, index, scale, disp);
+}
+
+static void movzx16(jit_emit_t *e, int dst, int base, int index, int scale, int32_t disp)
+{
+    rex(e, 0, dst, index < 0 ? 0 : index, base); e8(e, 0x0F); e8(e, 0xB7);
+    modrm_mem(e, dst, base, index, scale, disp);
+}
+
+static void movsx16(jit_emit_t *e, int dst, int base, int32_t disp)
+{
+    rex(e, 0, dst, 0, base); e8(e, 0x0F); e8(e, 0xBF); modrm_mem(e, dst, base, -1, 1, disp);
+}
+
+/* 16-bit store / add-to-memory of the low word of src */
+static void store16(jit_emit_t *e, int base, int index, int scale, int32_t disp, int src)
+{
+    e8(e, 0x66); rex(e, 0, src, index < 0 ? 0 : index, base); e8(e, 0x89);
+    modrm_mem(e, src, base, index, scale, disp);
+}
+
+static void add16_mem(jit_emit_t *e, int base, int32_t disp, int src)
+{
+    e8(e, 0x66); rex(e, 0, src, 0, base); e8(e, 0x01); modrm_mem(e, src, base, -1, 1, disp);
+}
+
+static void push_r(jit_emit_t *e, int r) { rex(e, 0, 0, 0, r); e8(e, 0x50 + (r & 7)); }
+static void pop_r(jit_emit_t *e, int r)  { rex(e, 0, 0, 0, r); e8(e, 0x58 + (r & 7)); }
+
+/* dst = sign-extend low 24 bits of dst */
+static void sext24(jit_emit_t *e, int r)
+{
+    shift_ri(e, EXT_SHL, r, 8);
+    shift_ri(e, EXT_SAR, r, 8);
+}
+
+/* dst = clamp(dst, -0x800000, 0x7FFFFF) */
+static void clamp24(jit_emit_t *e, int r)
+{
+    mov_ri(e, R11, 0x007FFFFF);
+    op_rr(e, ALU_CMP, r, R11);
+    cmov(e, CC_G, r, R11);
+    mov_ri(e, R11, (uint32_t)-0x00800000);
+    op_rr(e, ALU_CMP, r, R11);
+    cmov(e, CC_L, r, R11);
+}
+
+/* dst = TEMP[(tra + DEC) & 0x7F], sign-extended from 24 bits */
+static void load_temp(jit_emit_t *e, int dst, int tra)
+{
+    mov_rr(e, RCX, RDI);
+    alu_ri(e, EXT_ADD, RCX, tra);
+    alu_ri(e, EXT_AND, RCX, 0x7F);
+    load32(e, dst, RBX, RCX, 4, offsetof(struct _SCSPDSP, TEMP));
+    sext24(e, dst);
+}
+
+/* ax = PACK(r9d); see PACK() in scspdsp.c.  OR-ing bit 0 into temp keeps
+   BSR defined for temp == 0 without changing the saturated exponent. */
+static void emit_pack(jit_emit_t *e)
+{
+    mov_rr(e, RAX, R9);
+    op_rr(e, ALU_ADD, RAX, RAX);
+    op_rr(e, ALU_XOR, RAX, R9);
+    alu_ri(e, EXT_AND, RAX, 0xFFFFFF);
+    alu_ri(e, 1 /* or */, RAX, 1);
+    bsr_rr(e, RDX, RAX);
+    mov_ri(e, R11, 23);
+    op_rr(e, ALU_SUB, R11, RDX);         /* exponent = 23 - msb */
+    mov_ri(e, RDX, 12);
+    op_rr(e, ALU_CMP, R11, RDX);
+    cmov(e, CC_A, R11, RDX);             /* saturate at 12 */
+    mov_rr(e, RCX, R11);
+    mov_ri(e, RDX, 11);
+    op_rr(e, ALU_CMP, RCX, RDX);
+    cmov(e, CC_A, RCX, RDX);             /* exponent 12 shifts like 11 */
+    mov_rr(e, RAX, R9);
+    shift_cl(e, EXT_SHL, RAX);
+    shift_ri(e, EXT_SHR, RAX, 11);
+    alu_ri(e, EXT_AND, RAX, 0x7FF);
+    mov_rr(e, RDX, R9);
+    shift_ri(e, EXT_SHR, RDX, 23);
+    alu_ri(e, EXT_AND, RDX, 1);
+    shift_ri(e, EXT_SHL, RDX, 15);
+    op_rr(e, ALU_OR, RAX, RDX);          /* sign */
+    shift_ri(e, EXT_SHL, R11, 11);
+    op_rr(e, ALU_OR, RAX, R11);          /* exponent */
+}
+
+/* ebp = UNPACK(eax), eax holding a zero-extended 16-bit word */
+static void emit_unpack(jit_emit_t *e)
+{
+    mov_rr(e, RDX, RAX);
+    shift_ri(e, EXT_SHR, RDX, 15);       /* sign */
+    mov_rr(e, RCX, RAX);
+    shift_ri(e, EXT_SHR, RCX, 11);
+    alu_ri(e, EXT_AND, RCX, 0xF);        /* exponent */
+    alu_ri(e, EXT_AND, RAX, 0x7FF);
+    shift_ri(e, EXT_SHL, RAX, 11);       /* mantissa << 11 */
+    mov_rr(e, R11, RDX);
+    shift_ri(e, EXT_SHL, R11, 23);
+    op_rr(e, ALU_OR, RAX, R11);          /* sign << 23 */
+    mov_rr(e, R11, RDX);
+    alu_ri(e, EXT_XOR, R11, 1);
+    alu_ri(e, EXT_CMP, RCX, 11);
+    cmov(e, CC_A, R11, RDX);             /* exponent > 11 ? sign : sign ^ 1 */
+    mov_ri(e, RDX, 11);                  /* mov leaves flags intact */
+    cmov(e, CC_A, RCX, RDX);
+    shift_ri(e, EXT_SHL, R11, 22);
+    op_rr(e, ALU_OR, RAX, R11);
+    sext24(e, RAX);
+    shift_cl(e, EXT_SAR, RAX);
+    mov_rr(e, RBP, RAX);
+}
+
+static void emit_op(jit_emit_t *e, const struct _SCSPDSP_OP *op)
+{
+    UINT32 f = op->FLAGS;
+    int need_shifted = (f & (DSPOP_TWT | DSPOP_FRCL | DSPOP_MWT | DSPOP_EWT)) ||
+                       ((f & DSPOP_ADRL) && op->SHIFT == 3);
+
+    /* INPUTS (IRA 0x32-0x3F leaves it unchanged) */
+    if (op->IRA <= 0x1F) {
+        load32(e, RSI, RBX, -1, 1, offsetof(struct _SCSPDSP, MEMS) + op->IRA * 4);
+        sext24(e, RSI);
+    } else if (op->IRA <= 0x2F) {
+        load32(e, RSI, RBX, -1, 1, offsetof(struct _SCSPDSP, MIXS) + (op->IRA - 0x20) * 4);
+        shift_ri(e, EXT_SHL, RSI, 4);
+        sext24(e, RSI);
+    } else if (op->IRA <= 0x31) {
+        movsx16(e, RSI, RBX, offsetof(struct _SCSPDSP, EXTS) + (op->IRA - 0x30) * 2);
+        shift_ri(e, EXT_SHL, RSI, 8);
+    } else {
+        sext24(e, RSI);
+    }
+
+    if (f & DSPOP_IWT) {
+        store32(e, RBX, -1, 1, offsetof(struct _SCSPDSP, MEMS) + op->IWA * 4, RBP);
+        if (op->IRA == op->IWA) mov_rr(e, RSI, RBP);
+    }
+
+    /* B -> edx */
+    if (!(f & DSPOP_ZERO)) {
+        if (f & DSPOP_BSEL) mov_rr(e, RDX, R12);
+        else                load_temp(e, RDX, op->TRA);
+        if (f & DSPOP_NEGB) neg_r(e, RDX);
+    }
+
+    /* X -> eax */
+    if (f & DSPOP_XSEL) mov_rr(e, RAX, RSI);
+    else                load_temp(e, RAX, op->TRA);
+
+    /* Y -> r8d */
+    switch (op->YSEL) {
+    case 0:
+        mov_rr(e, R8, R13);
+        break;
+    case 1:
+        movsx16(e, R8, RBX, offsetof(struct _SCSPDSP, COEF) + op->COEF * 2);
+        shift_ri(e, EXT_SAR, R8, 3);
+        break;
+    case 2:
+        mov_rr(e, R8, R14);
+        shift_ri(e, EXT_SAR, R8, 11);
+        alu_ri(e, EXT_AND, R8, 0x1FFF);
+        break;
+    case 3:
+        mov_rr(e, R8, R14);
+        shift_ri(e, EXT_SAR, R8, 4);
+        alu_ri(e, EXT_AND, R8, 0x0FFF);
+        break;
+    }
+    shift_ri(e, EXT_SHL, R8, 19);
+    shift_ri(e, EXT_SAR, R8, 19);
+
+    if (f & DSPOP_YRL) mov_rr(e, R14, RSI);
+
+    /* SHIFTED -> r9d, from the ACC value before this step */
+    if (need_shifted) {
+        mov_rr(e, R9, R12);
+        if (op->SHIFT == 1 || op->SHIFT == 2) op_rr(e, ALU_ADD, R9, R9);
+        if (op->SHIFT <= 1) clamp24(e, R9);
+        else                sext24(e, R9);
+    }
+
+    /* ACC = (INT64)X * Y >> 12 + B */
+    rex(e, 1, RAX, 0, RAX); e8(e, 0x63); modrm_rr(e, RAX, RAX);   /* movsxd rax, eax */
+    rex(e, 1, R8, 0, R8);   e8(e, 0x63); modrm_rr(e, R8, R8);     /* movsxd r8, r8d */
+    rex(e, 1, RAX, 0, R8);  e8(e, 0x0F); e8(e, 0xAF); modrm_rr(e, RAX, R8); /* imul rax, r8 */
+    rex(e, 1, 0, 0, RAX);   e8(e, 0xC1); modrm_rr(e, EXT_SAR, RAX); e8(e, 12);
+    if (!(f & DSPOP_ZERO)) op_rr(e, ALU_ADD, RAX, RDX);
+    mov_rr(e, R12, RAX);
+
+    if (f & DSPOP_TWT) {
+        mov_rr(e, RCX, RDI);
+        alu_ri(e, EXT_ADD, RCX, op->TWA);
+        alu_ri(e, EXT_AND, RCX, 0x7F);
+        store32(e, RBX, RCX, 4, offsetof(struct _SCSPDSP, TEMP), R9);
+    }
+
+    if (f & DSPOP_FRCL) {
+        mov_rr(e, R13, R9);
+        if (op->SHIFT == 3) {
+            alu_ri(e, EXT_AND, R13, 0x0FFF);
+        } else {
+            shift_ri(e, EXT_SAR, R13, 11);
+            alu_ri(e, EXT_AND, R13, 0x1FFF);
+        }
+    }
+
+    if (f & (DSPOP_MRD | DSPOP_MWT)) {
+        /* ADDR -> r8d, word index into sound RAM at r10 */
+        movzx16(e, R8, RBX, -1, 1, offsetof(struct _SCSPDSP, MADRS) + op->MASA * 2);
+        if (!(f & DSPOP_TABLE)) op_rr(e, ALU_ADD, R8, RDI);
+        if (f & DSPOP_ADREB) {
+            mov_rr(e, RAX, R15);
+            alu_ri(e, EXT_AND, RAX, 0x0FFF);
+            op_rr(e, ALU_ADD, R8, RAX);
+        }
+        if (f & DSPOP_NXADR) alu_ri(e, EXT_ADD, R8, 1);
+        if (!(f & DSPOP_TABLE)) {
+            load32(e, RAX, RBX, -1, 1, offsetof(struct _SCSPDSP, RBL));
+            alu_ri(e, 5 /* sub */, RAX, 1);
+            op_rr(e, ALU_AND, R8, RAX);
+        } else {
+            alu_ri(e, EXT_AND, R8, 0xFFFF);
+        }
+        load32(e, RAX, RBX, -1, 1, offsetof(struct _SCSPDSP, RBP));
+        shift_ri(e, EXT_SHL, RAX, 12);
+        op_rr(e, ALU_ADD, R8, RAX);
+        load64(e, R10, RBX, offsetof(struct _SCSPDSP, SCSPRAM));
+
+        if (f & DSPOP_MRD) {
+            movzx16(e, RAX, R10, R8, 2, 0);
+            if (f & DSPOP_NOFL) {
+                shift_ri(e, EXT_SHL, RAX, 8);
+                mov_rr(e, RBP, RAX);
+            } else {
+                emit_unpack(e);
+            }
+        }
+        if (f & DSPOP_MWT) {
+            if (f & DSPOP_NOFL) {
+                mov_rr(e, RAX, R9);
+                shift_ri(e, EXT_SAR, RAX, 8);
+            } else {
+                emit_pack(e);
+            }
+            store16(e, R10, R8, 2, 0, RAX);
+        }
+    }
+
+    if (f & DSPOP_ADRL) {
+        if (op->SHIFT == 3) {
+            mov_rr(e, R15, R9);
+            shift_ri(e, EXT_SAR, R15, 12);
+            alu_ri(e, EXT_AND, R15, 0xFFF);
+        } else {
+            mov_rr(e, R15, RSI);
+            shift_ri(e, EXT_SAR, R15, 16);
+        }
+    }
+
+    if (f & DSPOP_EWT) {
+        mov_rr(e, RAX, R9);
+        shift_ri(e, EXT_SAR, RAX, 8);
+        add16_mem(e, RBX, offsetof(struct _SCSPDSP, EFREG) + op->EWA * 2, RAX);
+    }
+}
+
+static const int jit_saved_regs[] = { RBX, RBP, RSI, RDI, R12, R13, R14, R15 };
+#define JIT_NUM_SAVED ((int)(sizeof(jit_saved_regs) / sizeof(jit_saved_regs[0])))
+
+static void *jit_alloc_exec(const uint8_t *code, size_t len, size_t *alloc_len)
+{
+#ifdef _WIN32
+    DWORD old;
+    void *mem = VirtualAlloc(NULL, len, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!mem) return NULL;
+    memcpy(mem, code, len);
+    if (!VirtualProtect(mem, len, PAGE_EXECUTE_READ, &old)) {
+        VirtualFree(mem, 0, MEM_RELEASE);
+        return NULL;
+    }
+    FlushInstructionCache(GetCurrentProcess(), mem, len);
+    *alloc_len = len;
+    return mem;
+#else
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (len + page - 1) & ~(page - 1);
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return NULL;
+    memcpy(mem, code, len);
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return NULL;
+    }
+    *alloc_len = size;
+    return mem;
+#endif
+}
+
+static void jit_free_exec(void *mem, size_t len)
+{
+#ifdef _WIN32
+    (void)len;
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(mem, len);
+#endif
+}
+
+/*
+ * Compile DSP->OPS[0..NumOps-1].  Returns the entry point, or NULL if
+ * executable memory isn't available.
+ */
+static void *DSP_JitCompile(struct _SCSPDSP *DSP, size_t *alloc_len)
+{
+    jit_emit_t e;
+    void *code;
+    int i;
+
+    e.buf = (uint8_t *)malloc(JIT_MAX_BYTES);
+    e.len = 0;
+    if (!e.buf) return NULL;
+
+    for (i = 0; i < JIT_NUM_SAVED; i++) push_r(&e, jit_saved_regs[i]);
+#ifdef _WIN32
+    rex(&e, 1, RCX, 0, RBX); e8(&e, 0x89); modrm_rr(&e, RCX, RBX);   /* mov rbx, rcx */
+#else
+    rex(&e, 1, RDI, 0, RBX); e8(&e, 0x89); modrm_rr(&e, RDI, RBX);   /* mov rbx, rdi */
+#endif
+    op_rr(&e, ALU_XOR, R12, R12);
+    op_rr(&e, ALU_XOR, R13, R13);
+    op_rr(&e, ALU_XOR, R14, R14);
+    op_rr(&e, ALU_XOR, R15, R15);
+    op_rr(&e, ALU_XOR, RBP, RBP);
+    op_rr(&e, ALU_XOR, RSI, RSI);
+    load32(&e, RDI, RBX, -1, 1, offsetof(struct _SCSPDSP, DEC));
+
+    for (i = 0; i < DSP->NumOps; i++) emit_op(&e, DSP->OPS + i);
+
+    for (i = JIT_NUM_SAVED - 1; i >= 0; i--) pop_r(&e, jit_saved_regs[i]);
+    e8(&e, 0xC3);
+
+    code = jit_alloc_exec(e.buf, (size_t)e.len, alloc_len);
+    free(e.buf);
+    return code;
+}
@@ -0,0 +1,382 @@
+/*
+ * test_scspdsp.c — Standalone tests for the SCSP DSP core.
+ *
+ * Runs random microprograms through the interpreter and the native code
+ * generator (x86-64 builds) and checks both produce bit-identical EFREG
+ * output, TEMP/MEMS state and ring buffer contents, and checks dead-step
+ * elimination against decoding every step.  Also covers the routing
+ * bypass, the static analyzer and the scsp_fx processor.
+ *
+ * Build:  make test_scspdsp   (or: cc -O2 -include scsp_types.h -D__AO_H -DCPUINTRF_H \
+ *         -D_SAT_HW_H_ -DOSD_CPU_H test_scspdsp.c scsp_fx.c scspdsp.c -o test_scspdsp -lm)
+ * Run:    ./test_scspdsp
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scsp.h"
+#include "scsp_fx.h"
+
+#define RAM_WORDS 0x40000   /* 512 KB sound RAM */
+
+static int passed = 0, failed = 0;
+#define ASSERT(cond, msg) do { if (!(cond)) { printf("  FAIL: %s\n", msg); failed++; } else { passed++; } } while(0)
+
+static uint32_t rng_state = 0x12345678;
+static uint32_t rnd(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* Fill a DSP context with a random program and random working state */
+static void random_dsp(struct _SCSPDSP *dsp, UINT16 *ram) {
+    int i, steps = 1 + rnd() % 128;
+
+    memset(dsp, 0, sizeof(*dsp));
+    dsp->SCSPRAM = ram;
+    dsp->SCSPRAM_LENGTH = RAM_WORDS * 2;
+    dsp->RBL = 0x2000 << (rnd() % 4);
+    dsp->RBP = rnd() % 0x30;
+    dsp->DEC = rnd();
+    for (i = 0; i < steps * 4; i++)
+        dsp->MPRO[i] = (rnd() % 8) ? (UINT16)rnd() : 0;
+    for (i = 0; i < 64; i++) dsp->COEF[i] = (INT16)rnd();
+    for (i = 0; i < 32; i++) dsp->MADRS[i] = (UINT16)rnd();
+    for (i = 0; i < 128; i++) dsp->TEMP[i] = (INT32)(rnd() & 0xFFFFFF);
+    for (i = 0; i < 32; i++) dsp->MEMS[i] = (INT32)(rnd() & 0xFFFFFF);
+    dsp->EXTS[0] = (INT16)rnd();
+    dsp->EXTS[1] = (INT16)rnd();
+    for (i = 0; i < RAM_WORDS; i++) ram[i] = (UINT16)rnd();
+}
+
+static void random_mixs(struct _SCSPDSP *a, struct _SCSPDSP *b) {
+    int i;
+    for (i = 0; i < 16; i++) {
+        INT32 s = (INT32)(rnd() << 12) >> 12;   /* 20-bit signed */
+        a->MIXS[i] = b->MIXS[i] = s;
+    }
+}
+
+/*
+ * Run one program through the interpreter and either native code or, with
+ * baseline set, the interpreter decoding every step.  Returns 1 on mismatch.
+ */
+static int compare_program(UINT16 *ram_a, UINT16 *ram_b, int samples, int baseline) {
+    static struct _SCSPDSP a, b;
+    int n, mismatch = 0;
+
+    random_dsp(&a, ram_a);
+    memcpy(&b, &a, sizeof(a));
+    memcpy(ram_b, ram_a, RAM_WORDS * 2);
+    b.SCSPRAM = ram_b;
+    a.NoJit = 1;
+    b.NoJit = b.NoElim = baseline;
+    SCSPDSP_Start(&a);
+    SCSPDSP_Start(&b);
+    SCSPDSP_Compile(&b);
+
+    for (n = 0; n < samples && !mismatch; n++) {
+        /* live COEF/MADRS edits must not need a recompile */
+        if (n == samples / 2) {
+            int c = rnd() % 64, m = rnd() % 32;
+            a.COEF[c] = b.COEF[c] = (INT16)rnd();
+            a.MADRS[m] = b.MADRS[m] = (UINT16)rnd();
+        }
+        random_mixs(&a, &b);
+        SCSPDSP_Step(&a);
+        SCSPDSP_Step(&b);
+        if (memcmp(a.EFREG, b.EFREG, sizeof(a.EFREG))) mismatch = 1;
+    }
+    /* dropped steps may leave dead TEMP/MEMS values behind */
+    if ((!baseline && (memcmp(a.TEMP, b.TEMP, sizeof(a.TEMP)) ||
+                       memcmp(a.MEMS, b.MEMS, sizeof(a.MEMS)))) ||
+        a.DEC != b.DEC ||
+        memcmp(ram_a, ram_b, RAM_WORDS * 2))
+        mismatch = 1;
+
+    SCSPDSP_JitFree(&a);
+    SCSPDSP_JitFree(&b);
+    return mismatch;
+}
+
+int main(void) {
+    UINT16 *ram_a = malloc(RAM_WORDS * 2);
+    UINT16 *ram_b = malloc(RAM_WORDS * 2);
+
+    printf("\n=== SCSP DSP Test ===\n\n");
+
+#ifdef SCSPDSP_JIT
+    printf("Test 1: native code is generated\n");
+    {
+        static struct _SCSPDSP d;
+        random_dsp(&d, ram_a);
+        SCSPDSP_Start(&d);
+        ASSERT(d.JitCode == NULL && d.JitStale, "SCSPDSP_Start only decodes");
+        SCSPDSP_Compile(&d);
+        ASSERT(d.JitCode != NULL && !d.JitStale, "JitCode set by SCSPDSP_Compile");
+        d.NoJit = 1;
+        SCSPDSP_Compile(&d);
+        ASSERT(d.JitCode == NULL, "NoJit falls back to the interpreter");
+        SCSPDSP_JitFree(&d);
+    }
+
+    printf("Test 2: native code matches the interpreter on random programs\n");
+    {
+        int i, bad = 0;
+        for (i = 0; i < 500; i++) bad += compare_program(ram_a, ram_b, 64, 0);
+        ASSERT(bad == 0, "500 random programs bit-exact");
+    }
+
+    printf("Test 3: MPRO writes are interpreted until recompiled off the render path\n");
+    {
+        static struct _SCSPDSP d;
+        void *code;
+        random_dsp(&d, ram_a);
+        d.OutSlots = 1;
+        SCSPDSP_Start(&d);
+        SCSPDSP_Compile(&d);
+        code = d.JitCode;
+        d.MPRO[0] ^= 0x1234;
+        d.Dirty = 1;
+        SCSPDSP_Step(&d);
+        ASSERT(d.Dirty == 0 && d.JitStale && d.JitCode == code, "MPRO write only redecodes on Step");
+        SCSPDSP_Compile(&d);
+        ASSERT(!d.JitStale && d.JitCode != NULL, "program recompiled by SCSPDSP_Compile");
+        SCSPDSP_JitFree(&d);
+    }
+#else
+    printf("Native DSP code generation not available on this target, skipping\n");
+#endif
+
+    printf("Test 4: DSP with no EFREG routed out is bypassed\n");
+    {
+        static struct _SCSPDSP d;
+        UINT32 dec, n, base;
+        int i, dirty = 0;
+        random_dsp(&d, ram_a);
+        SCSPDSP_SetRouting(&d, 0, 0, 7);
+        SCSPDSP_Start(&d);
+        dec = d.DEC;
+        for (n = 0; n < 100; n++) SCSPDSP_Step(&d);
+        ASSERT(!d.Bypassed, "routed output keeps the program running");
+
+        /* A slot still sends to it, but nothing it computes is heard */
+        SCSPDSP_SetRouting(&d, 0, 0, 0);
+        SCSPDSP_SetRouting(&d, 3, 7, 0);
+        SCSPDSP_Step(&d);
+        ASSERT(d.Bypassed, "program bypassed as soon as no EFREG is routed out");
+        for (i = 0; i < 16; i++) dirty |= d.EFREG[i];
+        ASSERT(dirty == 0, "EFREG silent while bypassed");
+        for (n = 0; n < 1000; n++) SCSPDSP_Step(&d);
+        ASSERT(d.DEC == dec - 1101, "DEC keeps advancing while bypassed");
+
+        /* empty program, so whatever is left after resuming came from before */
+        memset(d.MPRO, 0, sizeof(d.MPRO));
+        SCSPDSP_Start(&d);
+        SCSPDSP_SetRouting(&d, 2, 0, 5);
+        ASSERT(d.OutSlots == (1u << 2), "EFSDL tracked per channel");
+        SCSPDSP_Step(&d);
+        ASSERT(!d.Bypassed, "routing an EFREG resumes the program");
+        base = d.RBP << 12;
+        for (n = 0, dirty = 0; n < d.RBL; n++) dirty |= ram_a[base + n];
+        for (i = 0; i < 128; i++) dirty |= d.TEMP[i];
+        for (i = 0; i < 32; i++) dirty |= d.MEMS[i];
+        ASSERT(dirty == 0, "ring buffer, TEMP and MEMS cleared on resume");
+        SCSPDSP_JitFree(&d);
+    }
+
+    printf("Test 5: static analysis of ring buffer use and live steps\n");
+    {
+        static struct _SCSPDSP d;
+        struct _SCSPDSP_INFO info;
+        memset(&d, 0, sizeof(d));
+        /* step 0: NOP (reads TEMP into ACC), step 1: MWT at MADRS[0],
+           step 2: TWT to TEMP[0], step 3: YRL that nothing reads */
+        d.MPRO[1 * 4 + 2] = 0x4000;
+        d.MPRO[2 * 4 + 0] = 0x0080;
+        d.MPRO[3 * 4 + 2] = 0x0008;
+        d.MADRS[0] = 0x3000;
+        SCSPDSP_Analyze(&d, &info);
+        ASSERT(info.Steps == 4, "program length");
+        ASSERT(info.ActiveSteps == 3, "dead YRL step not counted");
+        ASSERT(info.MemWrites == 1 && info.MemReads == 0, "memory access count");
+        ASSERT(info.RingWords == 0x3001, "ring footprint from MADRS");
+        ASSERT(info.MinRBL == 1, "16K word ring buffer suffices");
+        ASSERT(info.TempLive && (info.TempWrite[0] & 1) && (info.TempRead[0] & 1), "TEMP liveness");
+
+        d.MPRO[1 * 4 + 3] = 0x0002;   /* ADREB: ADRS_REG may add 0xFFF */
+        d.MADRS[0] = 0x7000;
+        SCSPDSP_Analyze(&d, &info);
+        ASSERT(info.RingWords == 0x8000 && info.MinRBL == 2, "ADREB widens the footprint");
+
+        d.MPRO[1 * 4 + 2] = 0xC000;   /* TABLE access doesn't use the ring */
+        SCSPDSP_Analyze(&d, &info);
+        ASSERT(info.RingWords == 0 && info.TableWords == 0x8000 && info.MinRBL == 0,
+               "TABLE accesses reported separately");
+    }
+
+    printf("Test 6: scsp_fx passes MIXS through a one-step program\n");
+    {
+        /* step 0: ACC = MIXS0 * COEF0 (~1.0), step 1: EFREG0 += ACC */
+        static const uint16_t prog[8] = { 0x0000, 0xA800, 0x0002, 0x0000,
+                                          0x0000, 0x0000, 0x1002, 0x0000 };
+        static uint8_t exb[0x540];
+        int16_t buf[64 * 2];
+        int i, ok = 1, silent = 1;
+        scsp_fx_t *fx = scsp_fx_create(NULL);
+
+        memset(exb, 0, sizeof(exb));
+        exb[0x40] = 0x7F; exb[0x41] = 0xF8;           /* COEF0 */
+        for (i = 0; i < 8; i++) {
+            exb[0x140 + i * 2] = prog[i] >> 8;
+            exb[0x140 + i * 2 + 1] = prog[i] & 0xFF;
+        }
+        ASSERT(scsp_fx_load_exb(fx, exb, 0x100) == -1, "short EXB rejected");
+        ASSERT(scsp_fx_load_exb(fx, exb, sizeof(exb)) == 0, "EXB loaded");
+
+        for (i = 0; i < 64; i++) {
+            buf[i * 2] = (int16_t)(i * 400 - 12000);
+            buf[i * 2 + 1] = 5000;
+        }
+        scsp_fx_process(fx, buf, buf, 64);       /* in place */
+        for (i = 0; i < 64; i++) {
+            int want = i * 400 - 12000, got = buf[i * 2];
+            if (abs(got - want) > 1 + abs(want) / 500) ok = 0;
+            if (buf[i * 2 + 1] != 0) ok = 0;   /* EFREG1 untouched */
+        }
+        ASSERT(ok, "EFREG0 reproduces input L on the left output only");
+
+        scsp_fx_process(fx, NULL, buf, 64);
+        for (i = 0; i < 128; i++) silent &= buf[i] == 0;
+        ASSERT(silent, "no input, no tail for a memoryless program");
+        scsp_fx_destroy(fx);
+    }
+
+    printf("Test 7: COEF/MADRS ramps land on the target sample-accurately\n");
+    {
+        struct _SCSPDSP d;
+        int i, prev, mono = 1;
+
+        memset(&d, 0, sizeof(d));
+        d.Stopped = 1;              /* ramps advance even with no program */
+        d.NoJit = 1;
+
+        d.COEF[3] = -1000;
+        SCSPDSP_RampCoef(&d, 3, 3000, 100, DSPRAMP_LINEAR);
+        prev = d.COEF[3];
+        for (i = 0; i < 99; i++) {
+            SCSPDSP_Step(&d);
+            if (d.COEF[3] < prev || d.COEF[3] == 3000) mono = 0;
+            prev = d.COEF[3];
+        }
+        ASSERT(mono && abs(d.COEF[3] - 2960) <= 1, "linear ramp rises steadily");
+        SCSPDSP_Step(&d);
+        ASSERT(d.COEF[3] == 3000 && d.RampCoef == 0, "linear ramp ends on step 100");
+
+        d.MADRS[31] = 0x1000;
+        SCSPDSP_RampMadrs(&d, 31, 0x0100, 441, DSPRAMP_EXP);
+        for (i = 0; i < 10; i++) SCSPDSP_Step(&d);
+        ASSERT(d.MADRS[31] < 0x1000 - 0x100, "exponential ramp moves fastest first");
+        for (i = 10; i < 441; i++) SCSPDSP_Step(&d);
+        ASSERT(d.MADRS[31] == 0x0100 && d.RampMadrs == 0, "exponential ramp lands on target");
+
+        SCSPDSP_RampCoef(&d, 0, 0x7FF8, 1000, DSPRAMP_LINEAR);
+        SCSPDSP_RampCoef(&d, 63, -4096, 1000, DSPRAMP_LINEAR);
+        SCSPDSP_Step(&d);
+        SCSPDSP_RampCoef(&d, 0, 5, 0, DSPRAMP_LINEAR);
+        for (i = 0; i < 10; i++) SCSPDSP_Step(&d);
+        ASSERT(d.COEF[0] == 5 && d.RampCoef == ((UINT64)1 << 63), "zero-length ramp cancels that entry only");
+
+        SCSPDSP_Start(&d);
+        ASSERT(d.RampCoef == 0 && d.RampMadrs == 0, "starting a program drops pending ramps");
+    }
+
+    printf("Test 8: hot-swapped programs keep the running state\n");
+    {
+        static struct _SCSPDSP a, b;
+        UINT16 mpro[512], madrs[32];
+        INT16 coef[64];
+        int i, same = 1;
+
+        random_dsp(&a, ram_a);
+        a.InSlots = a.OutSlots = 1;
+        SCSPDSP_Start(&a);
+        for (i = 0; i < 100; i++) {
+            random_mixs(&a, &b);
+            SCSPDSP_Step(&a);
+        }
+        memcpy(mpro, a.MPRO, sizeof(mpro));
+        memcpy(coef, a.COEF, sizeof(coef));
+        memcpy(madrs, a.MADRS, sizeof(madrs));
+        memcpy(ram_b, ram_a, RAM_WORDS * 2);
+        memcpy(b.TEMP, a.TEMP, sizeof(a.TEMP));
+        memcpy(b.MEMS, a.MEMS, sizeof(a.MEMS));
+        b.DEC = a.DEC;
+
+        coef[5] = (INT16)(a.COEF[5] ^ 0x4000);
+        ASSERT(SCSPDSP_Reload(&a, mpro, coef, madrs, 64) == 0, "COEF-only edit changes no steps");
+        ASSERT(!memcmp(a.TEMP, b.TEMP, sizeof(a.TEMP)) && !memcmp(a.MEMS, b.MEMS, sizeof(a.MEMS)) &&
+               a.DEC == b.DEC && !memcmp(ram_a, ram_b, RAM_WORDS * 2),
+               "TEMP, MEMS, DEC and ring buffer kept");
+        ASSERT(a.COEF[5] != coef[5] && a.RampCoef == ((UINT64)1 << 5), "unchanged program glides COEF");
+        for (i = 0; i < 64; i++) SCSPDSP_Step(&a);
+        ASSERT(a.COEF[5] == coef[5] && a.RampCoef == 0, "glide ends on the new COEF");
+
+        memcpy(b.TEMP, a.TEMP, sizeof(a.TEMP));
+        mpro[2] ^= 0x0100;    /* step 0: toggle a shifter bit */
+        coef[5] = 1234;
+        ASSERT(SCSPDSP_Reload(&a, mpro, coef, madrs, 64) == 1, "one edited step reported");
+        SCSPDSP_Compile(&a);
+        ASSERT(a.COEF[5] == 1234 && a.RampCoef == 0 && !memcmp(a.TEMP, b.TEMP, sizeof(a.TEMP)),
+               "edited program sets COEF at once and keeps TEMP");
+
+        /* the swapped program must run exactly like a fresh load of it */
+        memcpy(&b, &a, sizeof(a));
+        memcpy(ram_b, ram_a, RAM_WORDS * 2);
+        b.SCSPRAM = ram_b;
+        b.JitCode = NULL;
+        SCSPDSP_Start(&b);
+        SCSPDSP_Compile(&b);
+        for (i = 0; i < 200 && same; i++) {
+            random_mixs(&a, &b);
+            SCSPDSP_Step(&a);
+            SCSPDSP_Step(&b);
+            same = !memcmp(a.EFREG, b.EFREG, sizeof(a.EFREG));
+        }
+        ASSERT(same && !memcmp(ram_a, ram_b, RAM_WORDS * 2), "swapped program matches a fresh start");
+
+        a.Stopped = 1;
+        coef[5] = 99;
+        SCSPDSP_Reload(&a, mpro, coef, madrs, 0);
+        ASSERT(a.Stopped, "reload leaves a stopped DSP stopped");
+        a.Stopped = 0;
+        memset(mpro, 0, sizeof(mpro));
+        SCSPDSP_Reload(&a, mpro, coef, madrs, 0);
+        ASSERT(a.Stopped, "empty program stops the DSP");
+        SCSPDSP_JitFree(&a);
+        SCSPDSP_JitFree(&b);
+    }
+
+    printf("Test 9: dead-step elimination matches running every step\n");
+    {
+        int i, bad = 0;
+        for (i = 0; i < 5000; i++) bad += compare_program(ram_a, ram_b, 64, 1);
+        ASSERT(bad == 0, "5000 random programs bit-exact with every step kept");
+    }
+
+    free(ram_a);
+    free(ram_b);
+
+    printf("\n==================================================\n");
+    printf("Passed: %d  Failed: %d\n", passed, failed);
+    if (failed > 0) {
+        printf("SOME TESTS FAILED\n");
+        return 1;
+    }
+    printf("All tests passed!\n");
+    return 0;
+}
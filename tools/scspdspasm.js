@@ -617,8 +617,57 @@ function scspdspParseExb(exb) {
     return { mpro, coef, madrs, rbl, name, steps };
 }
 
+/**
+ * Statically analyze an assembled program using the SCSP WASM module's
+ * scsp_dsp_analyze().  Only steps that survive dead-step elimination are
+ * counted; ring sizes assume ADREB can add up to 0xFFF.
+ * @param {object} scsp — Emscripten module (needs _scsp_dsp_analyze)
+ * @param {{ mpro: Uint16Array, madrs: Uint16Array }} prog — from
+ *        scspdspAssemble() or scspdspParseExb()
+ * @returns {{ steps: number, activeSteps: number, memReads: number,
+ *             memWrites: number, ringWords: number, tableWords: number,
+ *             minRbl: number, tempRead: boolean[], tempWrite: boolean[],
+ *             memsRead: number, memsWrite: number, tempLive: boolean,
+ *             memsLive: number } | null} null if the module lacks the export
+ */
+function scspdspAnalyze(scsp, prog) {
+    if (!scsp || !scsp._scsp_dsp_analyze) return null;
+    const INFO_WORDS = 19;
+    const mproPtr = scsp._malloc(prog.mpro.byteLength);
+    const madrsPtr = scsp._malloc(prog.madrs.byteLength);
+    const outPtr = scsp._malloc(INFO_WORDS * 4);
+    scsp.HEAPU16.set(prog.mpro, mproPtr >> 1);
+    scsp.HEAPU16.set(prog.madrs, madrsPtr >> 1);
+    scsp._scsp_dsp_analyze(mproPtr, prog.mpro.length, madrsPtr, prog.madrs.length, outPtr);
+    const out = scsp.HEAPU32.slice(outPtr >> 2, (outPtr >> 2) + INFO_WORDS);
+    scsp._free(mproPtr);
+    scsp._free(madrsPtr);
+    scsp._free(outPtr);
+
+    const bits128 = (base) => {
+        const r = [];
+        for (let i = 0; i < 128; i++) r.push(((out[base + (i >> 5)] >>> (i & 31)) & 1) === 1);
+        return r;
+    };
+    return {
+        steps: out[0],
+        activeSteps: out[1],
+        memReads: out[2],
+        memWrites: out[3],
+        ringWords: out[4],
+        tableWords: out[5],
+        minRbl: out[6],
+        tempRead: bits128(7),
+        tempWrite: bits128(11),
+        memsRead: out[15],
+        memsWrite: out[16],
+        tempLive: out[17] !== 0,
+        memsLive: out[18],
+    };
+}
+
 // ─── Export (works in Node.js and browser) ──────────────────────────
 
 if (typeof module !== 'undefined' && module.exports) {
-    module.exports = { scspdspAssemble, scspdspAssembleExb, scspdspParseExb, Assembler, packMpro };
+    module.exports = { scspdspAssemble, scspdspAssembleExb, scspdspParseExb, scspdspAnalyze, Assembler, packMpro };
 }
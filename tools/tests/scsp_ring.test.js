@@ -0,0 +1,169 @@
+const { describe, it } = require('node:test');
+const assert = require('node:assert/strict');
+const ScspRing = require('../scsp_ring.js');
+
+function ramp(start, n) {
+    var a = new Float32Array(n);
+    for (var i = 0; i < n; i++) a[i] = start + i;
+    return a;
+}
+
+describe('ScspRing audio ring', () => {
+    it('rejects sizes that are not a power of two', () => {
+        assert.throws(() => ScspRing.createAudioRing(1000));
+    });
+
+    it('passes frames through in order across the wrap point', () => {
+        var ring = ScspRing.audioRing(ScspRing.createAudioRing(256));
+        var outL = new Float32Array(100), outR = new Float32Array(100);
+        var next = 0, expect = 0;
+        for (var round = 0; round < 20; round++) {
+            next += ring.write(ramp(next, 100), ramp(-next - 100, 100).reverse(), 100);
+            var got = ring.read(outL, outR, 100);
+            for (var i = 0; i < got; i++, expect++) {
+                assert.equal(outL[i], expect);
+                assert.equal(outR[i], -expect - 1);
+            }
+        }
+        assert.equal(ring.written(), 2000);
+        assert.equal(ring.played(), 2000);
+    });
+
+    it('never overfills or reads past the writer', () => {
+        var ring = ScspRing.audioRing(ScspRing.createAudioRing(128));
+        assert.equal(ring.write(ramp(0, 200), ramp(0, 200), 200), 128);
+        assert.equal(ring.space(), 0);
+        assert.equal(ring.write(ramp(0, 10), ramp(0, 10), 10), 0);
+        var out = new Float32Array(200);
+        assert.equal(ring.read(out, out, 200), 128);
+        assert.equal(ring.read(out, out, 200), 0);
+    });
+
+    it('clamps the render-ahead target to one block and the ring size', () => {
+        var ring = ScspRing.audioRing(ScspRing.createAudioRing(1024));
+        ring.setTarget(16);
+        assert.equal(ring.target(), ScspRing.BLOCK);
+        ring.setTarget(1 << 20);
+        assert.equal(ring.target(), 1024);
+    });
+});
+
+describe('ScspRing command queue', () => {
+    it('delivers records in order, including negative values', () => {
+        var q = ScspRing.cmdQueue(ScspRing.createCmdQueue(8));
+        var dst = new Uint32Array(8 * 4);
+        q.push(ScspRing.CMD.WRITE_SLOT, 3, 0xA, 0x1234);
+        q.push(ScspRing.CMD.DSP_RAMP_COEF, 5, -100, 441);
+        assert.equal(q.pop(dst, 8, 0), 2);
+        assert.deepEqual(Array.from(dst.subarray(0, 8)), [2, 3, 0xA, 0x1234, 8, 5, 0xFFFFFF9C, 441]);
+        assert.equal(q.pending(), 0);
+    });
+
+    it('drops and counts records when full', () => {
+        var q = ScspRing.cmdQueue(ScspRing.createCmdQueue(4));
+        for (var i = 0; i < 4; i++) assert.ok(q.push(ScspRing.CMD.KEY_ON, i, 0, 0));
+        assert.equal(q.push(ScspRing.CMD.KEY_ON, 4, 0, 0), false);
+        assert.equal(q.dropped(), 1);
+    });
+
+    it('holds records behind a SYNC until its bulk message is applied', () => {
+        var q = ScspRing.cmdQueue(ScspRing.createCmdQueue(8));
+        var dst = new Uint32Array(8 * 4);
+        q.push(ScspRing.CMD.KEY_OFF, 1, 0, 0);
+        q.push(ScspRing.CMD.SYNC, 1, 0, 0);
+        q.push(ScspRing.CMD.KEY_ON, 1, 0, 0);
+        assert.equal(q.pop(dst, 8, 0), 1);
+        assert.equal(dst[0], ScspRing.CMD.KEY_OFF);
+        assert.equal(q.pop(dst, 8, 0), 0);
+        assert.equal(q.pending(), 2);
+        assert.equal(q.pop(dst, 8, 1), 1);
+        assert.equal(dst[0], ScspRing.CMD.KEY_ON);
+        assert.equal(q.pending(), 0);
+    });
+
+    it('respects the caller batch size', () => {
+        var q = ScspRing.cmdQueue(ScspRing.createCmdQueue(16));
+        var dst = new Uint32Array(4 * 4);
+        for (var i = 0; i < 10; i++) q.push(ScspRing.CMD.KEY_ON, i, 0, 0);
+        assert.equal(q.pop(dst, 4, 0), 4);
+        assert.equal(q.pop(dst, 4, 0), 4);
+        assert.equal(q.pop(dst, 4, 0), 2);
+        assert.equal(dst[5], 9);
+    });
+});
+
+describe('ScspRing render worker', () => {
+    const vm = require('vm');
+
+    // Stand-in for the SCSPModule instance: renders a counter, logs commands
+    function fakeModule() {
+        var heap = new ArrayBuffer(1 << 16);
+        var mod = {
+            HEAPU8: new Uint8Array(heap), HEAPF32: new Float32Array(heap),
+            executed: [], frame: 0, top: 0x8000,
+            _scsp_get_cmd_buf: function() { return 0x400; },
+            _scsp_get_ram_ptr: function() { return 0x4000; },
+            _scsp_exec: function(ptr, n) {
+                var w = new Uint32Array(heap, ptr, n * 4);
+                for (var i = 0; i < n; i++) mod.executed.push([w[i * 4], w[i * 4 + 1]]);
+            },
+            _scsp_render_f32: function(n) {
+                for (var i = 0; i < n; i++) { mod.HEAPF32[0x200 + i] = mod.frame++; mod.HEAPF32[0x200 + n + i] = 0; }
+                return 0x800;
+            },
+            _malloc: function(n) { var p = mod.top; mod.top += (n + 7) & ~7; return p; },
+            _free: function() {},
+            _scsp_dsp_load_exb: function(ptr, n) { mod.executed.push(['exb', mod.HEAPU8[ptr], n]); },
+        };
+        return mod;
+    }
+
+    function startWorker(mod) {
+        var kicks = 0, posted = [];
+        var scope = {
+            SharedArrayBuffer, Atomics, Uint8Array, Uint32Array, Int32Array, Float32Array, Math, Error, Object, Array,
+            importScripts: function() {},
+            SCSPModule: function() { return Promise.resolve(mod); },
+            MessageChannel: function() { scope.channel = this; this.port1 = {}; this.port2 = { postMessage: function() { kicks++; } }; },
+            postMessage: function(m) { posted.push(m); },
+        };
+        scope.self = scope;
+        vm.runInNewContext(ScspRing.workerSource(), scope);
+        return { scope: scope, posted: posted, kicks: function() { return kicks; } };
+    }
+
+    it('renders ahead, runs queued commands and orders bulk messages', async () => {
+        var mod = fakeModule();
+        var w = startWorker(mod);
+        var audioSab = ScspRing.createAudioRing(1024), cmdSab = ScspRing.createCmdQueue(64);
+        var audio = ScspRing.audioRing(audioSab), cmds = ScspRing.cmdQueue(cmdSab);
+        audio.setTarget(256);
+
+        cmds.push(ScspRing.CMD.KEY_ON, 7, 0, 0);
+        cmds.push(ScspRing.CMD.SYNC, 1, 0, 0);
+        cmds.push(ScspRing.CMD.KEY_OFF, 7, 0, 0);
+        mod.HEAPU8[0x4000 + 16] = 0;
+        w.scope.onmessage({ data: { type: 'init', glueUrl: 'x', audio: audioSab, cmds: cmdSab,
+                                    memory: new ArrayBuffer(1 << 16) } });
+        w.scope.onmessage({ data: { type: 'ram', seq: 1, offset: 16, bytes: new Uint8Array([0x5A]) } });
+        await new Promise(setImmediate);
+
+        assert.equal(w.posted[0].type, 'ready');
+        assert.equal(audio.available(), 256, 'buffered up to the target');
+        assert.equal(mod.HEAPU8[0x4000 + 16], 0x5A, 'RAM write applied');
+        assert.deepEqual(mod.executed, [[3, 7], [4, 7]], 'key-off waited for the RAM write');
+
+        var out = new Float32Array(128);
+        audio.read(out, new Float32Array(128), 128);
+        assert.equal(out[0], 0);
+        assert.equal(out[127], 127);
+
+        // next pump tops the ring up again and replays a pointer call
+        w.scope.onmessage({ data: { type: 'call', seq: 2, fn: '_scsp_dsp_load_exb', args: [0, 1344],
+                                    arrays: [{ arg: 0, bytes: new Uint8Array([0x42]) }] } });
+        assert.ok(w.kicks() > 0, 'worker yields to its event loop');
+        w.scope.channel.port1.onmessage();
+        assert.equal(audio.available(), 256);
+        assert.deepEqual(mod.executed[2], ['exb', 0x42, 1344]);
+    });
+});
@@ -240,3 +240,76 @@ describe('Playback processBlock', () => {
         assert.equal(triggers.length, 0, 'muted channel should not trigger');
     });
 });
+
+describe('Native SEQ playback', () => {
+    function createNativeEngine(canPlay) {
+        var engine = createMockEngine();
+        engine.canPlaySong = function() { return canPlay; };
+        engine.playSong = function(seq, loop) {
+            this.calls.push({ fn: 'playSong', seq: seq, loop: loop });
+            return true;
+        };
+        engine.stopSong = function() { this.calls.push({ fn: 'stopSong' }); };
+        return engine;
+    }
+
+    it('hands the song to the engine and only moves the cursor', () => {
+        var engine = createNativeEngine(true);
+        var pat = makePatternWithNotes(4, { 0: [[0, 60, 100]] });
+        var state = makeState([pat], [0]);
+        state.bpm = 120;
+        state.stepsPerBeat = 4;
+        var pb = TrackerPlayback.create(state, engine);
+        TrackerState.resetChannelState();
+        pb.start(0, 0);
+
+        var play = engine.calls.filter(function(c) { return c.fn === 'playSong'; });
+        assert.equal(play.length, 1);
+        assert.ok(play[0].seq instanceof Uint8Array);
+        assert.equal(play[0].loop, true);
+        assert.equal(pb.native, true);
+
+        pb.processBlock(pb.samplesPerStep * 2 + 1);
+        assert.ok(pb.currentRow >= 2);
+        assert.equal(engine.calls.filter(function(c) { return c.fn === 'triggerNote'; }).length, 0);
+
+        pb.stop();
+        assert.ok(engine.calls.some(function(c) { return c.fn === 'stopSong'; }));
+        assert.equal(pb.native, false);
+    });
+
+    it('falls back to JS scheduling when the engine cannot play the bank', () => {
+        var engine = createNativeEngine(false);
+        var pat = makePatternWithNotes(4, { 0: [[0, 60, 100]] });
+        var state = makeState([pat], [0]);
+        var pb = TrackerPlayback.create(state, engine);
+        TrackerState.resetChannelState();
+        pb.start(0, 0);
+        assert.equal(pb.native, false);
+        pb.processBlock(pb.samplesPerStep + 1);
+        assert.equal(engine.calls.filter(function(c) { return c.fn === 'triggerNote'; }).length, 1);
+    });
+
+    it('falls back mid-row, for muted channels and on tempo changes', () => {
+        var engine = createNativeEngine(true);
+        var pat = makePatternWithNotes(4, { 0: [[0, 60, 100]] });
+        var state = makeState([pat], [0]);
+        var pb = TrackerPlayback.create(state, engine);
+        TrackerState.resetChannelState();
+
+        pb.start(2, 0);
+        assert.equal(pb.native, false);
+
+        TrackerState.toggleMute(1);
+        pb.start(0, 0);
+        assert.equal(pb.native, false);
+        TrackerState.resetChannelState();
+
+        pb.start(0, 0);
+        assert.equal(pb.native, true);
+        state.bpm = 90;
+        pb.updateTempo();
+        assert.equal(pb.native, false);
+        assert.ok(engine.calls.some(function(c) { return c.fn === 'stopSong'; }));
+    });
+});
@@ -370,9 +370,13 @@ const TonIO = (function () {
    * preserved for direct slot programming.
    *
    * @param {ArrayBuffer} buffer - Raw TON file bytes
+   * @param {Object} [opts]
+   * @param {boolean} [opts.pcm=true] - Decode PCM; pass false when the caller
+   *   plays the samples straight from sound RAM (each op.pcm is then empty)
    * @returns {ImportTonResult}
    */
-  function importTon(buffer) {
+  function importTon(buffer, opts) {
+    const decodePcm = !opts || opts.pcm !== false;
     const data = new Uint8Array(buffer);
     const view = new DataView(buffer);
 
@@ -439,7 +443,7 @@ const TonIO = (function () {
 
         // Extract PCM samples (big-endian int16 → Float32Array)
         const sampleSize = pcm8b ? 1 : 2;
-        const numSamples = lea > 0 ? lea : 0;
+        const numSamples = decodePcm && lea > 0 ? lea : 0;
         const pcm = new Float32Array(numSamples);
         for (let si = 0; si < numSamples; si++) {
           const addr = saAddr + si * sampleSize;
@@ -9,6 +9,33 @@ var TrackerPlayback = (function () {
 
     // In Node.js, TrackerState must be required; in browser it's a global.
     var _TrackerState = (typeof TrackerState !== 'undefined') ? TrackerState : require('./tracker_state.js');
+    var _buildSEQ = (typeof buildSEQ !== 'undefined') ? buildSEQ : require('./seq_io.js').buildSEQ;
+
+    /**
+     * Whether the song can be handed to the engine's native SEQ player
+     * as-is: buildSEQ gives each channel one program (its first default
+     * instrument) and can't mute channels.
+     * @param {Object} state
+     * @param {number[]} order - Song slots in playback order
+     * @returns {boolean}
+     */
+    function seqExportable(state, order) {
+        var NUM_CHANNELS = _TrackerState.NUM_CHANNELS;
+        for (var ch = 0; ch < NUM_CHANNELS; ch++) {
+            if (!_TrackerState.isChannelAudible(ch)) return false;
+            var inst = null;
+            for (var i = 0; i < order.length; i++) {
+                var chan = state.patterns[order[i]].channels[ch];
+                if (inst === null) inst = chan.defaultInst;
+                if (chan.defaultInst !== inst) return false;
+                for (var r = 0; r < chan.rows.length; r++) {
+                    var cell = chan.rows[r];
+                    if (cell.note !== null && cell.inst !== null && cell.inst !== inst) return false;
+                }
+            }
+        }
+        return true;
+    }
 
     /**
      * Create a playback instance.
@@ -25,6 +52,9 @@ var TrackerPlayback = (function () {
             samplePos: 0,
             samplesPerStep: 0,
             pendingOffs: [],
+            /** True while the engine's native SEQ player is producing the notes;
+             *  processBlock then only moves the row cursor. */
+            native: false,
 
             /** Callback fired when the current row changes during playback. Set by UI. */
             onRowChange: null,
@@ -42,7 +72,31 @@ var TrackerPlayback = (function () {
                 this.currentSongSlot = songSlot;
                 this.samplePos = 0;
                 this.pendingOffs = [];
+                this.native = false;
                 this.updateTempo();
+                this.startNative(row, songSlot);
+            },
+
+            /**
+             * Hand the song to the engine's native SEQ player when it has one and
+             * the song maps onto a SEQ file. Playback from the top of a song slot
+             * only; the song is rotated so it still loops back to that slot.
+             * @param {number} row
+             * @param {number} songSlot
+             */
+            startNative: function (row, songSlot) {
+                if (row !== 0 || !engine.playSong || !engine.canPlaySong) return;
+                if (!engine.canPlaySong(state.instruments)) return;
+                var order = state.song.slice(songSlot).concat(state.song.slice(0, songSlot));
+                if (!seqExportable(state, order)) return;
+                var seq;
+                try {
+                    seq = _buildSEQ({ patterns: state.patterns, song: order, bpm: state.bpm,
+                                      stepsPerBeat: state.stepsPerBeat, numChannels: _TrackerState.NUM_CHANNELS });
+                } catch (e) {
+                    return; // seq_io.js not bundled
+                }
+                this.native = engine.playSong(seq, true);
             },
 
             /**
@@ -51,6 +105,8 @@ var TrackerPlayback = (function () {
             stop: function () {
                 this.playing = false;
                 this.pendingOffs = [];
+                if (this.native) engine.stopSong();
+                this.native = false;
                 engine.releaseAll();
                 if (this.onStop) this.onStop();
             },
@@ -61,6 +117,11 @@ var TrackerPlayback = (function () {
             updateTempo: function () {
                 var sampleRate = engine.getSampleRate();
                 this.samplesPerStep = Math.round(sampleRate * 60 / state.bpm / state.stepsPerBeat);
+                // The SEQ already sent has the old tempo: carry on from JS
+                if (this.native) {
+                    engine.stopSong();
+                    this.native = false;
+                }
             },
 
             /**
@@ -74,7 +135,7 @@ var TrackerPlayback = (function () {
                     var untilNext = this.samplesPerStep - this.samplePos;
                     if (untilNext <= 0) {
                         var pat = state.patterns[state.song[this.currentSongSlot]];
-                        this.triggerRow(this.currentRow, pat);
+                        if (!this.native) this.triggerRow(this.currentRow, pat);
                         this.currentRow++;
                         if (this.currentRow >= pat.length) {
                             this.currentRow = 0;